@@ -0,0 +1,82 @@
+#include "benchmark_common.h"
+
+#include "mesh.h"
+
+namespace blaz {
+
+static const u32 GRID_MESH_COUNT = 8;
+static const u32 GRID_MATERIAL_COUNT = 16;
+static const u32 GRID_SIZE = 64;
+
+Error init_benchmark(BenchmarkFixture* fixture, Vec3 camera_position) {
+    Renderer* renderer = &fixture->m_renderer;
+    Error err = renderer->init(&fixture->m_window);
+    if (err) {
+        return err;
+    }
+
+    Scene* scene = &fixture->m_scene;
+    init_scene(scene);
+    renderer->m_current_scene = scene;
+
+    add_node(scene, Node{.m_name = "camera_node", .m_position = camera_position}, "root_node");
+    scene->m_nodes["camera_node"].update_matrix();
+    return renderer->create_camera(
+        Camera{.m_name = "camera", .m_scene = scene, .m_node = "camera_node"});
+}
+
+void add_benchmark_renderable(BenchmarkFixture* fixture, u32 index, Vec3 position,
+                              Renderable renderable) {
+    str node_name = "node_" + std::to_string(index);
+    add_node(&fixture->m_scene, Node{.m_name = node_name, .m_position = position}, "root_node");
+    fixture->m_scene.m_nodes[node_name].update_matrix();
+    renderable.m_name = "renderable_" + std::to_string(index);
+    renderable.m_node = node_name;
+    fixture->m_renderer.create_renderable(renderable);
+}
+
+void setup_grid_scene(BenchmarkFixture* fixture, u32 renderable_count) {
+    Renderer* renderer = &fixture->m_renderer;
+    renderer->create_uniform_buffer(UniformBuffer{
+        .m_name = "u_bench",
+        .m_uniforms = {Uniform{.m_name = "u_color", .m_type = UNIFORM_VEC3}},
+    });
+
+    renderer->create_shader(Shader{.m_name = "bench_shader", .m_should_reload = false});
+
+    for (u32 i = 0; i < GRID_MESH_COUNT; i++) {
+        str mesh_name = "mesh_" + std::to_string(i);
+        renderer->create_mesh(Mesh{.m_name = mesh_name});
+        make_cube(&renderer->m_meshes[mesh_name]);
+    }
+
+    for (u32 i = 0; i < GRID_MATERIAL_COUNT; i++) {
+        renderer->create_material(Material{
+            .m_name = "material_" + std::to_string(i),
+            .m_shader = "bench_shader",
+            .m_uniforms = {{"u_bench", {{"u_color", Vec3(f32(i) / GRID_MATERIAL_COUNT, 0, 0)}}}},
+        });
+    }
+
+    for (u32 i = 0; i < renderable_count; i++) {
+        Vec3 position(f32(i % GRID_SIZE), f32((i / GRID_SIZE) % GRID_SIZE),
+                      -f32(i / (GRID_SIZE * GRID_SIZE)));
+        add_benchmark_renderable(
+            fixture, i, position,
+            Renderable{
+                .m_tags = {"bench"},
+                .m_material = "material_" + std::to_string(i % GRID_MATERIAL_COUNT),
+                .m_mesh = "mesh_" + std::to_string((i / GRID_MATERIAL_COUNT) % GRID_MESH_COUNT),
+            });
+    }
+
+    renderer->m_passes.push_back(Pass{
+        .m_name = "bench_pass",
+        .m_type = PassType::RENDER,
+        .m_shader = "bench_shader",
+        .m_tags = {"bench"},
+        .m_camera = "camera",
+    });
+}
+
+}  // namespace blaz
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "node.h"
+#include "platform.h"
+#include "renderer.h"
+#include "types.h"
+
+namespace blaz {
+
+// The window, renderer and scene every benchmark starts from, with a camera named "camera" on
+// the node "camera_node". The scene is declared first so that it outlives the renderer.
+struct BenchmarkFixture {
+    Scene m_scene;
+    Window m_window;
+    Renderer m_renderer;
+};
+
+Error init_benchmark(BenchmarkFixture* fixture, Vec3 camera_position);
+
+// Adds the node "node_<index>" at position and a renderable "renderable_<index>" on it.
+void add_benchmark_renderable(BenchmarkFixture* fixture, u32 index, Vec3 position,
+                              Renderable renderable);
+
+// A grid of cubes with a few meshes and materials, drawn by one render pass "bench_pass".
+void setup_grid_scene(BenchmarkFixture* fixture, u32 renderable_count);
+
+}  // namespace blaz
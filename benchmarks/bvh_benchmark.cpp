@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <random>
+
+#include "bvh.h"
+#include "culling.h"
+#include "logger.h"
+#include "my_math.h"
+#include "my_time.h"
+#include "types.h"
+
+using namespace blaz;
+
+const f32 WORLD_SIZE = 1000.0f;
+const f32 MAX_ITEM_SIZE = 4.0f;
+const u32 QUERY_COUNT = 1000;
+
+static Aabb random_box(std::mt19937& rng) {
+    std::uniform_real_distribution<f32> position(-WORLD_SIZE / 2, WORLD_SIZE / 2);
+    std::uniform_real_distribution<f32> size(0.5f, MAX_ITEM_SIZE);
+    Vec3 center(position(rng), position(rng), position(rng));
+    Vec3 extent(size(rng), size(rng), size(rng));
+    return Aabb{.m_min = center - extent * 0.5f, .m_max = center + extent * 0.5f};
+}
+
+static Aabb moved_box(const Aabb& bounds, std::mt19937& rng) {
+    std::uniform_real_distribution<f32> offset(-1.0f, 1.0f);
+    Vec3 translation(offset(rng), offset(rng), offset(rng));
+    return Aabb{.m_min = bounds.m_min + translation, .m_max = bounds.m_max + translation};
+}
+
+static Frustum camera_frustum(f32 angle) {
+    Mat4 view = translate_3d(Vec3(0, 0, -WORLD_SIZE / 2)) *
+                rotate_3d(Quat::from_axis_angle(Vec3(0, 1, 0), angle));
+    Mat4 projection = perspective_projection(1.0f, 16.0f / 9.0f, 0.1f, WORLD_SIZE);
+    return make_frustum(view * projection);
+}
+
+int main(int argc, char* argv[]) {
+    u32 item_count = argc > 1 ? u32(std::stoul(argv[1])) : 100000;
+    u32 frame_count = argc > 2 ? u32(std::stoul(argv[2])) : 20;
+
+    std::mt19937 rng(42);
+    vec<Aabb> item_bounds(item_count);
+    for (Aabb& bounds : item_bounds) {
+        bounds = random_box(rng);
+    }
+    vec<bool> item_valid(item_count, true);
+
+    Bvh bvh;
+    u64 start_time = get_timestamp_microsecond();
+    bvh.build(item_bounds, item_valid);
+    f64 build_ms = f64(get_timestamp_microsecond() - start_time) / 1000.0;
+    f32 built_cost = bvh.sah_cost();
+    logger.info("Build of ", item_count, " items: ", build_ms, " ms, ", bvh.m_nodes.size(),
+                " nodes, SAH cost ", built_cost);
+
+    for (f32 dirty_fraction : {0.001f, 0.01f, 0.1f, 1.0f}) {
+        u32 dirty_count = std::max(1u, u32(f32(item_count) * dirty_fraction));
+        u64 refit_time_us = 0;
+        for (u32 frame = 0; frame < frame_count; frame++) {
+            vec<u32> dirty_items(dirty_count);
+            for (u32& item : dirty_items) {
+                item = rng() % item_count;
+                item_bounds[item] = moved_box(item_bounds[item], rng);
+            }
+            start_time = get_timestamp_microsecond();
+            for (u32 item : dirty_items) {
+                bvh.update(item, item_bounds[item]);
+            }
+            refit_time_us += get_timestamp_microsecond() - start_time;
+        }
+        f64 refit_ms = f64(refit_time_us) / 1000.0 / frame_count;
+        logger.info("Refit of ", dirty_count, " dirty items: ", refit_ms, " ms per frame, ",
+                    f64(refit_time_us) * 1000.0 / (f64(dirty_count) * frame_count),
+                    " ns per item, SAH cost ", bvh.sah_cost());
+    }
+
+    start_time = get_timestamp_microsecond();
+    bvh.start_rebuild();
+    while (!bvh.finish_rebuild()) {
+    }
+    logger.info("Background rebuild: ", f64(get_timestamp_microsecond() - start_time) / 1000.0,
+                " ms, SAH cost ", bvh.sah_cost(), " (", built_cost, " after the first build)");
+
+    BoundsSoA bounds_soa;
+    bounds_soa.resize(item_count);
+    for (u32 i = 0; i < item_count; i++) {
+        bounds_soa.set(i, item_bounds[i]);
+    }
+    vec<u8> visibility(bounds_soa.m_center_x.size());
+    vec<u32> items;
+    u64 linear_time_us = 0;
+    u64 bvh_time_us = 0;
+    u64 visible_count = 0;
+    for (u32 frame = 0; frame < frame_count; frame++) {
+        Frustum frustum = camera_frustum(f32(frame) * 0.1f);
+
+        start_time = get_timestamp_microsecond();
+        u32 linear_count = cull_bounds(frustum, bounds_soa, 0, item_count, visibility.data());
+        linear_time_us += get_timestamp_microsecond() - start_time;
+
+        items.clear();
+        start_time = get_timestamp_microsecond();
+        bvh.query_frustum(frustum, &items);
+        bvh_time_us += get_timestamp_microsecond() - start_time;
+
+        if (items.size() != linear_count) {
+            logger.error("BVH frustum query returned ", items.size(), " items, linear culling ",
+                         linear_count);
+            return 1;
+        }
+        visible_count += linear_count;
+    }
+    logger.info("Frustum: BVH ", f64(bvh_time_us) / 1000.0 / frame_count, " ms, linear ",
+                f64(linear_time_us) / 1000.0 / frame_count, " ms, ",
+                visible_count / frame_count, " visible");
+
+    std::uniform_real_distribution<f32> position(-WORLD_SIZE / 2, WORLD_SIZE / 2);
+    u64 result_count = 0;
+    start_time = get_timestamp_microsecond();
+    for (u32 i = 0; i < QUERY_COUNT; i++) {
+        items.clear();
+        bvh.query_sphere(Vec3(position(rng), position(rng), position(rng)), 20.0f, &items);
+        result_count += items.size();
+    }
+    f64 sphere_us = f64(get_timestamp_microsecond() - start_time) / QUERY_COUNT;
+    logger.info("Sphere: ", sphere_us, " us per query, ", f64(result_count) / QUERY_COUNT,
+                " items per query");
+
+    result_count = 0;
+    start_time = get_timestamp_microsecond();
+    for (u32 i = 0; i < QUERY_COUNT; i++) {
+        items.clear();
+        Vec3 center(position(rng), position(rng), position(rng));
+        Vec3 extent(20, 20, 20);
+        bvh.query_aabb(Aabb{.m_min = center - extent, .m_max = center + extent}, &items);
+        result_count += items.size();
+    }
+    f64 box_us = f64(get_timestamp_microsecond() - start_time) / QUERY_COUNT;
+    logger.info("Box: ", box_us, " us per query, ", f64(result_count) / QUERY_COUNT,
+                " items per query");
+
+    vec<RayHit> hits;
+    result_count = 0;
+    start_time = get_timestamp_microsecond();
+    for (u32 i = 0; i < QUERY_COUNT; i++) {
+        hits.clear();
+        Vec3 origin(position(rng), position(rng), position(rng));
+        Vec3 direction = (Vec3(position(rng), position(rng), position(rng)) - origin).normalize();
+        bvh.query_ray(origin, direction, WORLD_SIZE, &hits);
+        result_count += hits.size();
+    }
+    f64 ray_us = f64(get_timestamp_microsecond() - start_time) / QUERY_COUNT;
+    logger.info("Ray: ", ray_us, " us per query, ", f64(result_count) / QUERY_COUNT,
+                " hits per query");
+
+    return 0;
+}
@@ -0,0 +1,96 @@
+#include "benchmark_common.h"
+#include "logger.h"
+#include "mesh.h"
+#include "mesh_simplify.h"
+
+using namespace blaz;
+
+const u32 ROW_SIZE = 16;
+const f32 SPACING = 3.0f;
+
+// Rows of dense spheres receding from the camera, drawn by a main pass and a shadow-like pass
+// looking at them from the side. The camera then moves back and forth by a small step to show
+// that the selected levels stay put.
+int main(int argc, char* argv[]) {
+    u32 renderable_count = argc > 1 ? u32(std::stoul(argv[1])) : 1024;
+    u32 frame_count = argc > 2 ? u32(std::stoul(argv[2])) : 20;
+
+    BenchmarkFixture fixture;
+    Error err = init_benchmark(&fixture, Vec3(0, 2, 10));
+    if (err) {
+        logger.error(err);
+        return 1;
+    }
+    Renderer& renderer = fixture.m_renderer;
+    Scene& scene = fixture.m_scene;
+
+    add_node(&scene,
+             Node{.m_name = "light_node",
+                  .m_position = Vec3(-60, 2, -f32(renderable_count / ROW_SIZE) * SPACING / 2),
+                  .m_rotation = Quat::from_axis_angle(Vec3(0, 1, 0), -1.5707963f)},
+             "root_node");
+    scene.m_nodes["light_node"].update_matrix();
+    renderer.create_camera(Camera{.m_name = "light_camera", .m_scene = &scene,
+                                  .m_node = "light_node"});
+    renderer.create_shader(Shader{.m_name = "lod_shader", .m_should_reload = false});
+
+    renderer.create_mesh(Mesh{.m_name = "sphere_mesh"});
+    Mesh* mesh = &renderer.m_meshes["sphere_mesh"];
+    make_uv_sphere(mesh, 128, 64);
+    generate_mesh_lods(mesh, MESH_DEFAULT_LOD_COUNT);
+    for (u32 i = 0; i < mesh->m_lods.size(); i++) {
+        logger.info("LOD ", i, ": ", mesh->m_lods[i].m_index_count / 3, " triangles, error ",
+                    mesh->m_lods[i].m_error);
+    }
+
+    for (u32 i = 0; i < renderable_count; i++) {
+        Vec3 position(f32(i % ROW_SIZE) * SPACING - ROW_SIZE * SPACING / 2, 0,
+                      -f32(i / ROW_SIZE) * SPACING);
+        add_benchmark_renderable(&fixture, i, position,
+                                 Renderable{.m_tags = {"lod"}, .m_mesh = "sphere_mesh"});
+    }
+
+    for (const char* camera : {"camera", "light_camera"}) {
+        renderer.m_passes.push_back(Pass{
+            .m_name = str(camera) + "_pass",
+            .m_type = PassType::RENDER,
+            .m_shader = "lod_shader",
+            .m_tags = {"lod"},
+            .m_camera = camera,
+        });
+    }
+
+    Node* camera_node = &scene.m_nodes["camera_node"];
+    for (bool mesh_lod : {false, true}) {
+        renderer.m_mesh_lod = mesh_lod;
+        camera_node->set_position(Vec3(0, 2, 10));
+        renderer.update();
+
+        u64 indexed_vertices = 0;
+        u64 record_time_us = 0;
+        u32 lod_changes = 0;
+        vec<u32> previous_lods;
+        for (u32 frame = 0; frame < frame_count; frame++) {
+            camera_node->translate(Vec3(0, 0, frame % 2 == 0 ? 0.05f : -0.05f));
+            renderer.update();
+            indexed_vertices += renderer.m_frame_stats.m_indexed_vertices;
+            record_time_us += renderer.m_frame_stats.m_record_time_us;
+
+            vec<u32> lods;
+            for (const DrawItem& draw_item : renderer.m_passes[0].m_plan.m_draws) {
+                lods.push_back(draw_item.m_lod);
+            }
+            for (u32 i = 0; i < previous_lods.size(); i++) {
+                lod_changes += previous_lods[i] != lods[i];
+            }
+            previous_lods = lods;
+        }
+
+        logger.info("LOD ", mesh_lod ? "on" : "off", ": ",
+                    indexed_vertices / 3 / frame_count, " triangles per frame, record ",
+                    f64(record_time_us) / 1000.0 / frame_count, " ms, ", lod_changes,
+                    " level changes while moving back and forth");
+    }
+
+    return 0;
+}
@@ -0,0 +1,64 @@
+#include "logger.h"
+#include "mesh.h"
+#include "my_time.h"
+#include "platform.h"
+#include "renderer.h"
+#include "types.h"
+
+using namespace blaz;
+
+// Loads a dense sphere written as a mesh file into a renderer, once from the mapping and once
+// copied into m_vertices and m_indices first, as meshes were loaded before mesh files could be
+// mapped. The file is written without a checksum, like shipped files. The null renderer only
+// counts the uploaded bytes, so the times are those of the load.
+static void run(const str& path, u32 load_count, bool copy) {
+    Window window;
+    Renderer renderer;
+    Error err = renderer.init(&window);
+    if (err) {
+        logger.error(err);
+        return;
+    }
+    renderer.create_mesh(Mesh{.m_name = "sphere_mesh", .m_path = path});
+
+    u64 load_time_us = 0;
+    u64 uploaded_bytes = 0;
+    for (u32 i = 0; i < load_count; i++) {
+        Mesh* mesh = &renderer.m_meshes["sphere_mesh"];
+        u64 start = get_timestamp_microsecond();
+        err = load_mesh_from_file(mesh);
+        if (err) {
+            logger.error(err);
+            return;
+        }
+        if (copy) {
+            copy_mesh_data(mesh);
+        }
+        renderer.m_frame_stats.m_buffer_bytes_uploaded = 0;
+        renderer.reload_mesh_api("sphere_mesh");
+        load_time_us += get_timestamp_microsecond() - start;
+        uploaded_bytes += renderer.m_frame_stats.m_buffer_bytes_uploaded;
+    }
+
+    logger.info(copy ? "Copied" : "Mapped", ": load and upload ",
+                f64(load_time_us) / 1000.0 / load_count, " ms, ",
+                uploaded_bytes / load_count / 1024, " KB uploaded per load");
+}
+
+int main(int argc, char* argv[]) {
+    u32 load_count = argc > 1 ? u32(std::stoul(argv[1])) : 50;
+    str path = argc > 2 ? argv[2] : "mesh_file_benchmark.mesh";
+
+    Mesh mesh = {.m_name = "sphere_mesh"};
+    make_uv_sphere(&mesh, 1024, 512);
+    Error err = export_mesh_file(path, &mesh, false);
+    if (err) {
+        logger.error(err);
+        return 1;
+    }
+    logger.info("Sphere: ", mesh.m_indices.size() / 3, " triangles");
+
+    run(path, load_count, false);
+    run(path, load_count, true);
+    return 0;
+}
@@ -0,0 +1,89 @@
+#include "benchmark_common.h"
+#include "logger.h"
+#include "mesh.h"
+
+using namespace blaz;
+
+const u32 MESH_COUNT = 64;
+const u32 MATERIAL_COUNT = 4;
+const u32 GRID_SIZE = 64;
+
+// An instanced pass over many small meshes sharing one vertex layout, drawn with separate
+// buffers per mesh, with pooled buffers, and with pooled buffers and indirect draws.
+static void run(u32 renderable_count, u32 frame_count, bool mesh_pooling,
+                bool multi_draw_indirect) {
+    BenchmarkFixture fixture;
+    Error err = init_benchmark(&fixture, Vec3(32, 32, 80));
+    if (err) {
+        logger.error(err);
+        return;
+    }
+    Renderer& renderer = fixture.m_renderer;
+    renderer.m_mesh_pooling = mesh_pooling;
+    renderer.m_multi_draw_indirect = multi_draw_indirect;
+    renderer.m_mesh_lod = false;
+    renderer.create_shader(
+        Shader{.m_name = "pool_shader", .m_instanced = true, .m_should_reload = false});
+
+    for (u32 i = 0; i < MESH_COUNT; i++) {
+        str mesh_name = "mesh_" + std::to_string(i);
+        renderer.create_mesh(Mesh{.m_name = mesh_name});
+        make_uv_sphere(&renderer.m_meshes[mesh_name], 8 + i % 16, 4 + i % 8);
+    }
+    for (u32 i = 0; i < MATERIAL_COUNT; i++) {
+        renderer.create_material(Material{
+            .m_name = "material_" + std::to_string(i),
+            .m_shader = "pool_shader",
+        });
+    }
+
+    for (u32 i = 0; i < renderable_count; i++) {
+        Vec3 position(f32(i % GRID_SIZE), f32((i / GRID_SIZE) % GRID_SIZE),
+                      -f32(i / (GRID_SIZE * GRID_SIZE)));
+        add_benchmark_renderable(&fixture, i, position,
+                                 Renderable{
+                                     .m_tags = {"pool"},
+                                     .m_material = "material_" + std::to_string(i % MATERIAL_COUNT),
+                                     .m_mesh = "mesh_" + std::to_string(i % MESH_COUNT),
+                                 });
+    }
+
+    renderer.m_passes.push_back(Pass{
+        .m_name = "pool_pass",
+        .m_type = PassType::RENDER,
+        .m_shader = "pool_shader",
+        .m_tags = {"pool"},
+        .m_camera = "camera",
+    });
+
+    u64 draw_calls = 0;
+    u64 state_changes = 0;
+    u64 instances = 0;
+    u64 record_time_us = 0;
+    Node* camera_node = &fixture.m_scene.m_nodes["camera_node"];
+    for (u32 frame = 0; frame < frame_count; frame++) {
+        camera_node->translate(Vec3(frame % 2 == 0 ? 0.05f : -0.05f, 0, 0));
+        renderer.update();
+        draw_calls += renderer.m_frame_stats.m_draw_calls;
+        state_changes += renderer.m_frame_stats.m_state_changes;
+        instances += renderer.m_frame_stats.m_instances;
+        record_time_us += renderer.m_frame_stats.m_record_time_us;
+    }
+
+    logger.info("Pooling ", mesh_pooling ? "on" : "off", ", indirect ",
+                multi_draw_indirect ? "on" : "off", ": ", renderer.m_mesh_pools.size(),
+                " pools, ", draw_calls / frame_count, " draw calls, ",
+                state_changes / frame_count, " state changes, ", instances / frame_count,
+                " instances per frame, record ", f64(record_time_us) / 1000.0 / frame_count,
+                " ms");
+}
+
+int main(int argc, char* argv[]) {
+    u32 renderable_count = argc > 1 ? u32(std::stoul(argv[1])) : 16384;
+    u32 frame_count = argc > 2 ? u32(std::stoul(argv[2])) : 20;
+
+    run(renderable_count, frame_count, false, false);
+    run(renderable_count, frame_count, true, false);
+    run(renderable_count, frame_count, true, true);
+    return 0;
+}
@@ -0,0 +1,76 @@
+#include "benchmark_common.h"
+#include "logger.h"
+#include "mesh.h"
+#include "meshlet.h"
+
+using namespace blaz;
+
+const u32 ROW_SIZE = 16;
+const f32 SPACING = 3.0f;
+
+// Rows of dense spheres in front of a camera close enough that the outer columns are cut by the
+// frustum. About half of each sphere faces away from the camera, which the normal cones catch.
+int main(int argc, char* argv[]) {
+    u32 renderable_count = argc > 1 ? u32(std::stoul(argv[1])) : 256;
+    u32 frame_count = argc > 2 ? u32(std::stoul(argv[2])) : 20;
+
+    BenchmarkFixture fixture;
+    Error err = init_benchmark(&fixture, Vec3(0, 2, 6));
+    if (err) {
+        logger.error(err);
+        return 1;
+    }
+    Renderer& renderer = fixture.m_renderer;
+    renderer.m_mesh_lod = false;
+    renderer.create_shader(Shader{.m_name = "meshlet_shader", .m_should_reload = false});
+
+    renderer.create_mesh(Mesh{.m_name = "sphere_mesh"});
+    Mesh* mesh = &renderer.m_meshes["sphere_mesh"];
+    make_uv_sphere(mesh, 128, 64);
+    build_mesh_meshlets(mesh);
+    logger.info("Sphere: ", mesh->m_indices.size() / 3, " triangles, ", mesh->m_meshlets.size(),
+                " meshlets");
+
+    for (u32 i = 0; i < renderable_count; i++) {
+        Vec3 position(f32(i % ROW_SIZE) * SPACING - ROW_SIZE * SPACING / 2, 0,
+                      -f32(i / ROW_SIZE) * SPACING);
+        add_benchmark_renderable(&fixture, i, position,
+                                 Renderable{.m_tags = {"meshlet"}, .m_mesh = "sphere_mesh"});
+    }
+
+    renderer.m_passes.push_back(Pass{
+        .m_name = "meshlet_pass",
+        .m_type = PassType::RENDER,
+        .m_shader = "meshlet_shader",
+        .m_tags = {"meshlet"},
+        .m_camera = "camera",
+    });
+
+    Node* camera_node = &fixture.m_scene.m_nodes["camera_node"];
+    for (bool meshlet_culling : {false, true}) {
+        renderer.m_meshlet_culling = meshlet_culling;
+
+        u64 indexed_vertices = 0;
+        u64 draw_calls = 0;
+        u64 meshlets_culled = 0;
+        u64 meshlets_drawn = 0;
+        u64 record_time_us = 0;
+        for (u32 frame = 0; frame < frame_count; frame++) {
+            camera_node->translate(Vec3(frame % 2 == 0 ? 0.05f : -0.05f, 0, 0));
+            renderer.update();
+            indexed_vertices += renderer.m_frame_stats.m_indexed_vertices;
+            draw_calls += renderer.m_frame_stats.m_draw_calls;
+            meshlets_culled += renderer.m_frame_stats.m_meshlets_culled;
+            meshlets_drawn += renderer.m_frame_stats.m_meshlets_drawn;
+            record_time_us += renderer.m_frame_stats.m_record_time_us;
+        }
+
+        logger.info("Meshlet culling ", meshlet_culling ? "on" : "off", ": ",
+                    indexed_vertices / 3 / frame_count, " triangles per frame, ",
+                    draw_calls / frame_count, " draw calls, ", meshlets_drawn / frame_count,
+                    " meshlets drawn, ", meshlets_culled / frame_count, " culled, record ",
+                    f64(record_time_us) / 1000.0 / frame_count, " ms");
+    }
+
+    return 0;
+}
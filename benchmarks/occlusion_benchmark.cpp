@@ -0,0 +1,90 @@
+#include <random>
+
+#include "logger.h"
+#include "mesh.h"
+#include "my_time.h"
+#include "occlusion.h"
+#include "renderer.h"
+#include "thread_pool.h"
+#include "types.h"
+
+using namespace blaz;
+
+const f32 WORLD_SIZE = 200.0f;
+
+// A corridor of walls in front of the camera hiding most of a field of boxes.
+int main(int argc, char* argv[]) {
+    u32 box_count = argc > 1 ? u32(std::stoul(argv[1])) : 100000;
+    u32 wall_count = argc > 2 ? u32(std::stoul(argv[2])) : 64;
+    u32 frame_count = argc > 3 ? u32(std::stoul(argv[3])) : 20;
+    u32 max_thread_count = argc > 4 ? u32(std::stoul(argv[4])) : default_worker_count() + 1;
+
+    Mesh wall_mesh;
+    make_cube(&wall_mesh);
+    u32 stride;
+    u32 position_offset;
+    mesh_position_layout(&wall_mesh, &stride, &position_offset);
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<f32> position(-WORLD_SIZE / 2, WORLD_SIZE / 2);
+    vec<Mat4> wall_matrices;
+    for (u32 i = 0; i < wall_count; i++) {
+        Vec3 wall_position(position(rng), position(rng) * 0.1f, position(rng) * 0.5f);
+        wall_matrices.push_back(scale_3d(Vec3(20, 20, 1)) * translate_3d(wall_position));
+    }
+    vec<Aabb> boxes(box_count);
+    for (Aabb& box : boxes) {
+        Vec3 center(position(rng), position(rng) * 0.1f, position(rng) - WORLD_SIZE / 2);
+        box = Aabb{.m_min = center - Vec3(0.5f, 0.5f, 0.5f),
+                   .m_max = center + Vec3(0.5f, 0.5f, 0.5f)};
+    }
+
+    Mat4 view = translate_3d(Vec3(0, 0, -WORLD_SIZE));
+    Mat4 projection = perspective_projection(1.5f, 2.0f, 0.1f, WORLD_SIZE * 4);
+
+    vec<u32> thread_counts;
+    for (u32 thread_count = 1; thread_count < max_thread_count; thread_count *= 2) {
+        thread_counts.push_back(thread_count);
+    }
+    thread_counts.push_back(max_thread_count);
+
+    logger.info("Occlusion buffer ", OCCLUSION_BUFFER_WIDTH, "x", OCCLUSION_BUFFER_HEIGHT, ", ",
+                wall_count, " walls, ", box_count, " boxes, ", frame_count, " frames per run");
+
+    OcclusionBuffer buffer;
+    buffer.resize(OCCLUSION_BUFFER_WIDTH, OCCLUSION_BUFFER_HEIGHT);
+    for (u32 thread_count : thread_counts) {
+        ThreadPool thread_pool;
+        thread_pool.init(thread_count - 1);
+
+        u64 rasterize_time_us = 0;
+        u64 test_time_us = 0;
+        u32 occluded_count = 0;
+        for (u32 frame = 0; frame < frame_count; frame++) {
+            u64 start_time = get_timestamp_microsecond();
+            buffer.begin(view * projection);
+            for (const Mat4& matrix : wall_matrices) {
+                buffer.add_occluder(matrix, wall_mesh.m_vertices, stride, position_offset,
+                                    wall_mesh.m_indices.data(), u32(wall_mesh.m_indices.size()));
+            }
+            buffer.rasterize(&thread_pool);
+            rasterize_time_us += get_timestamp_microsecond() - start_time;
+
+            start_time = get_timestamp_microsecond();
+            occluded_count = 0;
+            for (const Aabb& box : boxes) {
+                occluded_count += !buffer.is_visible(box);
+            }
+            test_time_us += get_timestamp_microsecond() - start_time;
+        }
+
+        logger.info("threads ", thread_count, ": rasterize ",
+                    f64(rasterize_time_us) / 1000.0 / frame_count, " ms (",
+                    buffer.m_triangles.size(), " triangles), test ",
+                    f64(test_time_us) / 1000.0 / frame_count, " ms, ",
+                    f64(test_time_us) * 1000.0 / (f64(box_count) * frame_count),
+                    " ns per box, ", occluded_count, " occluded");
+    }
+
+    return 0;
+}
@@ -0,0 +1,76 @@
+#include "benchmark_common.h"
+#include "logger.h"
+#include "my_time.h"
+
+using namespace blaz;
+
+// Stands in for gameplay and physics: moves every node and the camera, and feeds a uniform.
+static void simulate(Renderer* renderer, Scene* scene, u32 frame) {
+    f32 offset = f32(frame % 2 == 0 ? 1 : -1) * 0.01f;
+    for (u32 i = 1; i < scene->m_nodes.size(); i++) {
+        scene->m_nodes[i].translate(Vec3(0, offset, 0));
+    }
+    renderer->set_uniform_buffer_data("u_bench", {{"u_color", Vec3(f32(frame % 256), 0, 0)}});
+}
+
+int main(int argc, char* argv[]) {
+    u32 renderable_count = argc > 1 ? u32(std::stoul(argv[1])) : 50000;
+    u32 frame_count = argc > 2 ? u32(std::stoul(argv[2])) : 20;
+    bool throttle = !(argc > 3 && str(argv[3]) == "unthrottled");
+
+    BenchmarkFixture fixture;
+    Error err = init_benchmark(&fixture, Vec3(0, 0, 50));
+    if (err) {
+        logger.error(err);
+        return 1;
+    }
+    Renderer& renderer = fixture.m_renderer;
+    Scene& scene = fixture.m_scene;
+    renderer.set_worker_count(0);
+    setup_grid_scene(&fixture, renderable_count);
+    renderer.update();
+
+    logger.info("Simulating and rendering ", renderable_count, " renderables, ", frame_count,
+                " frames per run");
+
+    u64 sim_time_us = 0;
+    u64 render_time_us = 0;
+    u64 start_time_us = get_timestamp_microsecond();
+    for (u32 frame = 0; frame < frame_count; frame++) {
+        u64 sim_start_time_us = get_timestamp_microsecond();
+        simulate(&renderer, &scene, frame);
+        u64 render_start_time_us = get_timestamp_microsecond();
+        renderer.update();
+        sim_time_us += render_start_time_us - sim_start_time_us;
+        render_time_us += get_timestamp_microsecond() - render_start_time_us;
+    }
+    f64 serial_ms = f64(get_timestamp_microsecond() - start_time_us) / 1000.0 / frame_count;
+    f64 sim_ms = f64(sim_time_us) / 1000.0 / frame_count;
+    f64 render_ms = f64(render_time_us) / 1000.0 / frame_count;
+    logger.info("serial: frame ", serial_ms, " ms (sim ", sim_ms, " ms, render ", render_ms,
+                " ms)");
+
+    u32 frame_number = renderer.m_frame_number;
+    renderer.m_pipeline_throttle = throttle;
+    err = renderer.start_render_thread();
+    if (err) {
+        logger.error(err);
+        return 1;
+    }
+    start_time_us = get_timestamp_microsecond();
+    for (u32 frame = 0; frame < frame_count; frame++) {
+        simulate(&renderer, &scene, frame);
+        renderer.update();
+    }
+    f64 pipelined_ms = f64(get_timestamp_microsecond() - start_time_us) / 1000.0 / frame_count;
+    renderer.stop_render_thread();
+
+    logger.info("pipelined: frame ", pipelined_ms, " ms, ideal ", std::max(sim_ms, render_ms),
+                " ms, rendered ", renderer.m_frame_number - frame_number, " frames");
+
+    if (renderer.m_frame_number == frame_number) {
+        logger.error("Render thread did not render any frame");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,146 @@
+#include <cstring>
+
+#include "benchmark_common.h"
+#include "logger.h"
+#include "mesh.h"
+#include "thread_pool.h"
+
+using namespace blaz;
+
+static bool same_commands(const CommandBuffer& a, const CommandBuffer& b) {
+    return a.m_commands.size() == b.m_commands.size() && a.m_data == b.m_data &&
+           std::memcmp(a.m_commands.data(), b.m_commands.data(),
+                       a.m_commands.size() * sizeof(Command)) == 0;
+}
+
+const u32 POOLED_MESH_COUNT = 48;
+const u32 POOLED_MATERIAL_COUNT = 32;
+
+// Instanced draws of pooled meshes, merged into indirect draws. Each material draws every mesh,
+// so there are more batches than fit in a recording chunk and indirect draws straddle chunks.
+static void setup_pooled_scene(BenchmarkFixture* fixture, u32 renderable_count) {
+    Renderer* renderer = &fixture->m_renderer;
+    renderer->m_mesh_pooling = true;
+    renderer->m_multi_draw_indirect = true;
+    renderer->m_mesh_lod = false;
+    renderer->create_shader(
+        Shader{.m_name = "pooled_shader", .m_instanced = true, .m_should_reload = false});
+
+    for (u32 i = 0; i < POOLED_MESH_COUNT; i++) {
+        str mesh_name = "mesh_" + std::to_string(i);
+        renderer->create_mesh(Mesh{.m_name = mesh_name});
+        make_uv_sphere(&renderer->m_meshes[mesh_name], 8 + i % 16, 4 + i % 8);
+    }
+    for (u32 i = 0; i < POOLED_MATERIAL_COUNT; i++) {
+        renderer->create_material(Material{
+            .m_name = "material_" + std::to_string(i),
+            .m_shader = "pooled_shader",
+        });
+    }
+
+    for (u32 i = 0; i < renderable_count; i++) {
+        Vec3 position(f32(i % 64), f32((i / 64) % 64), -f32(i / (64 * 64)));
+        add_benchmark_renderable(
+            fixture, i, position,
+            Renderable{
+                .m_tags = {"pooled"},
+                .m_material =
+                    "material_" + std::to_string((i / POOLED_MESH_COUNT) % POOLED_MATERIAL_COUNT),
+                .m_mesh = "mesh_" + std::to_string(i % POOLED_MESH_COUNT),
+            });
+    }
+
+    renderer->m_passes.push_back(Pass{
+        .m_name = "pooled_pass",
+        .m_type = PassType::RENDER,
+        .m_shader = "pooled_shader",
+        .m_tags = {"pooled"},
+        .m_camera = "camera",
+    });
+}
+
+// Records the scene of the fixture with more and more threads. Returns false when the commands
+// differ from the single threaded ones.
+static bool run(BenchmarkFixture* fixture, u32 frame_count, const vec<u32>& thread_counts) {
+    Renderer& renderer = fixture->m_renderer;
+    CommandBuffer reference_commands;
+    f64 single_thread_ms = 0;
+    for (u32 thread_count : thread_counts) {
+        renderer.set_worker_count(thread_count - 1);
+
+        Node* camera_node = &fixture->m_scene.m_nodes["camera_node"];
+        camera_node->set_position(Vec3(0, 0, 50));
+        renderer.update();
+
+        u64 record_time_us = 0;
+        u64 execute_time_us = 0;
+        for (u32 frame = 0; frame < frame_count; frame++) {
+            camera_node->translate(Vec3(0, 0, 0.01f));
+            renderer.update();
+            record_time_us += renderer.m_frame_stats.m_record_time_us;
+            execute_time_us += renderer.m_frame_stats.m_execute_time_us;
+        }
+
+        const CommandBuffer& commands = renderer.m_passes[0].m_plan.m_commands;
+        bool identical = true;
+        if (thread_count == 1) {
+            reference_commands = commands;
+        } else {
+            identical = same_commands(reference_commands, commands);
+        }
+
+        f64 record_ms = f64(record_time_us) / 1000.0 / frame_count;
+        f64 execute_ms = f64(execute_time_us) / 1000.0 / frame_count;
+        if (thread_count == 1) {
+            single_thread_ms = record_ms;
+        }
+        logger.info("threads ", thread_count, ": record ", record_ms, " ms, execute ", execute_ms,
+                    " ms, speedup ", single_thread_ms / record_ms, "x, draws ",
+                    renderer.m_frame_stats.m_draw_calls,
+                    identical ? "" : ", OUTPUT DIFFERS FROM SINGLE THREAD");
+        if (!identical) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    u32 renderable_count = argc > 1 ? u32(std::stoul(argv[1])) : 100000;
+    u32 frame_count = argc > 2 ? u32(std::stoul(argv[2])) : 20;
+    u32 max_thread_count = argc > 3 ? u32(std::stoul(argv[3])) : default_worker_count() + 1;
+
+    vec<u32> thread_counts;
+    for (u32 thread_count = 1; thread_count < max_thread_count; thread_count *= 2) {
+        thread_counts.push_back(thread_count);
+    }
+    thread_counts.push_back(max_thread_count);
+
+    logger.info("Recording ", renderable_count, " renderables, ", frame_count, " frames per run");
+
+    {
+        BenchmarkFixture fixture;
+        Error err = init_benchmark(&fixture, Vec3(0, 0, 50));
+        if (err) {
+            logger.error(err);
+            return 1;
+        }
+        setup_grid_scene(&fixture, renderable_count);
+        if (!run(&fixture, frame_count, thread_counts)) {
+            return 1;
+        }
+    }
+
+    logger.info("Pooled meshes with indirect draws");
+    BenchmarkFixture fixture;
+    Error err = init_benchmark(&fixture, Vec3(0, 0, 50));
+    if (err) {
+        logger.error(err);
+        return 1;
+    }
+    setup_pooled_scene(&fixture, renderable_count);
+    if (!run(&fixture, frame_count, thread_counts)) {
+        return 1;
+    }
+    return 0;
+}
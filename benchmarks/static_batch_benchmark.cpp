@@ -0,0 +1,84 @@
+#include "benchmark_common.h"
+#include "logger.h"
+#include "mesh.h"
+
+using namespace blaz;
+
+const u32 GRID_SIZE = 32;
+const u32 MATERIAL_COUNT = 2;
+
+// A floor of small static cubes, like a level built from wall and floor pieces, seen by a camera
+// looking along it so that part of the floor is outside the frustum. Drawn once piece by piece
+// and once merged into static batches.
+static void run(u32 renderable_count, u32 frame_count, bool static_batching) {
+    BenchmarkFixture fixture;
+    Error err = init_benchmark(&fixture, Vec3(0, 2, 4));
+    if (err) {
+        logger.error(err);
+        return;
+    }
+    Renderer& renderer = fixture.m_renderer;
+    renderer.m_static_batching = static_batching;
+    renderer.m_mesh_lod = false;
+    renderer.create_shader(Shader{.m_name = "static_shader", .m_should_reload = false});
+
+    renderer.create_mesh(Mesh{.m_name = "cube_mesh"});
+    make_cube(&renderer.m_meshes["cube_mesh"]);
+    for (u32 i = 0; i < MATERIAL_COUNT; i++) {
+        renderer.create_material(Material{
+            .m_name = "material_" + std::to_string(i),
+            .m_shader = "static_shader",
+        });
+    }
+
+    for (u32 i = 0; i < renderable_count; i++) {
+        Vec3 position(f32(i % GRID_SIZE) * 2 - f32(GRID_SIZE), -1,
+                      -f32((i / GRID_SIZE) % GRID_SIZE) * 2);
+        add_benchmark_renderable(&fixture, i, position,
+                                 Renderable{
+                                     .m_tags = {"static"},
+                                     .m_material = "material_" + std::to_string(i % MATERIAL_COUNT),
+                                     .m_mesh = "cube_mesh",
+                                     .m_static = true,
+                                 });
+    }
+
+    renderer.build_static_batches();
+
+    renderer.m_passes.push_back(Pass{
+        .m_name = "static_pass",
+        .m_type = PassType::RENDER,
+        .m_shader = "static_shader",
+        .m_tags = {"static"},
+        .m_camera = "camera",
+    });
+
+    u64 draw_calls = 0;
+    u64 indexed_vertices = 0;
+    u64 meshlets_culled = 0;
+    u64 record_time_us = 0;
+    Node* camera_node = &fixture.m_scene.m_nodes["camera_node"];
+    for (u32 frame = 0; frame < frame_count; frame++) {
+        camera_node->translate(Vec3(frame % 2 == 0 ? 0.05f : -0.05f, 0, 0));
+        renderer.update();
+        draw_calls += renderer.m_frame_stats.m_draw_calls;
+        indexed_vertices += renderer.m_frame_stats.m_indexed_vertices;
+        meshlets_culled += renderer.m_frame_stats.m_meshlets_culled;
+        record_time_us += renderer.m_frame_stats.m_record_time_us;
+    }
+
+    logger.info("Static batching ", static_batching ? "on" : "off", ": ",
+                renderer.m_static_batch_count, " batches, ", draw_calls / frame_count,
+                " draw calls, ", indexed_vertices / 3 / frame_count, " triangles, ",
+                meshlets_culled / frame_count, " parts culled per frame, record ",
+                f64(record_time_us) / 1000.0 / frame_count, " ms");
+}
+
+int main(int argc, char* argv[]) {
+    u32 renderable_count = argc > 1 ? u32(std::stoul(argv[1])) : 1024;
+    u32 frame_count = argc > 2 ? u32(std::stoul(argv[2])) : 20;
+
+    run(renderable_count, frame_count, false);
+    run(renderable_count, frame_count, true);
+    return 0;
+}
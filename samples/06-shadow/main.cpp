@@ -5,6 +5,22 @@
 
 using namespace blaz;
 
+struct LightBlock {
+    static constexpr const char* NAME = "u_light";
+    Vec3 m_position;
+    f32 m_pad0 = 0;
+    Mat4 m_view_mat;
+    Mat4 m_projection_mat;
+
+    static constexpr auto uniforms() {
+        return std::array{
+            UNIFORM_FIELD(LightBlock, "u_light_position", m_position, UNIFORM_VEC3),
+            UNIFORM_FIELD(LightBlock, "u_light_view_mat", m_view_mat, UNIFORM_MAT4),
+            UNIFORM_FIELD(LightBlock, "u_light_projection_mat", m_projection_mat, UNIFORM_MAT4),
+        };
+    }
+};
+
 int main() {
     Window window;
     Error err = window.init("06-shadow");
@@ -35,25 +51,7 @@ int main() {
     make_cube(&renderer.m_meshes["cube_mesh"]);
     make_plane(&renderer.m_meshes["plane_mesh"]);
 
-    renderer.create_uniform_buffer(UniformBuffer{
-        .m_name = "u_light",
-        .m_uniforms =
-            {
-                Uniform{
-                    .m_name = "u_light_position",
-                    .m_type = UNIFORM_VEC3,
-                },
-                Uniform{
-                    .m_name = "u_light_view_mat",
-                    .m_type = UNIFORM_MAT4,
-                },
-                Uniform{
-                    .m_name = "u_light_projection_mat",
-                    .m_type = UNIFORM_MAT4,
-                },
-            },
-        .m_should_reload = true,
-    });
+    renderer.create_uniform_buffer<LightBlock>();
 
     Camera* light_camera = &renderer.m_cameras["light_camera"];
     Vec3 light_pos = Vec3(3, 4, 6);
@@ -63,10 +61,11 @@ int main() {
         Quat::look_at(light_pos, Vec3(0, 0, 0), Vec3(0, 1, 0)));
     light_camera->update_projection_matrix();
     light_camera->update_view_matrix();
-    renderer.set_uniform_buffer_data(
-        "u_light", {{"u_light_position", scene.m_nodes[light_camera->m_node].m_position},
-                    {"u_light_view_mat", light_camera->m_view_matrix},
-                    {"u_light_projection_mat", light_camera->m_projection_matrix}});
+    LightBlock light_block;
+    light_block.m_position = scene.m_nodes[light_camera->m_node].m_position;
+    light_block.m_view_mat = light_camera->m_view_matrix;
+    light_block.m_projection_mat = light_camera->m_projection_matrix;
+    renderer.set_uniform_buffer(light_block);
 
     game.main_camera->m_orbit_pan_sensitivity = 0.005f;
     game.main_camera->m_orbit_spherical_angles = Vec2(f32(PI_HALF), f32(PI_HALF) / 2.0);
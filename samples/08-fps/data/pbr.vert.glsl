@@ -11,6 +11,14 @@ layout(std140, binding = 0) uniform u_mat {
     mat4 u_projection_mat;
 };
 
+// Defined by the backends that draw instanced, otherwise every draw sets u_model_mat.
+#ifdef INSTANCING
+layout(location = 12) in mat4 a_instance_model_mat;
+#define MODEL_MAT a_instance_model_mat
+#else
+#define MODEL_MAT u_model_mat
+#endif
+
 layout(std140, binding = 2) uniform u_light {
     vec3 u_light_position;
     mat4 u_light_view_mat;
@@ -25,11 +33,11 @@ layout(location = 3) out vec2 v_texcoord;
 layout(location = 4) out vec4 v_light_space_position;
 
 void main() {
-    vec3 world_position = vec3(u_model_mat * vec4(a_position, 1.0));
+    vec3 world_position = vec3(MODEL_MAT * vec4(a_position, 1.0));
     v_world_position = world_position;
     gl_Position = u_projection_mat * u_view_mat * vec4(world_position, 1.0);
     v_light_space_position = u_light_projection_mat * u_light_view_mat * vec4(world_position, 1.0);
-    mat3 inv_model = mat3(transpose(inverse(u_model_mat)));
+    mat3 inv_model = mat3(transpose(inverse(MODEL_MAT)));
     v_world_normal = inv_model * a_normal;
     v_world_tangent = inv_model * a_tangent;
     v_texcoord = a_texcoord;
@@ -6,8 +6,12 @@ layout(location = 0) out vec4 o_color;
 
 layout(binding = 0) uniform sampler2D u_sampler_main;
 
+layout(std140, binding = 1) uniform u_resolution {
+    vec2 u_render_scale;
+};
+
 void main() {
-    vec3 color = texture(u_sampler_main, v_texcoord).rgb;
+    vec3 color = texture(u_sampler_main, v_texcoord * u_render_scale).rgb;
 
     // color = pow(color, vec3(1.0 / 2.2));
 
@@ -8,7 +8,15 @@ layout(std140, binding = 0) uniform u_mat {
     mat4 u_projection_mat;
 };
 
+// Defined by the backends that draw instanced, otherwise every draw sets u_model_mat.
+#ifdef INSTANCING
+layout(location = 12) in mat4 a_instance_model_mat;
+#define MODEL_MAT a_instance_model_mat
+#else
+#define MODEL_MAT u_model_mat
+#endif
+
 void main() {
-    vec3 world_position = vec3(u_model_mat * vec4(a_position, 1.0));
+    vec3 world_position = vec3(MODEL_MAT * vec4(a_position, 1.0));
     gl_Position = u_projection_mat * u_view_mat * vec4(world_position, 1.0);
 }
\ No newline at end of file
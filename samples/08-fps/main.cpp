@@ -5,6 +5,52 @@
 
 using namespace blaz;
 
+struct LightBlock {
+    static constexpr const char* NAME = "u_light";
+    Vec3 m_position;
+    f32 m_pad0 = 0;
+    Mat4 m_view_mat;
+    Mat4 m_projection_mat;
+    Vec3 m_color;
+    f32 m_pad1 = 0;
+
+    static constexpr auto uniforms() {
+        return std::array{
+            UNIFORM_FIELD(LightBlock, "u_light_position", m_position, UNIFORM_VEC3),
+            UNIFORM_FIELD(LightBlock, "u_light_view_mat", m_view_mat, UNIFORM_MAT4),
+            UNIFORM_FIELD(LightBlock, "u_light_projection_mat", m_projection_mat, UNIFORM_MAT4),
+            UNIFORM_FIELD(LightBlock, "u_light_color", m_color, UNIFORM_VEC3),
+        };
+    }
+};
+
+struct MaterialBlock {
+    static constexpr const char* NAME = "u_material";
+    Vec3 m_albedo;
+    f32 m_pad0 = 0;
+
+    static constexpr auto uniforms() {
+        return std::array{
+            UNIFORM_FIELD(MaterialBlock, "u_albedo", m_albedo, UNIFORM_VEC3),
+        };
+    }
+};
+
+struct CameraBlock {
+    static constexpr const char* NAME = "u_camera";
+    Vec3 m_camera_position;
+    f32 m_pad0 = 0;
+    Vec3 m_skydome_position;
+    f32 m_pad1 = 0;
+
+    static constexpr auto uniforms() {
+        return std::array{
+            UNIFORM_FIELD(CameraBlock, "u_camera_position", m_camera_position, UNIFORM_VEC3),
+            UNIFORM_FIELD(CameraBlock, "u_skydome_position", m_skydome_position, UNIFORM_VEC3),
+        };
+    }
+};
+
 int main() {
     Window window;
     Error err = window.init("08-fps");
@@ -39,41 +85,8 @@ int main() {
     make_plane(&renderer.m_meshes["plane_mesh"]);
     make_uv_sphere(&renderer.m_meshes["sphere_mesh"], 32, 32);
 
-    renderer.create_uniform_buffer(UniformBuffer{
-        .m_name = "u_light",
-        .m_uniforms =
-            {
-                Uniform{
-                    .m_name = "u_light_position",
-                    .m_type = UNIFORM_VEC3,
-                },
-                Uniform{
-                    .m_name = "u_light_view_mat",
-                    .m_type = UNIFORM_MAT4,
-                },
-                Uniform{
-                    .m_name = "u_light_projection_mat",
-                    .m_type = UNIFORM_MAT4,
-                },
-                Uniform{
-                    .m_name = "u_light_color",
-                    .m_type = UNIFORM_VEC3,
-                },
-            },
-        .m_should_reload = true,
-    });
-
-    renderer.create_uniform_buffer(UniformBuffer{
-        .m_name = "u_material",
-        .m_uniforms =
-            {
-                Uniform{
-                    .m_name = "u_albedo",
-                    .m_type = UNIFORM_VEC3,
-                },
-            },
-        .m_should_reload = true,
-    });
+    renderer.create_uniform_buffer<LightBlock>();
+    renderer.create_uniform_buffer<MaterialBlock>();
 
     Camera* light_camera = &renderer.m_cameras["light_camera"];
     Vec3 light_pos = Vec3(-2, 4, -1);
@@ -83,11 +96,12 @@ int main() {
         Quat::look_at(light_pos, Vec3(0, 0, 0), Vec3(0, 1, 0)));
     light_camera->update_projection_matrix();
     light_camera->update_view_matrix();
-    renderer.set_uniform_buffer_data(
-        "u_light", {{"u_light_position", scene.m_nodes[light_camera->m_node].m_position},
-                    {"u_light_view_mat", light_camera->m_view_matrix},
-                    {"u_light_projection_mat", light_camera->m_projection_matrix},
-                    {"u_light_color", Vec3(50, 50, 50)}});
+    LightBlock light_block;
+    light_block.m_position = scene.m_nodes[light_camera->m_node].m_position;
+    light_block.m_view_mat = light_camera->m_view_matrix;
+    light_block.m_projection_mat = light_camera->m_projection_matrix;
+    light_block.m_color = Vec3(50, 50, 50);
+    renderer.set_uniform_buffer(light_block);
 
     game.main_camera->m_fps_yaw = f32(PI_HALF);
     game.main_camera->m_fps_pitch = 0.0f;
@@ -97,28 +111,16 @@ int main() {
         game.main_camera->fps_mouse_move(delta);
     };
 
-    renderer.create_uniform_buffer(UniformBuffer{
-        .m_name = "u_camera",
-        .m_uniforms =
-            {
-                Uniform{
-                    .m_name = "u_camera_position",
-                    .m_type = UNIFORM_VEC3,
-                },
-                Uniform{
-                    .m_name = "u_skydome_position",
-                    .m_type = UNIFORM_VEC3,
-                },
-            },
-        .m_should_reload = true,
-    });
-
-    game.m_main_loop = [&game]() {
+    renderer.create_uniform_buffer<CameraBlock>();
+
+    u32 skydome_node = scene.m_nodes.index_of("skydome_node");
+    game.m_main_loop = [&game, skydome_node]() {
         if (game.m_window->event_loop()) {
-            game.m_renderer->set_uniform_buffer_data(
-                "u_camera",
-                {{"u_camera_position", game.m_scene->m_nodes[game.main_camera->m_node].m_position},
-                 {"u_skydome_position", game.m_scene->m_nodes["skydome_node"].m_position}});
+            CameraBlock camera_block;
+            camera_block.m_camera_position =
+                game.m_scene->m_nodes[game.main_camera->m_node].m_position;
+            camera_block.m_skydome_position = game.m_scene->m_nodes[skydome_node].m_position;
+            game.m_renderer->set_uniform_buffer(camera_block);
 
             Vec3 forward(-cos(game.main_camera->m_fps_yaw), 0, -sin(game.main_camera->m_fps_yaw));
             Vec3 right(sin(game.main_camera->m_fps_yaw), 0, -cos(game.main_camera->m_fps_yaw));
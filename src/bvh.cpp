@@ -0,0 +1,384 @@
+#include "bvh.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace blaz {
+
+const u32 BVH_SAH_BINS = 16;
+const u32 BVH_INVALID = UINT32_MAX;
+
+struct BvhBuildTask {
+    u32 m_node;
+    u32 m_begin;
+    u32 m_end;
+};
+
+// Binned SAH over the item centroids. Returns the first item of the right child, or the middle
+// when every split is degenerate (all centroids in the same bin).
+static u32 sah_partition(vec<u32>& items, const vec<Aabb>& item_bounds, u32 begin, u32 end) {
+    Aabb centroid_bounds{.m_min = item_bounds[items[begin]].center(),
+                         .m_max = item_bounds[items[begin]].center()};
+    for (u32 i = begin + 1; i < end; i++) {
+        Vec3 center = item_bounds[items[i]].center();
+        centroid_bounds = centroid_bounds.merge(Aabb{.m_min = center, .m_max = center});
+    }
+
+    f32 best_cost = INFINITY;
+    u32 best_axis = 0;
+    u32 best_split = 0;
+    for (u32 axis = 0; axis < 3; axis++) {
+        f32 axis_min = centroid_bounds.m_min.v[axis];
+        f32 axis_extent = centroid_bounds.m_max.v[axis] - axis_min;
+        if (axis_extent <= 0) {
+            continue;
+        }
+
+        Aabb bin_bounds[BVH_SAH_BINS];
+        u32 bin_counts[BVH_SAH_BINS] = {};
+        for (u32 i = begin; i < end; i++) {
+            const Aabb& bounds = item_bounds[items[i]];
+            u32 bin = std::min(u32((bounds.center().v[axis] - axis_min) / axis_extent *
+                                   BVH_SAH_BINS),
+                               BVH_SAH_BINS - 1);
+            bin_bounds[bin] = bin_counts[bin] == 0 ? bounds : bin_bounds[bin].merge(bounds);
+            bin_counts[bin]++;
+        }
+
+        f32 right_areas[BVH_SAH_BINS] = {};
+        u32 right_counts[BVH_SAH_BINS] = {};
+        Aabb right_bounds;
+        u32 right_count = 0;
+        for (u32 bin = BVH_SAH_BINS - 1; bin > 0; bin--) {
+            if (bin_counts[bin] > 0) {
+                right_bounds = right_count == 0 ? bin_bounds[bin]
+                                                : right_bounds.merge(bin_bounds[bin]);
+                right_count += bin_counts[bin];
+            }
+            right_areas[bin] = right_count > 0 ? right_bounds.surface_area() : 0;
+            right_counts[bin] = right_count;
+        }
+
+        Aabb left_bounds;
+        u32 left_count = 0;
+        for (u32 split = 1; split < BVH_SAH_BINS; split++) {
+            if (bin_counts[split - 1] > 0) {
+                left_bounds = left_count == 0 ? bin_bounds[split - 1]
+                                              : left_bounds.merge(bin_bounds[split - 1]);
+                left_count += bin_counts[split - 1];
+            }
+            if (left_count == 0 || right_counts[split] == 0) {
+                continue;
+            }
+            f32 cost = left_bounds.surface_area() * left_count +
+                       right_areas[split] * right_counts[split];
+            if (cost < best_cost) {
+                best_cost = cost;
+                best_axis = axis;
+                best_split = split;
+            }
+        }
+    }
+
+    if (best_split == 0) {
+        return begin + (end - begin) / 2;
+    }
+
+    f32 axis_min = centroid_bounds.m_min.v[best_axis];
+    f32 axis_extent = centroid_bounds.m_max.v[best_axis] - axis_min;
+    auto middle = std::partition(items.begin() + begin, items.begin() + end, [&](u32 item) {
+        u32 bin = std::min(u32((item_bounds[item].center().v[best_axis] - axis_min) /
+                               axis_extent * BVH_SAH_BINS),
+                           BVH_SAH_BINS - 1);
+        return bin < best_split;
+    });
+    return u32(middle - items.begin());
+}
+
+void Bvh::build(const vec<Aabb>& item_bounds, const vec<bool>& item_valid) {
+    m_generation++;
+    m_item_bounds = item_bounds;
+    m_item_leaves.assign(item_bounds.size(), BVH_INVALID);
+    m_nodes.clear();
+    m_root = BVH_INVALID;
+    m_refit_count = 0;
+
+    vec<u32> items;
+    for (u32 i = 0; i < item_bounds.size(); i++) {
+        if (item_valid[i]) {
+            items.push_back(i);
+        }
+    }
+    if (items.empty()) {
+        return;
+    }
+
+    m_nodes.reserve(items.size() * 2 - 1);
+    m_root = 0;
+    m_nodes.push_back(BvhNode{});
+    vec<BvhBuildTask> tasks = {{.m_node = 0, .m_begin = 0, .m_end = u32(items.size())}};
+    while (!tasks.empty()) {
+        BvhBuildTask task = tasks.back();
+        tasks.pop_back();
+
+        Aabb bounds = m_item_bounds[items[task.m_begin]];
+        for (u32 i = task.m_begin + 1; i < task.m_end; i++) {
+            bounds = bounds.merge(m_item_bounds[items[i]]);
+        }
+        m_nodes[task.m_node].m_bounds = bounds;
+
+        if (task.m_end - task.m_begin == 1) {
+            m_nodes[task.m_node].m_item = items[task.m_begin];
+            m_item_leaves[items[task.m_begin]] = task.m_node;
+            continue;
+        }
+
+        u32 middle = sah_partition(items, m_item_bounds, task.m_begin, task.m_end);
+        u32 left = u32(m_nodes.size());
+        u32 right = left + 1;
+        m_nodes.push_back(BvhNode{.m_parent = task.m_node});
+        m_nodes.push_back(BvhNode{.m_parent = task.m_node});
+        m_nodes[task.m_node].m_left = left;
+        m_nodes[task.m_node].m_right = right;
+        tasks.push_back({.m_node = left, .m_begin = task.m_begin, .m_end = middle});
+        tasks.push_back({.m_node = right, .m_begin = middle, .m_end = task.m_end});
+    }
+}
+
+// Refits the leaf of the item, then its ancestors until one of them keeps the same bounds.
+void Bvh::update(u32 item, const Aabb& bounds) {
+    m_item_bounds[item] = bounds;
+    u32 node = m_item_leaves[item];
+    if (node == BVH_INVALID) {
+        return;
+    }
+    m_refit_count++;
+
+    m_nodes[node].m_bounds = bounds;
+    node = m_nodes[node].m_parent;
+    while (node != BVH_INVALID) {
+        BvhNode& parent = m_nodes[node];
+        Aabb merged = m_nodes[parent.m_left].m_bounds.merge(m_nodes[parent.m_right].m_bounds);
+        if (merged == parent.m_bounds) {
+            break;
+        }
+        parent.m_bounds = merged;
+        node = parent.m_parent;
+    }
+}
+
+// Sum of the node surface areas relative to the root, which is proportional to the expected
+// number of nodes visited by a random ray.
+f32 Bvh::sah_cost() const {
+    if (m_root == BVH_INVALID) {
+        return 0;
+    }
+    f32 area = 0;
+    for (const BvhNode& node : m_nodes) {
+        area += node.m_bounds.surface_area();
+    }
+    f32 root_area = m_nodes[m_root].m_bounds.surface_area();
+    return root_area > 0 ? area / root_area : 0;
+}
+
+void Bvh::collect_subtree(u32 node, vec<u32>* items) const {
+    vec<u32> stack = {node};
+    while (!stack.empty()) {
+        const BvhNode& current = m_nodes[stack.back()];
+        stack.pop_back();
+        if (current.is_leaf()) {
+            items->push_back(current.m_item);
+        } else {
+            stack.push_back(current.m_left);
+            stack.push_back(current.m_right);
+        }
+    }
+}
+
+// Same plane test as cull_bounds(). A node fully inside every plane adds its whole subtree
+// without testing it further.
+void Bvh::query_frustum(const Frustum& frustum, vec<u32>* items) const {
+    if (m_root == BVH_INVALID) {
+        return;
+    }
+    vec<u32> stack = {m_root};
+    while (!stack.empty()) {
+        u32 node = stack.back();
+        stack.pop_back();
+        const BvhNode& current = m_nodes[node];
+        Vec3 center = current.m_bounds.center();
+        Vec3 extent = current.m_bounds.extent();
+
+        bool outside = false;
+        bool inside = true;
+        for (const Vec4& plane : frustum.m_planes) {
+            f32 distance = plane.v[0] * center.v[0] + plane.v[1] * center.v[1] +
+                           plane.v[2] * center.v[2] + plane.v[3];
+            f32 radius = std::abs(plane.v[0]) * extent.v[0] +
+                         std::abs(plane.v[1]) * extent.v[1] + std::abs(plane.v[2]) * extent.v[2];
+            if (distance + radius < 0) {
+                outside = true;
+                break;
+            }
+            inside &= distance - radius >= 0;
+        }
+
+        if (outside) {
+            continue;
+        }
+        if (inside) {
+            collect_subtree(node, items);
+        } else if (current.is_leaf()) {
+            items->push_back(current.m_item);
+        } else {
+            stack.push_back(current.m_left);
+            stack.push_back(current.m_right);
+        }
+    }
+}
+
+void Bvh::query_aabb(const Aabb& bounds, vec<u32>* items) const {
+    if (m_root == BVH_INVALID) {
+        return;
+    }
+    vec<u32> stack = {m_root};
+    while (!stack.empty()) {
+        const BvhNode& current = m_nodes[stack.back()];
+        stack.pop_back();
+        if (!current.m_bounds.overlaps(bounds)) {
+            continue;
+        }
+        if (current.is_leaf()) {
+            items->push_back(current.m_item);
+        } else {
+            stack.push_back(current.m_left);
+            stack.push_back(current.m_right);
+        }
+    }
+}
+
+void Bvh::query_sphere(Vec3 center, f32 radius, vec<u32>* items) const {
+    if (m_root == BVH_INVALID) {
+        return;
+    }
+    vec<u32> stack = {m_root};
+    while (!stack.empty()) {
+        const BvhNode& current = m_nodes[stack.back()];
+        stack.pop_back();
+
+        f32 distance_squared = 0;
+        for (u32 i = 0; i < 3; i++) {
+            f32 closest = std::clamp(center.v[i], current.m_bounds.m_min.v[i],
+                                     current.m_bounds.m_max.v[i]);
+            distance_squared += (center.v[i] - closest) * (center.v[i] - closest);
+        }
+        if (distance_squared > radius * radius) {
+            continue;
+        }
+
+        if (current.is_leaf()) {
+            items->push_back(current.m_item);
+        } else {
+            stack.push_back(current.m_left);
+            stack.push_back(current.m_right);
+        }
+    }
+}
+
+// Slab test. Hits are sorted by the distance at which the ray enters the item box, which is 0
+// for boxes containing the origin.
+void Bvh::query_ray(Vec3 origin, Vec3 direction, f32 max_distance, vec<RayHit>* hits) const {
+    if (m_root == BVH_INVALID) {
+        return;
+    }
+    Vec3 inverse_direction(1.0f / direction.v[0], 1.0f / direction.v[1], 1.0f / direction.v[2]);
+    u64 first_hit = hits->size();
+
+    vec<u32> stack = {m_root};
+    while (!stack.empty()) {
+        const BvhNode& current = m_nodes[stack.back()];
+        stack.pop_back();
+
+        f32 t_min = 0;
+        f32 t_max = max_distance;
+        for (u32 i = 0; i < 3; i++) {
+            f32 t0 = (current.m_bounds.m_min.v[i] - origin.v[i]) * inverse_direction.v[i];
+            f32 t1 = (current.m_bounds.m_max.v[i] - origin.v[i]) * inverse_direction.v[i];
+            if (t0 > t1) {
+                std::swap(t0, t1);
+            }
+            // NaN from 0 * inf (an axis parallel ray on a slab boundary) keeps the range as is.
+            t_min = t0 > t_min ? t0 : t_min;
+            t_max = t1 < t_max ? t1 : t_max;
+        }
+        if (t_min > t_max) {
+            continue;
+        }
+
+        if (current.is_leaf()) {
+            hits->push_back(RayHit{.m_item = current.m_item, .m_distance = t_min});
+        } else {
+            stack.push_back(current.m_left);
+            stack.push_back(current.m_right);
+        }
+    }
+
+    std::sort(hits->begin() + first_hit, hits->end(),
+              [](const RayHit& a, const RayHit& b) { return a.m_distance < b.m_distance; });
+}
+
+void Bvh::start_rebuild() {
+    if (rebuilding()) {
+        return;
+    }
+    vec<bool> item_valid(m_item_leaves.size());
+    for (u32 i = 0; i < m_item_leaves.size(); i++) {
+        item_valid[i] = m_item_leaves[i] != BVH_INVALID;
+    }
+
+#ifdef EMSCRIPTEN
+    std::launch policy = std::launch::deferred;
+#else
+    std::launch policy = std::launch::async;
+#endif
+    m_rebuild = std::async(policy, [item_bounds = m_item_bounds, item_valid = std::move(item_valid),
+                                    generation = m_generation]() {
+        std::unique_ptr<Bvh> bvh = std::make_unique<Bvh>();
+        bvh->build(item_bounds, item_valid);
+        bvh->m_generation = generation;
+        return bvh;
+    });
+}
+
+bool Bvh::rebuilding() const {
+    return m_rebuild.valid();
+}
+
+// The new tree is dropped when build() was called since the rebuild started, as its items may
+// not match anymore.
+bool Bvh::finish_rebuild() {
+    if (!m_rebuild.valid() ||
+        m_rebuild.wait_for(std::chrono::seconds(0)) == std::future_status::timeout) {
+        return false;
+    }
+    std::unique_ptr<Bvh> bvh = m_rebuild.get();
+    if (bvh->m_generation != m_generation) {
+        return false;
+    }
+
+    vec<Aabb> item_bounds = std::move(m_item_bounds);
+    m_nodes = std::move(bvh->m_nodes);
+    m_root = bvh->m_root;
+    m_item_bounds = std::move(bvh->m_item_bounds);
+    m_item_leaves = std::move(bvh->m_item_leaves);
+    m_refit_count = 0;
+    for (u32 i = 0; i < item_bounds.size(); i++) {
+        if (!(item_bounds[i] == m_item_bounds[i])) {
+            update(i, item_bounds[i]);
+        }
+    }
+    return true;
+}
+
+}  // namespace blaz
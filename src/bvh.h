@@ -0,0 +1,60 @@
+#pragma once
+
+#include <future>
+#include <memory>
+
+#include "culling.h"
+#include "my_math.h"
+#include "types.h"
+
+namespace blaz {
+
+// Leaves hold a single item so that an item can be moved by refitting its leaf and the leaf's
+// ancestors only.
+struct BvhNode {
+    Aabb m_bounds;
+    u32 m_parent = UINT32_MAX;
+    u32 m_left = UINT32_MAX;
+    u32 m_right = UINT32_MAX;
+    u32 m_item = UINT32_MAX;
+
+    bool is_leaf() const {
+        return m_item != UINT32_MAX;
+    }
+};
+
+struct RayHit {
+    u32 m_item;
+    f32 m_distance;
+};
+
+// Bounding volume hierarchy over item boxes. Items are indices chosen by the caller; items
+// without bounds (build() with an invalid flag) are left out of the tree.
+struct Bvh {
+    vec<BvhNode> m_nodes;
+    u32 m_root = UINT32_MAX;
+    vec<Aabb> m_item_bounds;
+    vec<u32> m_item_leaves;
+    u32 m_refit_count = 0;
+
+    void build(const vec<Aabb>& item_bounds, const vec<bool>& item_valid);
+    void update(u32 item, const Aabb& bounds);
+    f32 sah_cost() const;
+
+    void query_frustum(const Frustum& frustum, vec<u32>* items) const;
+    void query_aabb(const Aabb& bounds, vec<u32>* items) const;
+    void query_sphere(Vec3 center, f32 radius, vec<u32>* items) const;
+    void query_ray(Vec3 origin, Vec3 direction, f32 max_distance, vec<RayHit>* hits) const;
+
+    // Full SAH rebuild from the current item bounds on another thread. finish_rebuild() swaps
+    // the new tree in once it is ready and refits the items that moved in the meantime.
+    std::future<std::unique_ptr<Bvh>> m_rebuild;
+    u32 m_generation = 0;
+    void start_rebuild();
+    bool rebuilding() const;
+    bool finish_rebuild();
+
+    void collect_subtree(u32 node, vec<u32>* items) const;
+};
+
+}  // namespace blaz
@@ -30,12 +30,16 @@ void Camera::update_projection_matrix() {
 }
 
 void Camera::update_view_matrix() {
-    if (m_scene->m_nodes[m_node].m_was_dirty) {
-        m_scene->m_nodes[m_node].m_was_dirty = false;
+    update_view_matrix(&m_scene->m_nodes[m_node]);
+}
+
+void Camera::update_view_matrix(Node* node) {
+    if (node->m_was_dirty) {
+        node->m_was_dirty = false;
     } else {
         return;
     }
-    m_view_matrix = m_scene->m_nodes[m_node].m_global_matrix;
+    m_view_matrix = node->m_global_matrix;
     m_view_matrix.m[12] *= -1;
     m_view_matrix.m[13] *= -1;
     m_view_matrix.m[14] *= -1;
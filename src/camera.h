@@ -38,6 +38,7 @@ struct Camera {
 
     Mat4 m_view_matrix = Mat4();
     void update_view_matrix();
+    void update_view_matrix(Node* node);
     CameraMode m_camera_mode = CameraMode::ORBIT;
 
     Vec3 m_orbit_target = Vec3(0, 0, 0);
@@ -36,7 +36,7 @@ HSV rgb_to_hsv(RGB rgb) {
 
 RGB hsv_to_rgb(HSV hsv) {
     f32 c = hsv.v() * hsv.s();
-    f32 x = c * (1 - std::fabsf(std::fmodf(hsv.h() / 60, 2) - 1));
+    f32 x = c * (1 - std::fabs(std::fmod(hsv.h() / 60, 2) - 1));
     f32 m = hsv.v() - c;
     RGB rgb(0, 0, 0);
     if (hsv.h() >= 0 && hsv.h() < 60) rgb = RGB(c, x, 0);
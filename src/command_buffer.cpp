@@ -0,0 +1,172 @@
+#include "command_buffer.h"
+
+#include "memory.h"
+#include "renderer.h"
+
+namespace blaz {
+
+static void push_command(CommandBuffer* command_buffer, CommandType type, u32 arg0 = 0,
+                         u32 arg1 = 0, u32 arg2 = 0, u32 arg3 = 0, u32 arg4 = 0, u32 arg5 = 0) {
+    command_buffer->m_commands.push_back(
+        Command{.m_type = type, .m_args = {arg0, arg1, arg2, arg3, arg4, arg5}});
+}
+
+static u32 float_bits(f32 value) {
+    u32 bits;
+    memcopy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+void CommandBuffer::reset() {
+    m_commands.clear();
+    m_data.clear();
+}
+
+u32 CommandBuffer::push_data(const void* data, u32 size) {
+    u32 offset = (u32(m_data.size()) + 15) & ~15u;
+    m_data.resize(offset + size);
+    memcopy(m_data.data() + offset, data, size);
+    return offset;
+}
+
+void CommandBuffer::append(const CommandBuffer& other) {
+    u32 data_base = (u32(m_data.size()) + 15) & ~15u;
+    m_data.resize(data_base + other.m_data.size());
+    memcopy(m_data.data() + data_base, other.m_data.data(), other.m_data.size());
+
+    size_t first_command = m_commands.size();
+    m_commands.insert(m_commands.end(), other.m_commands.begin(), other.m_commands.end());
+    for (size_t i = first_command; i < m_commands.size(); i++) {
+        Command& command = m_commands[i];
+        switch (command.m_type) {
+            case CommandType::BIND_UNIFORMS:
+            case CommandType::SET_INSTANCE_DATA:
+            case CommandType::COPY_TEXTURE:
+            case CommandType::DEBUG_MARKER_START:
+                command.m_args[0] += data_base;
+                break;
+            case CommandType::WRITE_UNIFORM:
+                command.m_args[2] += data_base;
+                break;
+            case CommandType::MULTI_DRAW_INDEXED:
+                command.m_args[1] += data_base;
+                command.m_args[2] += data_base;
+                break;
+            case CommandType::MULTI_DRAW_INDEXED_INDIRECT:
+                command.m_args[1] += data_base;
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+void CommandBuffer::set_framebuffer(u32 framebuffer) {
+    push_command(this, CommandType::SET_FRAMEBUFFER, framebuffer);
+}
+
+void CommandBuffer::set_default_framebuffer() {
+    push_command(this, CommandType::SET_DEFAULT_FRAMEBUFFER);
+}
+
+void CommandBuffer::set_viewport(u32 x, u32 y, u32 width, u32 height) {
+    push_command(this, CommandType::SET_VIEWPORT, x, y, width, height);
+}
+
+void CommandBuffer::set_depth_test(bool enabled) {
+    push_command(this, CommandType::SET_DEPTH_TEST, enabled);
+}
+
+void CommandBuffer::set_face_culling(bool enabled, CullingMode mode, CullingOrder order) {
+    push_command(this, CommandType::SET_FACE_CULLING, enabled, u32(mode), u32(order));
+}
+
+void CommandBuffer::clear(u32 clear_flag, RGBA clear_color, f32 clear_depth) {
+    push_command(this, CommandType::CLEAR, clear_flag, float_bits(clear_color.r()),
+                 float_bits(clear_color.g()), float_bits(clear_color.b()),
+                 float_bits(clear_color.a()), float_bits(clear_depth));
+}
+
+void CommandBuffer::set_shader(u32 shader) {
+    push_command(this, CommandType::SET_SHADER, shader);
+}
+
+void CommandBuffer::bind_uniforms(const vec<PassBinding>& bindings) {
+    u32 offset = push_data(bindings.data(), u32(bindings.size() * sizeof(PassBinding)));
+    push_command(this, CommandType::BIND_UNIFORMS, offset, u32(bindings.size()));
+}
+
+void CommandBuffer::set_mesh(u32 mesh) {
+    push_command(this, CommandType::SET_MESH, mesh);
+}
+
+void CommandBuffer::set_bufferless_mesh() {
+    push_command(this, CommandType::SET_BUFFERLESS_MESH);
+}
+
+void CommandBuffer::write_uniform(u32 uniform_buffer, u32 offset, const void* data, u32 size) {
+    u32 data_offset = push_data(data, size);
+    push_command(this, CommandType::WRITE_UNIFORM, uniform_buffer, offset, data_offset, size);
+}
+
+void CommandBuffer::set_instance_data(const Mat4* instance_data, u32 count) {
+    u32 offset = push_data(instance_data, count * u32(sizeof(Mat4)));
+    push_command(this, CommandType::SET_INSTANCE_DATA, offset, count);
+}
+
+void CommandBuffer::draw(MeshPrimitive primitive, u32 count) {
+    push_command(this, CommandType::DRAW, u32(primitive), count);
+}
+
+void CommandBuffer::draw_indexed(MeshPrimitive primitive, u32 count, u32 first_index) {
+    push_command(this, CommandType::DRAW_INDEXED, u32(primitive), count, first_index);
+}
+
+void CommandBuffer::draw_indexed_instanced(MeshPrimitive primitive, u32 count, u32 instance_count,
+                                           u32 first_instance, u32 first_index) {
+    push_command(this, CommandType::DRAW_INDEXED_INSTANCED, u32(primitive), count, instance_count,
+                 first_instance, first_index);
+}
+
+void CommandBuffer::multi_draw_indexed(MeshPrimitive primitive, const u32* counts,
+                                       const u32* first_indices, u32 draw_count) {
+    u32 counts_offset = push_data(counts, draw_count * u32(sizeof(u32)));
+    u32 first_indices_offset = push_data(first_indices, draw_count * u32(sizeof(u32)));
+    push_command(this, CommandType::MULTI_DRAW_INDEXED, u32(primitive), counts_offset,
+                 first_indices_offset, draw_count);
+}
+
+void CommandBuffer::multi_draw_indexed_indirect(MeshPrimitive primitive,
+                                                const DrawIndirectCommand* draws,
+                                                u32 draw_count) {
+    u32 offset = push_data(draws, draw_count * u32(sizeof(DrawIndirectCommand)));
+    push_command(this, CommandType::MULTI_DRAW_INDEXED_INDIRECT, u32(primitive), offset,
+                 draw_count);
+}
+
+void CommandBuffer::dispatch_compute(u32 num_groups_x, u32 num_groups_y, u32 num_groups_z) {
+    push_command(this, CommandType::DISPATCH_COMPUTE, num_groups_x, num_groups_y, num_groups_z);
+}
+
+void CommandBuffer::copy_texture(u32 src, u32 dst, Vec3I src_pos, Vec2I src_size,
+                                 Vec3I dst_pos) {
+    CopyTextureArgs args = {
+        .m_src = src,
+        .m_dst = dst,
+        .m_src_pos = {src_pos.x(), src_pos.y(), src_pos.z()},
+        .m_src_size = {src_size.x(), src_size.y()},
+        .m_dst_pos = {dst_pos.x(), dst_pos.y(), dst_pos.z()},
+    };
+    push_command(this, CommandType::COPY_TEXTURE, push_data(&args, sizeof(args)));
+}
+
+void CommandBuffer::debug_marker_start(const str& name) {
+    u32 offset = push_data(name.c_str(), u32(name.size()) + 1);
+    push_command(this, CommandType::DEBUG_MARKER_START, offset);
+}
+
+void CommandBuffer::debug_marker_end() {
+    push_command(this, CommandType::DEBUG_MARKER_END);
+}
+
+}  // namespace blaz
\ No newline at end of file
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "color.h"
+#include "my_math.h"
+#include "types.h"
+
+namespace blaz {
+
+enum class MeshPrimitive;
+enum class CullingMode;
+enum class CullingOrder;
+struct PassBinding;
+
+enum class CommandType : u32 {
+    SET_FRAMEBUFFER,
+    SET_DEFAULT_FRAMEBUFFER,
+    SET_VIEWPORT,
+    SET_DEPTH_TEST,
+    SET_FACE_CULLING,
+    CLEAR,
+    SET_SHADER,
+    BIND_UNIFORMS,
+    SET_MESH,
+    SET_BUFFERLESS_MESH,
+    WRITE_UNIFORM,
+    SET_INSTANCE_DATA,
+    DRAW,
+    DRAW_INDEXED,
+    DRAW_INDEXED_INSTANCED,
+    MULTI_DRAW_INDEXED,
+    MULTI_DRAW_INDEXED_INDIRECT,
+    DISPATCH_COMPUTE,
+    COPY_TEXTURE,
+    DEBUG_MARKER_START,
+    DEBUG_MARKER_END,
+};
+
+struct Command {
+    CommandType m_type;
+    u32 m_args[6];
+};
+
+struct CopyTextureArgs {
+    u32 m_src;
+    u32 m_dst;
+    i32 m_src_pos[3];
+    i32 m_src_size[2];
+    i32 m_dst_pos[3];
+};
+
+// Laid out as the records read by glMultiDrawElementsIndirect. m_first_index and
+// m_base_vertex are absolute in the mesh pool buffers.
+struct DrawIndirectCommand {
+    u32 m_count;
+    u32 m_instance_count;
+    u32 m_first_index;
+    i32 m_base_vertex;
+    u32 m_first_instance;
+};
+
+struct CommandBuffer {
+    vec<Command> m_commands;
+    vec<u8> m_data;
+
+    void reset();
+    u32 push_data(const void* data, u32 size);
+    void append(const CommandBuffer& other);
+
+    const void* data(u32 offset) const {
+        return m_data.data() + offset;
+    }
+
+    void set_framebuffer(u32 framebuffer);
+    void set_default_framebuffer();
+    void set_viewport(u32 x, u32 y, u32 width, u32 height);
+    void set_depth_test(bool enabled);
+    void set_face_culling(bool enabled, CullingMode mode, CullingOrder order);
+    void clear(u32 clear_flag, RGBA clear_color, f32 clear_depth);
+    void set_shader(u32 shader);
+    void bind_uniforms(const vec<PassBinding>& bindings);
+    void set_mesh(u32 mesh);
+    void set_bufferless_mesh();
+    void write_uniform(u32 uniform_buffer, u32 offset, const void* data, u32 size);
+    void set_instance_data(const Mat4* instance_data, u32 count);
+    void draw(MeshPrimitive primitive, u32 count);
+    void draw_indexed(MeshPrimitive primitive, u32 count, u32 first_index = 0);
+    void draw_indexed_instanced(MeshPrimitive primitive, u32 count, u32 instance_count,
+                                u32 first_instance, u32 first_index = 0);
+    void multi_draw_indexed(MeshPrimitive primitive, const u32* counts, const u32* first_indices,
+                            u32 draw_count);
+    void multi_draw_indexed_indirect(MeshPrimitive primitive, const DrawIndirectCommand* draws,
+                                     u32 draw_count);
+    void dispatch_compute(u32 num_groups_x, u32 num_groups_y, u32 num_groups_z);
+    void copy_texture(u32 src, u32 dst, Vec3I src_pos, Vec2I src_size, Vec3I dst_pos);
+    void debug_marker_start(const str& name);
+    void debug_marker_end();
+};
+
+}  // namespace blaz
\ No newline at end of file
@@ -0,0 +1,178 @@
+#include "culling.h"
+
+#include <algorithm>
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define CULLING_SSE
+#endif
+
+namespace blaz {
+
+Vec3 Aabb::center() const {
+    return Vec3((m_min.v[0] + m_max.v[0]) * 0.5f, (m_min.v[1] + m_max.v[1]) * 0.5f,
+                (m_min.v[2] + m_max.v[2]) * 0.5f);
+}
+
+Vec3 Aabb::extent() const {
+    return Vec3((m_max.v[0] - m_min.v[0]) * 0.5f, (m_max.v[1] - m_min.v[1]) * 0.5f,
+                (m_max.v[2] - m_min.v[2]) * 0.5f);
+}
+
+f32 Aabb::surface_area() const {
+    f32 x = m_max.v[0] - m_min.v[0];
+    f32 y = m_max.v[1] - m_min.v[1];
+    f32 z = m_max.v[2] - m_min.v[2];
+    return 2 * (x * y + y * z + z * x);
+}
+
+Aabb Aabb::merge(const Aabb& other) const {
+    Aabb merged;
+    for (u32 i = 0; i < 3; i++) {
+        merged.m_min.v[i] = std::min(m_min.v[i], other.m_min.v[i]);
+        merged.m_max.v[i] = std::max(m_max.v[i], other.m_max.v[i]);
+    }
+    return merged;
+}
+
+bool Aabb::operator==(const Aabb& other) const {
+    for (u32 i = 0; i < 3; i++) {
+        if (m_min.v[i] != other.m_min.v[i] || m_max.v[i] != other.m_max.v[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Aabb::overlaps(const Aabb& other) const {
+    for (u32 i = 0; i < 3; i++) {
+        if (m_min.v[i] > other.m_max.v[i] || m_max.v[i] < other.m_min.v[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// The center is transformed, and each world extent sums the local extents weighted by the
+// absolute values of the matrix row.
+Aabb transform_aabb(const Mat4& matrix, Vec3 aabb_min, Vec3 aabb_max) {
+    const f32* m = matrix.m;
+    Vec3 center = (aabb_min + aabb_max) * 0.5f;
+    Vec3 extent = (aabb_max - aabb_min) * 0.5f;
+
+    Aabb bounds;
+    for (u32 r = 0; r < 3; r++) {
+        f32 world_center = m[r] * center.v[0] + m[4 + r] * center.v[1] +
+                           m[8 + r] * center.v[2] + m[12 + r];
+        f32 world_extent = std::abs(m[r]) * extent.v[0] + std::abs(m[4 + r]) * extent.v[1] +
+                           std::abs(m[8 + r]) * extent.v[2];
+        bounds.m_min.v[r] = world_center - world_extent;
+        bounds.m_max.v[r] = world_center + world_extent;
+    }
+    return bounds;
+}
+
+Frustum make_frustum(const Mat4& view_projection) {
+    const f32* m = view_projection.m;
+    auto row = [m](u32 i) { return Vec4(m[i], m[4 + i], m[8 + i], m[12 + i]); };
+    Vec4 x = row(0);
+    Vec4 y = row(1);
+    Vec4 z = row(2);
+    Vec4 w = row(3);
+
+    Frustum frustum;
+    frustum.m_planes[0] = w + x;
+    frustum.m_planes[1] = w - x;
+    frustum.m_planes[2] = w + y;
+    frustum.m_planes[3] = w - y;
+    frustum.m_planes[4] = w + z;
+    frustum.m_planes[5] = w - z;
+    return frustum;
+}
+
+void BoundsSoA::resize(u32 count) {
+    u32 padded_count = (count + CULLING_BATCH_SIZE - 1) / CULLING_BATCH_SIZE * CULLING_BATCH_SIZE;
+    for (vec<f32>* values :
+         {&m_center_x, &m_center_y, &m_center_z, &m_extent_x, &m_extent_y, &m_extent_z}) {
+        values->resize(padded_count, 0);
+    }
+}
+
+void BoundsSoA::set(u32 index, const Aabb& bounds) {
+    Vec3 center = bounds.center();
+    Vec3 extent = bounds.extent();
+    m_center_x[index] = center.v[0];
+    m_center_y[index] = center.v[1];
+    m_center_z[index] = center.v[2];
+    m_extent_x[index] = extent.v[0];
+    m_extent_y[index] = extent.v[1];
+    m_extent_z[index] = extent.v[2];
+}
+
+void BoundsSoA::set_infinite(u32 index) {
+    m_center_x[index] = 0;
+    m_center_y[index] = 0;
+    m_center_z[index] = 0;
+    m_extent_x[index] = 1e30f;
+    m_extent_y[index] = 1e30f;
+    m_extent_z[index] = 1e30f;
+}
+
+// A box is outside when it lies entirely on the negative side of one plane, which happens when
+// even its corner furthest along the plane normal is: dot(n, c) + d + dot(|n|, e) < 0.
+u32 cull_bounds(const Frustum& frustum, const BoundsSoA& bounds, u32 begin, u32 end, u8* visible) {
+    u32 visible_count = 0;
+    u32 i = begin;
+
+#ifdef CULLING_SSE
+    const __m128 sign_mask = _mm_set1_ps(-0.0f);
+    for (; i + CULLING_BATCH_SIZE <= end; i += CULLING_BATCH_SIZE) {
+        __m128 center_x = _mm_loadu_ps(&bounds.m_center_x[i]);
+        __m128 center_y = _mm_loadu_ps(&bounds.m_center_y[i]);
+        __m128 center_z = _mm_loadu_ps(&bounds.m_center_z[i]);
+        __m128 extent_x = _mm_loadu_ps(&bounds.m_extent_x[i]);
+        __m128 extent_y = _mm_loadu_ps(&bounds.m_extent_y[i]);
+        __m128 extent_z = _mm_loadu_ps(&bounds.m_extent_z[i]);
+
+        __m128 outside = _mm_setzero_ps();
+        for (const Vec4& plane : frustum.m_planes) {
+            __m128 a = _mm_set1_ps(plane.v[0]);
+            __m128 b = _mm_set1_ps(plane.v[1]);
+            __m128 c = _mm_set1_ps(plane.v[2]);
+            __m128 d = _mm_set1_ps(plane.v[3]);
+            __m128 distance = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(a, center_x), _mm_mul_ps(b, center_y)),
+                _mm_add_ps(_mm_mul_ps(c, center_z), d));
+            __m128 radius = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(_mm_andnot_ps(sign_mask, a), extent_x),
+                           _mm_mul_ps(_mm_andnot_ps(sign_mask, b), extent_y)),
+                _mm_mul_ps(_mm_andnot_ps(sign_mask, c), extent_z));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius),
+                                                      _mm_setzero_ps()));
+        }
+
+        int outside_mask = _mm_movemask_ps(outside);
+        for (u32 j = 0; j < CULLING_BATCH_SIZE; j++) {
+            visible[i + j] = (outside_mask >> j & 1) == 0;
+            visible_count += visible[i + j];
+        }
+    }
+#endif
+
+    for (; i < end; i++) {
+        bool outside = false;
+        for (const Vec4& plane : frustum.m_planes) {
+            f32 distance = plane.v[0] * bounds.m_center_x[i] + plane.v[1] * bounds.m_center_y[i] +
+                           plane.v[2] * bounds.m_center_z[i] + plane.v[3];
+            f32 radius = std::abs(plane.v[0]) * bounds.m_extent_x[i] +
+                         std::abs(plane.v[1]) * bounds.m_extent_y[i] +
+                         std::abs(plane.v[2]) * bounds.m_extent_z[i];
+            outside |= distance + radius < 0;
+        }
+        visible[i] = !outside;
+        visible_count += visible[i];
+    }
+    return visible_count;
+}
+
+}  // namespace blaz
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "my_math.h"
+#include "types.h"
+
+namespace blaz {
+
+const u32 CULLING_BATCH_SIZE = 4;
+
+struct Aabb {
+    Vec3 m_min = Vec3(0, 0, 0);
+    Vec3 m_max = Vec3(0, 0, 0);
+
+    Vec3 center() const;
+    Vec3 extent() const;
+    f32 surface_area() const;
+    Aabb merge(const Aabb& other) const;
+    bool operator==(const Aabb& other) const;
+    bool overlaps(const Aabb& other) const;
+};
+
+Aabb transform_aabb(const Mat4& matrix, Vec3 aabb_min, Vec3 aabb_max);
+
+// Planes as (a, b, c, d) with a * x + b * y + c * z + d >= 0 inside the frustum.
+struct Frustum {
+    Vec4 m_planes[6];
+};
+
+// view_projection maps world space to clip space, as u_projection_mat * u_view_mat does in the
+// shaders. The near plane assumes a [-w, w] depth range, which is conservative for [0, w].
+Frustum make_frustum(const Mat4& view_projection);
+
+// World space boxes as center and half extent, padded to a multiple of CULLING_BATCH_SIZE so
+// they can be tested a batch at a time.
+struct BoundsSoA {
+    vec<f32> m_center_x;
+    vec<f32> m_center_y;
+    vec<f32> m_center_z;
+    vec<f32> m_extent_x;
+    vec<f32> m_extent_y;
+    vec<f32> m_extent_z;
+
+    void resize(u32 count);
+    void set(u32 index, const Aabb& bounds);
+    void set_infinite(u32 index);
+};
+
+// Writes 1 to visible[i] for the boxes in [begin, end) that intersect the frustum and 0 for the
+// others, and returns the visible count. begin has to be a multiple of CULLING_BATCH_SIZE.
+u32 cull_bounds(const Frustum& frustum, const BoundsSoA& bounds, u32 begin, u32 end, u8* visible);
+
+}  // namespace blaz
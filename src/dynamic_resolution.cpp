@@ -0,0 +1,52 @@
+#include "dynamic_resolution.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "logger.h"
+
+namespace blaz {
+
+void DynamicResolution::reset() {
+    m_min_scale = std::min(m_min_scale, m_max_scale);
+    m_scale = std::clamp(m_scale, m_min_scale, m_max_scale);
+    m_smoothed_frame_time_ms = 0;
+    m_frames_since_adjust = 0;
+}
+
+// Returns true when the scale changed. Frame time is assumed to grow with the pixel count, so
+// the scale moves by the square root of the target to measured frame time ratio.
+bool DynamicResolution::update(f32 frame_time_ms) {
+    if (m_smoothed_frame_time_ms == 0) {
+        m_smoothed_frame_time_ms = frame_time_ms;
+    } else {
+        m_smoothed_frame_time_ms += (frame_time_ms - m_smoothed_frame_time_ms) * m_smoothing;
+    }
+
+    m_frames_since_adjust++;
+    if (m_frames_since_adjust < m_adjust_interval) {
+        return false;
+    }
+    m_frames_since_adjust = 0;
+
+    f32 scale = m_scale;
+    f32 error = (m_smoothed_frame_time_ms - m_target_frame_time_ms) / m_target_frame_time_ms;
+    if (std::abs(error) > m_tolerance) {
+        scale *= std::sqrt(m_target_frame_time_ms / m_smoothed_frame_time_ms);
+        scale = std::clamp(scale, m_scale - m_max_step, m_scale + m_max_step);
+        scale = std::clamp(scale, m_min_scale, m_max_scale);
+    }
+
+    logger.info("Dynamic resolution: frame ", m_smoothed_frame_time_ms, " ms (last ",
+                frame_time_ms, " ms), target ", m_target_frame_time_ms, " ms, error ",
+                error * 100.0f, "%, scale ", m_scale, " -> ", scale);
+
+    if (scale == m_scale) {
+        return false;
+    }
+    m_scale = scale;
+    m_smoothed_frame_time_ms = 0;
+    return true;
+}
+
+}  // namespace blaz
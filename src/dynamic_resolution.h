@@ -0,0 +1,27 @@
+#pragma once
+
+#include "types.h"
+
+namespace blaz {
+
+// Frame-time governor for the render scale. Viewport sized render targets are allocated at
+// m_max_scale and each frame renders into the top-left m_scale portion of them.
+struct DynamicResolution {
+    bool m_enabled = false;
+    f32 m_target_frame_time_ms = 16.0f;
+    f32 m_min_scale = 0.5f;
+    f32 m_max_scale = 1.0f;
+    f32 m_scale = 1.0f;
+    f32 m_tolerance = 0.1f;
+    f32 m_max_step = 0.1f;
+    f32 m_smoothing = 0.1f;
+    u32 m_adjust_interval = 30;
+
+    f32 m_smoothed_frame_time_ms = 0;
+    u32 m_frames_since_adjust = 0;
+
+    void reset();
+    bool update(f32 frame_time_ms);
+};
+
+}  // namespace blaz
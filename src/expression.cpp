@@ -0,0 +1,251 @@
+#include "expression.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+
+namespace blaz {
+
+struct ExpressionParser {
+    const str& m_source;
+    u32 m_position = 0;
+    u32 m_depth = 0;
+    u32 m_max_depth = 0;
+    Expression m_expression;
+    Error m_error;
+
+    void skip_spaces() {
+        while (m_position < m_source.size() && std::isspace(u8(m_source[m_position]))) {
+            m_position++;
+        }
+    }
+
+    char peek() {
+        skip_spaces();
+        return m_position < m_source.size() ? m_source[m_position] : '\0';
+    }
+
+    bool accept(char c) {
+        if (peek() != c) {
+            return false;
+        }
+        m_position++;
+        return true;
+    }
+
+    void fail(const str& message) {
+        if (!m_error) {
+            m_error = Error("parse_expression: " + message + " at column " +
+                            std::to_string(m_position + 1) + " in \"" + m_source + "\"");
+        }
+    }
+
+    // Tracks the evaluation stack depth so evaluate() can use a fixed size stack.
+    void emit(ExpressionOp op, f32 value = 0) {
+        m_expression.m_code.push_back(ExpressionInstruction{.m_op = op, .m_value = value});
+        switch (op) {
+            case ExpressionOp::CONSTANT:
+            case ExpressionOp::VIEWPORT_WIDTH:
+            case ExpressionOp::VIEWPORT_HEIGHT:
+                m_depth++;
+                break;
+            case ExpressionOp::ADD:
+            case ExpressionOp::SUB:
+            case ExpressionOp::MUL:
+            case ExpressionOp::DIV:
+            case ExpressionOp::MIN:
+            case ExpressionOp::MAX:
+                m_depth--;
+                break;
+            default:
+                break;
+        }
+        m_max_depth = std::max(m_max_depth, m_depth);
+    }
+
+    str identifier() {
+        skip_spaces();
+        u32 start = m_position;
+        while (m_position < m_source.size() &&
+               (std::isalnum(u8(m_source[m_position])) || m_source[m_position] == '_')) {
+            m_position++;
+        }
+        return m_source.substr(start, m_position - start);
+    }
+
+    void parse_sum() {
+        parse_product();
+        while (!m_error) {
+            if (accept('+')) {
+                parse_product();
+                emit(ExpressionOp::ADD);
+            } else if (accept('-')) {
+                parse_product();
+                emit(ExpressionOp::SUB);
+            } else {
+                return;
+            }
+        }
+    }
+
+    void parse_product() {
+        parse_factor();
+        while (!m_error) {
+            if (accept('*')) {
+                parse_factor();
+                emit(ExpressionOp::MUL);
+            } else if (accept('/')) {
+                parse_factor();
+                emit(ExpressionOp::DIV);
+            } else {
+                return;
+            }
+        }
+    }
+
+    void parse_factor() {
+        char c = peek();
+        if (c == '-') {
+            m_position++;
+            parse_factor();
+            emit(ExpressionOp::NEGATE);
+        } else if (c == '(') {
+            m_position++;
+            parse_sum();
+            if (!accept(')')) {
+                fail("expected ')'");
+            }
+        } else if (std::isdigit(u8(c)) || c == '.') {
+            const char* start = m_source.c_str() + m_position;
+            char* end = NULL;
+            f32 value = std::strtof(start, &end);
+            m_position += u32(end - start);
+            emit(ExpressionOp::CONSTANT, value);
+        } else if (std::isalpha(u8(c)) || c == '_') {
+            parse_identifier();
+        } else {
+            fail(c == '\0' ? str("unexpected end") : str("unexpected '") + c + "'");
+        }
+    }
+
+    void parse_identifier() {
+        str name = identifier();
+        if (name == "viewport_width") {
+            emit(ExpressionOp::VIEWPORT_WIDTH);
+            return;
+        }
+        if (name == "viewport_height") {
+            emit(ExpressionOp::VIEWPORT_HEIGHT);
+            return;
+        }
+
+        ExpressionOp op;
+        u32 argument_count = 1;
+        if (name == "ceil") {
+            op = ExpressionOp::CEIL;
+        } else if (name == "floor") {
+            op = ExpressionOp::FLOOR;
+        } else if (name == "round") {
+            op = ExpressionOp::ROUND;
+        } else if (name == "min") {
+            op = ExpressionOp::MIN;
+            argument_count = 2;
+        } else if (name == "max") {
+            op = ExpressionOp::MAX;
+            argument_count = 2;
+        } else {
+            fail("unknown identifier \"" + name + "\"");
+            return;
+        }
+
+        if (!accept('(')) {
+            fail("expected '(' after \"" + name + "\"");
+            return;
+        }
+        for (u32 i = 0; i < argument_count && !m_error; i++) {
+            if (i > 0 && !accept(',')) {
+                fail("expected ',' in \"" + name + "\"");
+                return;
+            }
+            parse_sum();
+        }
+        if (!accept(')')) {
+            fail("expected ')' after arguments of \"" + name + "\"");
+            return;
+        }
+        emit(op);
+    }
+};
+
+pair<Error, Expression> parse_expression(const str& source) {
+    ExpressionParser parser = {.m_source = source};
+    parser.parse_sum();
+    if (!parser.m_error && parser.peek() != '\0') {
+        parser.fail("unexpected trailing characters");
+    }
+    if (!parser.m_error && parser.m_max_depth > EXPRESSION_MAX_STACK) {
+        parser.fail("expression too deep");
+    }
+    if (parser.m_error) {
+        return std::make_pair(parser.m_error, Expression());
+    }
+    return std::make_pair(Error(), parser.m_expression);
+}
+
+f32 Expression::evaluate(f32 viewport_width, f32 viewport_height) const {
+    f32 stack[EXPRESSION_MAX_STACK];
+    u32 top = 0;
+    for (const ExpressionInstruction& instruction : m_code) {
+        switch (instruction.m_op) {
+            case ExpressionOp::CONSTANT:
+                stack[top++] = instruction.m_value;
+                break;
+            case ExpressionOp::VIEWPORT_WIDTH:
+                stack[top++] = viewport_width;
+                break;
+            case ExpressionOp::VIEWPORT_HEIGHT:
+                stack[top++] = viewport_height;
+                break;
+            case ExpressionOp::ADD:
+                top--;
+                stack[top - 1] += stack[top];
+                break;
+            case ExpressionOp::SUB:
+                top--;
+                stack[top - 1] -= stack[top];
+                break;
+            case ExpressionOp::MUL:
+                top--;
+                stack[top - 1] *= stack[top];
+                break;
+            case ExpressionOp::DIV:
+                top--;
+                stack[top - 1] = stack[top] != 0 ? stack[top - 1] / stack[top] : 0;
+                break;
+            case ExpressionOp::NEGATE:
+                stack[top - 1] = -stack[top - 1];
+                break;
+            case ExpressionOp::CEIL:
+                stack[top - 1] = std::ceil(stack[top - 1]);
+                break;
+            case ExpressionOp::FLOOR:
+                stack[top - 1] = std::floor(stack[top - 1]);
+                break;
+            case ExpressionOp::ROUND:
+                stack[top - 1] = std::round(stack[top - 1]);
+                break;
+            case ExpressionOp::MIN:
+                top--;
+                stack[top - 1] = std::min(stack[top - 1], stack[top]);
+                break;
+            case ExpressionOp::MAX:
+                top--;
+                stack[top - 1] = std::max(stack[top - 1], stack[top]);
+                break;
+        }
+    }
+    return top > 0 ? stack[top - 1] : 0;
+}
+
+}  // namespace blaz
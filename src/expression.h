@@ -0,0 +1,45 @@
+#pragma once
+
+#include "error.h"
+#include "types.h"
+
+namespace blaz {
+
+const u32 EXPRESSION_MAX_STACK = 16;
+
+enum class ExpressionOp : u8 {
+    CONSTANT,
+    VIEWPORT_WIDTH,
+    VIEWPORT_HEIGHT,
+    ADD,
+    SUB,
+    MUL,
+    DIV,
+    NEGATE,
+    CEIL,
+    FLOOR,
+    ROUND,
+    MIN,
+    MAX,
+};
+
+struct ExpressionInstruction {
+    ExpressionOp m_op;
+    f32 m_value = 0;
+};
+
+// Arithmetic over the viewport size, such as "viewport_width/2" or "ceil(viewport_width/8)",
+// stored in postfix order so it can be re-evaluated cheaply whenever the viewport changes.
+struct Expression {
+    vec<ExpressionInstruction> m_code;
+
+    bool empty() const {
+        return m_code.empty();
+    }
+
+    f32 evaluate(f32 viewport_width, f32 viewport_height) const;
+};
+
+pair<Error, Expression> parse_expression(const str& source);
+
+}  // namespace blaz
@@ -16,9 +16,19 @@ struct FileWatcher {
     std::thread watch_thread;
 };
 
+// A read-only view of a whole file. Where the platform can, the file is mapped in memory and
+// its pages are only read when touched.
+struct MappedFile {
+    const u8* m_data = NULL;
+    u64 m_size = 0;
+    void* m_os_data = NULL;
+};
+
 pair<Error, str> read_whole_file(const str& path);
 pair<Error, vec<u8>> read_whole_file_binary(const str& path);
 Error write_to_file(const str& path, const void* buffer, size_t buffer_size);
+pair<Error, MappedFile> map_file(const str& path);
+void unmap_file(MappedFile* file);
 str get_current_directory();
 
 }  // namespace blaz
\ No newline at end of file
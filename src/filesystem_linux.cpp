@@ -1,8 +1,16 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
 #include "filesystem.h"
 
 namespace blaz {
 
-Error FileWatcher::init(const str& path, std::function<void(str)> callback) {
+Error FileWatcher::init(const str& path, std::function<void(const str&)> callback) {
     watch_thread = std::thread([this, callback]() {
 
     });
@@ -14,4 +22,121 @@ void FileWatcher::stop() {
     watch_thread.join();
 }
 
+template <typename T>
+static Error read_file(const str& path, T* file_content) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        return Error("Failed to open file '" + path + "' : " + strerror(errno));
+    }
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) == -1) {
+        close(fd);
+        return Error("Failed to get file size '" + path + "' : " + strerror(errno));
+    }
+
+    file_content->resize(size_t(file_stat.st_size));
+    size_t bytes_read = 0;
+    while (bytes_read < file_content->size()) {
+        ssize_t result =
+            read(fd, file_content->data() + bytes_read, file_content->size() - bytes_read);
+        if (result == -1 && errno == EINTR) {
+            continue;
+        }
+        if (result == -1) {
+            close(fd);
+            return Error("Failed to read file '" + path + "' : " + strerror(errno));
+        }
+        if (result == 0) {
+            break;
+        }
+        bytes_read += size_t(result);
+    }
+
+    close(fd);
+    file_content->resize(bytes_read);
+    return Error();
+}
+
+pair<Error, str> read_whole_file(const str& path) {
+    str file_content;
+    Error err = read_file(path, &file_content);
+    return std::make_pair(err, file_content);
+}
+
+pair<Error, vec<u8>> read_whole_file_binary(const str& path) {
+    vec<u8> file_content;
+    Error err = read_file(path, &file_content);
+    return std::make_pair(err, file_content);
+}
+
+Error write_to_file(const str& path, const void* buffer, size_t buffer_size) {
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+        return Error("Failed to open file '" + path + "' : " + strerror(errno));
+    }
+
+    size_t bytes_written = 0;
+    while (bytes_written < buffer_size) {
+        ssize_t result =
+            write(fd, (const u8*)buffer + bytes_written, buffer_size - bytes_written);
+        if (result == -1 && errno == EINTR) {
+            continue;
+        }
+        if (result == -1) {
+            close(fd);
+            return Error("Failed to write to file '" + path + "' : " + strerror(errno));
+        }
+        bytes_written += size_t(result);
+    }
+
+    close(fd);
+    return Error();
+}
+
+pair<Error, MappedFile> map_file(const str& path) {
+    MappedFile file;
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        return std::make_pair(Error("Failed to open file '" + path + "' : " + strerror(errno)),
+                              file);
+    }
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) == -1) {
+        close(fd);
+        return std::make_pair(
+            Error("Failed to get file size '" + path + "' : " + strerror(errno)), file);
+    }
+
+    file.m_size = u64(file_stat.st_size);
+    if (file.m_size > 0) {
+        void* data = mmap(NULL, size_t(file.m_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            return std::make_pair(Error("Failed to map file '" + path + "' : " + strerror(errno)),
+                                  MappedFile());
+        }
+        file.m_data = (const u8*)data;
+    }
+
+    close(fd);
+    return std::make_pair(Error(), file);
+}
+
+void unmap_file(MappedFile* file) {
+    if (file->m_data != NULL) {
+        munmap((void*)file->m_data, size_t(file->m_size));
+    }
+    *file = MappedFile();
+}
+
+str get_current_directory() {
+    char buffer[4096];
+    if (getcwd(buffer, sizeof(buffer)) == NULL) {
+        return "";
+    }
+    return buffer;
+}
+
 }  // namespace blaz
\ No newline at end of file
@@ -62,4 +62,25 @@ pair<Error, vec<u8>> read_whole_file_binary(str path) {
     return std::make_pair(Error(), file_content);
 }
 
+// There is no mmap on the web, the file is read into a buffer owned by the MappedFile.
+pair<Error, MappedFile> map_file(const str& path) {
+    pair<Error, vec<u8>> file_content = read_whole_file_binary(path);
+    if (file_content.first) {
+        return std::make_pair(file_content.first, MappedFile());
+    }
+
+    vec<u8>* buffer = new vec<u8>(std::move(file_content.second));
+    MappedFile file = {
+        .m_data = buffer->data(),
+        .m_size = u64(buffer->size()),
+        .m_os_data = buffer,
+    };
+    return std::make_pair(Error(), file);
+}
+
+void unmap_file(MappedFile* file) {
+    delete (vec<u8>*)file->m_os_data;
+    *file = MappedFile();
+}
+
 }  // namespace blaz
\ No newline at end of file
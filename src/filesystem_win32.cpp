@@ -173,6 +173,54 @@ Error write_to_file(const str& path, const void* buffer, size_t buffer_size) {
     return Error();
 }
 
+pair<Error, MappedFile> map_file(const str& path) {
+    MappedFile file;
+    std::wstring path_wstr = narrow_to_wide_str(path);
+    HANDLE file_handle = CreateFileW(path_wstr.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                                     OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file_handle == INVALID_HANDLE_VALUE) {
+        return std::make_pair(
+            Error("Failed to open file '" + path + "' : " + win32_get_last_error()), file);
+    }
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file_handle, &file_size)) {
+        CloseHandle(file_handle);
+        return std::make_pair(
+            Error("Failed to get file size '" + path + "' : " + win32_get_last_error()), file);
+    }
+
+    file.m_size = u64(file_size.QuadPart);
+    if (file.m_size > 0) {
+        HANDLE mapping_handle =
+            CreateFileMappingW(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping_handle == NULL) {
+            CloseHandle(file_handle);
+            return std::make_pair(
+                Error("Failed to map file '" + path + "' : " + win32_get_last_error()),
+                MappedFile());
+        }
+        file.m_data = (const u8*)MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping_handle);
+        if (file.m_data == NULL) {
+            CloseHandle(file_handle);
+            return std::make_pair(
+                Error("Failed to map file '" + path + "' : " + win32_get_last_error()),
+                MappedFile());
+        }
+    }
+
+    CloseHandle(file_handle);
+    return std::make_pair(Error(), file);
+}
+
+void unmap_file(MappedFile* file) {
+    if (file->m_data != NULL) {
+        UnmapViewOfFile(file->m_data);
+    }
+    *file = MappedFile();
+}
+
 str get_current_directory() {
     DWORD buffer_length = GetCurrentDirectory(0, NULL);
     std::string buffer(buffer_length, '\0');
@@ -0,0 +1,290 @@
+#include "frame_graph.h"
+
+#include <algorithm>
+
+#include "logger.h"
+#include "renderer.h"
+
+namespace blaz {
+
+static void add_access(vec<FrameGraphAccess>* accesses, u32 texture, bool read, bool write) {
+    for (FrameGraphAccess& access : *accesses) {
+        if (access.m_texture == texture) {
+            access.m_read |= read;
+            access.m_write |= write;
+            return;
+        }
+    }
+    accesses->push_back(FrameGraphAccess{.m_texture = texture, .m_read = read, .m_write = write});
+}
+
+static u64 texture_byte_size(const Texture& texture) {
+    u64 size = u64(texture.m_width) * texture.m_height *
+               texture_format_size(texture.m_texture_params.m_format);
+    if (texture.m_texture_params.m_target == TextureTarget::TEXTURE_CUBE_MAP) {
+        size *= 6;
+    }
+    return size;
+}
+
+static bool can_alias(const Texture& a, const Texture& b) {
+    const TextureParams& pa = a.m_texture_params;
+    const TextureParams& pb = b.m_texture_params;
+    return a.m_width == b.m_width && a.m_height == b.m_height &&
+           a.m_resize_to_viewport == b.m_resize_to_viewport && pa.m_format == pb.m_format &&
+           pa.m_target == pb.m_target && pa.m_wrap_mode_s == pb.m_wrap_mode_s &&
+           pa.m_wrap_mode_t == pb.m_wrap_mode_t && pa.m_filter_mode_min == pb.m_filter_mode_min &&
+           pa.m_filter_mode_mag == pb.m_filter_mode_mag;
+}
+
+// A read means the pass depends on what the texture held before it ran: sampling, loading a
+// framebuffer attachment that isn't cleared, or a copy that only covers part of it.
+void Renderer::collect_pass_accesses(Pass& pass, vec<FrameGraphAccess>* accesses) {
+    if (pass.m_type == PassType::COPY) {
+        PassPlan& plan = pass.m_plan;
+        Texture* src = &m_textures[plan.m_copy_src_texture];
+        Texture* dst = &m_textures[plan.m_copy_dst_texture];
+        bool partial = src->m_width != dst->m_width || src->m_height != dst->m_height;
+        add_access(accesses, plan.m_copy_src_texture, true, false);
+        add_access(accesses, plan.m_copy_dst_texture, partial, true);
+        return;
+    }
+
+    for (const auto& binding : pass.m_sampler_uniforms_bindings) {
+        if (m_textures.contains(binding.second)) {
+            add_access(accesses, m_textures.index_of(binding.second), true, false);
+        }
+    }
+
+    for (const auto& binding : pass.m_image_uniforms_bindings) {
+        if (!m_textures.contains(binding.second.first)) {
+            continue;
+        }
+        AccessType access = binding.second.second;
+        add_access(accesses, m_textures.index_of(binding.second.first),
+                   access != AccessType::WRITE_ONLY, access != AccessType::READ_ONLY);
+    }
+
+    if (pass.m_type == PassType::RENDER && !pass.m_use_default_framebuffer &&
+        m_framebuffers.contains(pass.m_framebuffer)) {
+        Framebuffer* framebuffer = &m_framebuffers[pass.m_framebuffer];
+        if (m_textures.contains(framebuffer->m_color_attachment_texture)) {
+            add_access(accesses, m_textures.index_of(framebuffer->m_color_attachment_texture),
+                       !(pass.m_clear_flag & Clear::COLOR), true);
+        }
+        if (m_textures.contains(framebuffer->m_depth_attachment_texture)) {
+            add_access(accesses, m_textures.index_of(framebuffer->m_depth_attachment_texture),
+                       !(pass.m_clear_flag & Clear::DEPTH), true);
+        }
+        if (m_textures.contains(framebuffer->m_stencil_attachment_texture)) {
+            add_access(accesses, m_textures.index_of(framebuffer->m_stencil_attachment_texture),
+                       true, true);
+        }
+    }
+}
+
+void Renderer::compile_frame_graph() {
+    FrameGraph& graph = m_frame_graph;
+    vec<bool> previous_culled_passes = std::move(graph.m_culled_passes);
+    u32 previous_aliased_texture_count = graph.m_aliased_texture_count;
+    graph = FrameGraph();
+    u32 texture_count = u32(m_textures.size());
+    u32 pass_count = u32(m_passes.size());
+    graph.m_textures.resize(texture_count);
+    graph.m_pass_accesses.resize(pass_count);
+    graph.m_culled_passes.assign(pass_count, false);
+
+    for (u32 i = 0; i < texture_count; i++) {
+        graph.m_textures[i].m_size = texture_byte_size(m_textures[i]);
+    }
+
+    for (auto& history_pair : m_history_textures) {
+        graph.m_textures[history_pair.first].m_persistent = true;
+        graph.m_textures[history_pair.second].m_persistent = true;
+    }
+
+    for (Pass& pass : m_passes_do_once) {
+        if (!pass.m_plan.m_compiled) {
+            continue;
+        }
+        vec<FrameGraphAccess> accesses;
+        collect_pass_accesses(pass, &accesses);
+        for (const FrameGraphAccess& access : accesses) {
+            graph.m_textures[access.m_texture].m_persistent = true;
+        }
+        pass.m_plan.m_texture_accesses = accesses;
+    }
+
+    // A texture whose first access in the frame reads it carries data across frames (history,
+    // loaded data, accumulation) and is neither aliased nor allowed to lose its writers. So does
+    // everything a cached or amortised pass touches, since the pass may skip frames.
+    for (u32 i = 0; i < pass_count; i++) {
+        Pass& pass = m_passes[i];
+        if (!pass.m_enabled || !pass.m_plan.m_compiled) {
+            continue;
+        }
+        collect_pass_accesses(pass, &graph.m_pass_accesses[i]);
+        pass.m_plan.m_texture_accesses = graph.m_pass_accesses[i];
+        for (const FrameGraphAccess& access : graph.m_pass_accesses[i]) {
+            FrameGraphTexture& texture = graph.m_textures[access.m_texture];
+            if (!texture.m_used) {
+                texture.m_used = true;
+                texture.m_persistent |= access.m_read;
+            }
+            texture.m_persistent |= pass.m_plan.m_cacheable || pass.m_plan.m_update_every > 1;
+            texture.m_render_target |= access.m_write;
+        }
+    }
+
+    vec<bool> needed(texture_count, false);
+    for (u32 i = pass_count; i-- > 0;) {
+        Pass& pass = m_passes[i];
+        if (!pass.m_enabled || !pass.m_plan.m_compiled) {
+            continue;
+        }
+        const vec<FrameGraphAccess>& accesses = graph.m_pass_accesses[i];
+
+        bool live = !m_frame_graph_enabled ||
+                    (pass.m_type == PassType::RENDER && pass.m_use_default_framebuffer);
+        bool writes = false;
+        for (const FrameGraphAccess& access : accesses) {
+            if (access.m_write) {
+                writes = true;
+                live |= graph.m_textures[access.m_texture].m_persistent || needed[access.m_texture];
+            }
+        }
+        if (!writes) {
+            live = true;
+        }
+
+        if (!live) {
+            graph.m_culled_passes[i] = true;
+            graph.m_culled_pass_count++;
+            pass.m_plan.m_culled = true;
+            continue;
+        }
+
+        for (const FrameGraphAccess& access : accesses) {
+            if (access.m_write && !access.m_read) {
+                needed[access.m_texture] = false;
+            }
+        }
+        for (const FrameGraphAccess& access : accesses) {
+            if (access.m_read) {
+                needed[access.m_texture] = true;
+            }
+        }
+
+        for (const FrameGraphAccess& access : accesses) {
+            FrameGraphTexture& texture = graph.m_textures[access.m_texture];
+            texture.m_first_pass = std::min(texture.m_first_pass, i);
+            texture.m_last_pass = std::max(texture.m_last_pass, i);
+        }
+    }
+
+    // Greedy interval allocation: each transient texture reuses the first compatible physical
+    // texture whose last use ends before it is first written. Textures only touched by culled
+    // passes have no lifetime and can share any compatible texture.
+    if (m_frame_graph_enabled) {
+        vec<u32> transients;
+        for (u32 i = 0; i < texture_count; i++) {
+            const FrameGraphTexture& texture = graph.m_textures[i];
+            if (texture.m_used && texture.m_render_target && !texture.m_persistent) {
+                transients.push_back(i);
+            }
+        }
+        std::stable_sort(transients.begin(), transients.end(), [&graph](u32 a, u32 b) {
+            return graph.m_textures[a].m_first_pass < graph.m_textures[b].m_first_pass;
+        });
+
+        vec<pair<u32, u32>> physical_textures;
+        for (u32 texture_index : transients) {
+            FrameGraphTexture& texture = graph.m_textures[texture_index];
+            bool no_lifetime = texture.m_first_pass == UINT32_MAX;
+            for (auto& physical : physical_textures) {
+                if ((no_lifetime || physical.second < texture.m_first_pass) &&
+                    can_alias(m_textures[physical.first], m_textures[texture_index])) {
+                    texture.m_alias = physical.first;
+                    if (!no_lifetime) {
+                        physical.second = texture.m_last_pass;
+                    }
+                    graph.m_aliased_texture_count++;
+                    break;
+                }
+            }
+            if (texture.m_alias == UINT32_MAX && !no_lifetime) {
+                physical_textures.push_back(std::make_pair(texture_index, texture.m_last_pass));
+            }
+        }
+    }
+
+    for (const FrameGraphTexture& texture : graph.m_textures) {
+        if (!texture.m_used || !texture.m_render_target) {
+            continue;
+        }
+        graph.m_render_target_bytes += texture.m_size;
+        if (texture.m_alias == UINT32_MAX) {
+            graph.m_aliased_render_target_bytes += texture.m_size;
+        }
+    }
+
+    apply_texture_aliases();
+
+    // Passes are recompiled on every shader reload, only log when the result changes.
+    if (pass_count == 0 || (graph.m_culled_passes == previous_culled_passes &&
+                            graph.m_aliased_texture_count == previous_aliased_texture_count)) {
+        return;
+    }
+    logger.info("Frame graph: ", graph.m_culled_pass_count, "/", pass_count, " passes culled, ",
+                graph.m_aliased_texture_count, " textures aliased, render targets ",
+                f64(graph.m_render_target_bytes) / (1024.0 * 1024.0), " MB -> ",
+                f64(graph.m_aliased_render_target_bytes) / (1024.0 * 1024.0), " MB");
+}
+
+void Renderer::apply_texture_aliases() {
+    bool changed = false;
+    u32 texture_count = u32(m_textures.size());
+
+    // Textures leaving an alias get their own storage back first, so that no texture ends up
+    // pointing at the storage of one that is about to be destroyed.
+    for (u32 i = 0; i < texture_count; i++) {
+        Texture* texture = &m_textures[i];
+        u32 alias = m_frame_graph.m_textures[i].m_alias;
+        if (texture->m_alias == alias || texture->m_alias == INVALID_INDEX) {
+            continue;
+        }
+        texture->m_api_data = NULL;
+        texture->m_alias = INVALID_INDEX;
+        Error err = create_texture_api(texture->m_name);
+        if (err) {
+            logger.error(err);
+        }
+        changed = true;
+    }
+
+    for (u32 i = 0; i < texture_count; i++) {
+        Texture* texture = &m_textures[i];
+        u32 alias = m_frame_graph.m_textures[i].m_alias;
+        if (texture->m_alias == alias) {
+            continue;
+        }
+        Error err = destroy_texture_api(i);
+        if (err) {
+            logger.error(err);
+        }
+        texture->m_api_data = m_textures[alias].m_api_data;
+        texture->m_alias = alias;
+        changed = true;
+    }
+
+    if (changed) {
+        for (Framebuffer& framebuffer : m_framebuffers) {
+            Error err = attach_texture_to_framebuffer(framebuffer.m_name);
+            if (err) {
+                logger.error(err);
+            }
+        }
+    }
+}
+
+}  // namespace blaz
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "types.h"
+
+namespace blaz {
+
+struct FrameGraphAccess {
+    u32 m_texture;
+    bool m_read;
+    bool m_write;
+};
+
+struct FrameGraphTexture {
+    bool m_used = false;
+    bool m_persistent = false;
+    bool m_render_target = false;
+    u32 m_first_pass = UINT32_MAX;
+    u32 m_last_pass = 0;
+    u32 m_alias = UINT32_MAX;
+    u64 m_size = 0;
+};
+
+struct FrameGraph {
+    vec<vec<FrameGraphAccess>> m_pass_accesses;
+    vec<FrameGraphTexture> m_textures;
+    vec<bool> m_culled_passes;
+    u32 m_culled_pass_count = 0;
+    u32 m_aliased_texture_count = 0;
+    u64 m_render_target_bytes = 0;
+    u64 m_aliased_render_target_bytes = 0;
+};
+
+}  // namespace blaz
@@ -1,5 +1,7 @@
 #include "game.h"
 
+#include <unordered_set>
+
 #include "camera.h"
 #include "cfgreader.h"
 #include "error.h"
@@ -25,8 +27,15 @@ void Game::run() {
     void* arg = (void*)(this);
     emscripten_set_main_loop_arg(emscripten_main_loop, arg, 0, true);
 #else
+    if (m_pipelined_rendering) {
+        Error err = m_renderer->start_render_thread();
+        if (err) {
+            logger.error(err);
+        }
+    }
     while (m_main_loop()) {
     }
+    m_renderer->stop_render_thread();
 #endif
 }
 
@@ -112,21 +121,37 @@ Error Game::load_game(const str& path) {
         }
 
         if (texture_cfg["width"]) {
-            if (texture_cfg["width"].str_value == "viewport_width") {
-                texture.m_resize_to_viewport = true;
+            if (texture_cfg["width"].str_value != "") {
+                auto [err, expression] = parse_expression(texture_cfg["width"].str_value);
+                if (err) {
+                    logger.error(err);
+                } else {
+                    texture.m_width_expression = expression;
+                    texture.m_resize_to_viewport = true;
+                }
             } else {
                 texture.m_width = u32(texture_cfg["width"].float_value);
             }
         }
 
         if (texture_cfg["height"]) {
-            if (texture_cfg["height"].str_value == "viewport_height") {
-                texture.m_resize_to_viewport = true;
+            if (texture_cfg["height"].str_value != "") {
+                auto [err, expression] = parse_expression(texture_cfg["height"].str_value);
+                if (err) {
+                    logger.error(err);
+                } else {
+                    texture.m_height_expression = expression;
+                    texture.m_resize_to_viewport = true;
+                }
             } else {
                 texture.m_height = u32(texture_cfg["height"].float_value);
             }
         }
 
+        if (texture_cfg["history_texture"]) {
+            texture.m_history_texture = texture_cfg["history_texture"].str_value;
+        }
+
         m_renderer->create_texture(texture);
     }
 
@@ -183,6 +208,7 @@ Error Game::load_game(const str& path) {
         m_renderer->create_material(material);
     }
 
+    std::unordered_set<str> static_nodes;
     for (auto& node_cfg : game_cfg["nodes"]) {
         Node node;
         node.m_name = node_cfg["name"].str_value;
@@ -190,6 +216,11 @@ Error Game::load_game(const str& path) {
         node.m_rotation = node_cfg["rotation"].vec4_value;
         node.m_scale = node_cfg["scale"].vec3_value;
         add_node(m_scene, node, node_cfg["parent"].str_value);
+        // Parents are loaded before their children, so this covers the whole parent chain.
+        if (node_cfg["static"].bool_value ||
+            static_nodes.contains(node_cfg["parent"].str_value)) {
+            static_nodes.insert(node.m_name);
+        }
     }
     m_scene->m_nodes[0].update_matrix();
 
@@ -202,12 +233,11 @@ Error Game::load_game(const str& path) {
         renderable.m_mesh = renderable_cfg["mesh"].str_value;
         renderable.m_node = renderable_cfg["node"].str_value;
         renderable.m_material = renderable_cfg["material"].str_value;
+        renderable.m_occluder_mesh = renderable_cfg["occluder_mesh"].str_value;
+        renderable.m_static =
+            renderable_cfg["static"].bool_value || static_nodes.contains(renderable.m_node);
 
-        m_renderer->m_renderables.push_back(renderable);
-        u32 id = u32(m_renderer->m_renderables.size()) - 1;
-        for (auto& tag : renderable_cfg["tags"]) {
-            m_renderer->m_tagged_renderables[tag.str_value].push_back(id);
-        }
+        m_renderer->create_renderable(renderable);
     }
 
     for (auto& camera_cfg : game_cfg["cameras"]) {
@@ -303,7 +333,15 @@ Error Game::load_game(const str& path) {
         if (pass_cfg["compute_work_groups"]) {
             for (u32 i = 0; i < 3; i++) {
                 if (pass_cfg["compute_work_groups"][i].str_value != "") {
-                    pass.m_compute_work_groups[i] = pass_cfg["compute_work_groups"][i].str_value;
+                    auto [err, expression] =
+                        parse_expression(pass_cfg["compute_work_groups"][i].str_value);
+                    if (err) {
+                        logger.error("Game::load_game: Work groups of pass \"" + pass.m_name +
+                                     "\" fall back to 1, " + err.message());
+                        pass.m_compute_work_groups[i] = 1u;
+                    } else {
+                        pass.m_compute_work_groups[i] = expression;
+                    }
                 } else {
                     pass.m_compute_work_groups[i] =
                         u32(pass_cfg["compute_work_groups"][i].float_value);
@@ -311,6 +349,17 @@ Error Game::load_game(const str& path) {
             }
         }
 
+        if (pass_cfg["update_every"]) {
+            pass.m_update_every = u32(pass_cfg["update_every"].float_value);
+        }
+        if (pass_cfg["phase"]) {
+            pass.m_phase = u32(pass_cfg["phase"].float_value);
+        }
+
+        if (pass_cfg["cacheable"]) {
+            pass.m_cacheable = pass_cfg["cacheable"].bool_value;
+        }
+
         if (pass_cfg["copy_src_texture"]) {
             pass.m_copy_src_texture = pass_cfg["copy_src_texture"].str_value;
             pass.m_copy_dst_texture = pass_cfg["copy_dst_texture"].str_value;
@@ -320,8 +369,87 @@ Error Game::load_game(const str& path) {
     }
 
     m_renderer->m_current_scene = m_scene;
+    m_renderer->m_should_compile_passes = true;
     if (m_physics != NULL) m_physics->m_current_scene = m_scene;
 
+    if (game_cfg["frame_graph"]) {
+        m_renderer->m_frame_graph_enabled = game_cfg["frame_graph"].bool_value;
+    }
+    if (game_cfg["pipelined_rendering"]) {
+        m_pipelined_rendering = game_cfg["pipelined_rendering"].bool_value;
+    }
+    if (game_cfg["pipeline_throttle"]) {
+        m_renderer->m_pipeline_throttle = game_cfg["pipeline_throttle"].bool_value;
+    }
+    if (game_cfg["frustum_culling"]) {
+        m_renderer->m_frustum_culling = game_cfg["frustum_culling"].bool_value;
+    }
+    if (game_cfg["bvh_culling"]) {
+        m_renderer->m_bvh_culling = game_cfg["bvh_culling"].bool_value;
+    }
+    if (game_cfg["mesh_lod"]) {
+        m_renderer->m_mesh_lod = game_cfg["mesh_lod"].bool_value;
+    }
+    if (game_cfg["lod_pixel_error"]) {
+        m_renderer->m_lod_pixel_error = game_cfg["lod_pixel_error"].float_value;
+    }
+    if (game_cfg["occlusion_culling"]) {
+        m_renderer->m_occlusion_culling = game_cfg["occlusion_culling"].bool_value;
+    }
+    if (game_cfg["meshlet_culling"]) {
+        m_renderer->m_meshlet_culling = game_cfg["meshlet_culling"].bool_value;
+    }
+#ifdef EMSCRIPTEN
+    // WebGL has neither base vertex draws nor multi draw indirect.
+    if (game_cfg["mesh_pooling"] && game_cfg["mesh_pooling"].bool_value) {
+        logger.error("Game::load_game: mesh_pooling is not supported by WebGL, ignored");
+    }
+    if (game_cfg["multi_draw_indirect"] && game_cfg["multi_draw_indirect"].bool_value) {
+        logger.error("Game::load_game: multi_draw_indirect is not supported by WebGL, ignored");
+    }
+#else
+    if (game_cfg["mesh_pooling"]) {
+        m_renderer->m_mesh_pooling = game_cfg["mesh_pooling"].bool_value;
+    }
+    if (game_cfg["multi_draw_indirect"]) {
+        m_renderer->m_multi_draw_indirect = game_cfg["multi_draw_indirect"].bool_value;
+    }
+#endif
+    if (game_cfg["static_batching"]) {
+        m_renderer->m_static_batching = game_cfg["static_batching"].bool_value;
+    }
+    m_renderer->build_static_batches();
+    if (game_cfg["dynamic_resolution"]) {
+        CfgNode resolution_cfg = game_cfg["dynamic_resolution"];
+        DynamicResolution& dynamic_resolution = m_renderer->m_dynamic_resolution;
+        dynamic_resolution.m_enabled = true;
+        if (resolution_cfg["enabled"]) {
+            dynamic_resolution.m_enabled = resolution_cfg["enabled"].bool_value;
+        }
+        if (resolution_cfg["target_frame_time_ms"]) {
+            dynamic_resolution.m_target_frame_time_ms =
+                resolution_cfg["target_frame_time_ms"].float_value;
+        }
+        if (resolution_cfg["min_scale"]) {
+            dynamic_resolution.m_min_scale = resolution_cfg["min_scale"].float_value;
+        }
+        if (resolution_cfg["max_scale"]) {
+            dynamic_resolution.m_max_scale = resolution_cfg["max_scale"].float_value;
+            dynamic_resolution.m_scale = dynamic_resolution.m_max_scale;
+        }
+        if (resolution_cfg["tolerance"]) {
+            dynamic_resolution.m_tolerance = resolution_cfg["tolerance"].float_value;
+        }
+        if (resolution_cfg["max_step"]) {
+            dynamic_resolution.m_max_step = resolution_cfg["max_step"].float_value;
+        }
+        if (resolution_cfg["adjust_interval"]) {
+            dynamic_resolution.m_adjust_interval =
+                u32(resolution_cfg["adjust_interval"].float_value);
+        }
+        m_renderer->resize_viewport(m_renderer->m_viewport_size);
+    }
+
     if (game_cfg["main_camera"]) {
         main_camera = &m_renderer->m_cameras[game_cfg["main_camera"].str_value];
     }
@@ -23,6 +23,7 @@ struct Game {
     std::unordered_map<str, vec<str>> m_shader_file_dependencies;
 
     std::function<bool()> m_main_loop;
+    bool m_pipelined_rendering = false;
     void run();
 
     ~Game(){
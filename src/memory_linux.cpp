@@ -0,0 +1,20 @@
+#include <cstdlib>
+#include <cstring>
+
+#include "memory.h"
+
+namespace blaz {
+
+void* alloc(size_t size) {
+    return malloc(size);
+}
+
+void dealloc(void* ptr) {
+    free(ptr);
+}
+
+void memcopy(void* dst, const void* src, size_t count) {
+    memcpy(dst, src, count);
+}
+
+}  // namespace blaz
\ No newline at end of file
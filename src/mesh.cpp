@@ -1,5 +1,8 @@
 #include "mesh.h"
 
+#include <cstdio>
+#include <cstring>
+
 #include "filesystem.h"
 #include "logger.h"
 #include "memory.h"
@@ -8,6 +11,84 @@
 
 namespace blaz {
 
+span<const f32> mesh_vertices(const Mesh* mesh) {
+    if (mesh->m_file.m_data != NULL) {
+        return mesh->m_mapped_vertices;
+    }
+    return mesh->m_vertices;
+}
+
+span<const u32> mesh_indices(const Mesh* mesh) {
+    if (mesh->m_file.m_data != NULL) {
+        return mesh->m_mapped_indices;
+    }
+    return mesh->m_indices;
+}
+
+void copy_mesh_data(Mesh* mesh) {
+    if (mesh->m_file.m_data == NULL) {
+        return;
+    }
+    mesh->m_vertices.assign(mesh->m_mapped_vertices.begin(), mesh->m_mapped_vertices.end());
+    mesh->m_indices.assign(mesh->m_mapped_indices.begin(), mesh->m_mapped_indices.end());
+    mesh->m_mapped_vertices = {};
+    mesh->m_mapped_indices = {};
+    unmap_file(&mesh->m_file);
+}
+
+// The bounding sphere is centered on the AABB, which is close enough to the minimal sphere for
+// culling and cheap to compute.
+// Floats per vertex and offset of the "position" attribute in them. Returns false when there
+// is no such attribute or no vertex.
+bool mesh_position_layout(const Mesh* mesh, u32* stride, u32* position_offset) {
+    *stride = 0;
+    *position_offset = UINT32_MAX;
+    for (auto& attrib : mesh->m_attribs) {
+        if (attrib.first == "position" && attrib.second >= 3) {
+            *position_offset = *stride;
+        }
+        *stride += attrib.second;
+    }
+    return *position_offset != UINT32_MAX && *stride != 0 &&
+           mesh_vertices(mesh).size() >= *stride;
+}
+
+void compute_mesh_bounds(Mesh* mesh) {
+    u32 stride;
+    u32 position_offset;
+    mesh->m_has_bounds = false;
+    if (!mesh_position_layout(mesh, &stride, &position_offset)) {
+        return;
+    }
+
+    span<const f32> vertices = mesh_vertices(mesh);
+    size_t vertex_count = vertices.size() / stride;
+    const f32* position = vertices.data() + position_offset;
+    Vec3 aabb_min = Vec3(position[0], position[1], position[2]);
+    Vec3 aabb_max = aabb_min;
+    for (size_t i = 1; i < vertex_count; i++) {
+        position += stride;
+        for (u32 j = 0; j < 3; j++) {
+            aabb_min.v[j] = std::min(aabb_min.v[j], position[j]);
+            aabb_max.v[j] = std::max(aabb_max.v[j], position[j]);
+        }
+    }
+
+    Vec3 center = (aabb_min + aabb_max) * 0.5f;
+    f32 radius_squared = 0;
+    position = vertices.data() + position_offset;
+    for (size_t i = 0; i < vertex_count; i++, position += stride) {
+        Vec3 offset = Vec3(position[0], position[1], position[2]) - center;
+        radius_squared = std::max(radius_squared, vec3_dot(offset, offset));
+    }
+
+    mesh->m_aabb_min = aabb_min;
+    mesh->m_aabb_max = aabb_max;
+    mesh->m_bounding_sphere_center = center;
+    mesh->m_bounding_sphere_radius = std::sqrt(radius_squared);
+    mesh->m_has_bounds = true;
+}
+
 Error make_cube(Mesh* mesh) {
     mesh->m_vertices = {
         -0.5, 0.5,  0.5,  0.0,  0.0,  1.0,  0.0, 0.0, 0.5,  0.5,  0.5,  0.0,  0.0,  1.0,  1.0, 0.0,
@@ -33,6 +114,7 @@ Error make_cube(Mesh* mesh) {
         {"texcoord", 2},
     };
     mesh->m_primitive = MeshPrimitive::TRIANGLES;
+    compute_mesh_bounds(mesh);
     return Error();
 }
 
@@ -50,6 +132,7 @@ Error make_cube_wireframe(Mesh* mesh) {
         {"position", 3},
     };
     mesh->m_primitive = MeshPrimitive::LINES;
+    compute_mesh_bounds(mesh);
     return Error();
 }
 
@@ -69,6 +152,7 @@ Error make_plane(Mesh* mesh) {
         {"texcoord", 2},
     };
     mesh->m_primitive = MeshPrimitive::TRIANGLES;
+    compute_mesh_bounds(mesh);
     return Error();
 }
 
@@ -201,6 +285,7 @@ Error make_uv_sphere(Mesh* mesh, u32 slices, u32 stacks) {
         }
     }
 
+    compute_mesh_bounds(mesh);
     return generate_tangent(mesh);
 }
 
@@ -227,74 +312,221 @@ Error make_wireframe_sphere(Mesh* mesh, u32 vertices) {
         mesh->m_indices.insert(mesh->m_indices.end(), {index, side * vertices});
     }
 
+    compute_mesh_bounds(mesh);
     return Error();
 }
 
-Error export_mesh_file(const str& path, Mesh* mesh) {
-    size_t buffer_size = sizeof(size_t) +                     // mesh name size
-                         sizeof(char) * mesh->m_name.size();  // mesh name
+static u64 align_mesh_file_offset(u64 offset) {
+    return (offset + MESH_FILE_ALIGNMENT - 1) / MESH_FILE_ALIGNMENT * MESH_FILE_ALIGNMENT;
+}
+
+static u32 mesh_file_checksum(const u8* data, u64 size) {
+    u32 hash = 2166136261u;
+    for (u64 i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+}
 
-    buffer_size += sizeof(size_t);  // number of attribs
+Error export_mesh_file(const str& path, Mesh* mesh, bool checksum) {
+    span<const f32> vertices = mesh_vertices(mesh);
+    span<const u32> indices = mesh_indices(mesh);
+
+    vec<MeshFileAttrib> attribs;
+    u32 stride = 0;
     for (auto& attrib : mesh->m_attribs) {
-        buffer_size += sizeof(size_t);                      // attrib name size
-        buffer_size += sizeof(char) * attrib.first.size();  // attrib name
-        buffer_size += sizeof(u32);                         // attrib size
+        if (attrib.first.size() >= MESH_FILE_ATTRIB_NAME_SIZE) {
+            return Error("Attribute name '" + attrib.first + "' is too long for a mesh file");
+        }
+        MeshFileAttrib file_attrib = {.m_size = attrib.second};
+        memcopy(file_attrib.m_name, attrib.first.data(), attrib.first.size());
+        attribs.push_back(file_attrib);
+        stride += attrib.second;
     }
-    buffer_size += sizeof(size_t);                         // vertices size
-    buffer_size += mesh->m_vertices.size() * sizeof(f32);  // vertices
-    buffer_size += sizeof(size_t);                         // indices size
-    buffer_size += mesh->m_indices.size() * sizeof(u32);   // indices
 
-    u8* buffer = (u8*)alloc(buffer_size);
-    u8* ptr = buffer;
+    MeshFileHeader header = {
+        .m_flags = mesh->m_has_bounds ? MESH_FILE_BOUNDS : 0,
+        .m_primitive = u32(mesh->m_primitive),
+        .m_vertex_stride = stride,
+        .m_vertex_count = stride > 0 ? u32(vertices.size() / stride) : 0,
+        .m_index_count = u32(indices.size()),
+        .m_bounding_sphere_radius = mesh->m_bounding_sphere_radius,
+    };
+    for (u32 i = 0; i < 3; i++) {
+        header.m_aabb_min[i] = mesh->m_aabb_min.v[i];
+        header.m_aabb_max[i] = mesh->m_aabb_max.v[i];
+        header.m_bounding_sphere_center[i] = mesh->m_bounding_sphere_center.v[i];
+    }
 
-    size_t name_size = mesh->m_name.size();
-    memcopy(ptr, &name_size, sizeof(size_t));
-    ptr += sizeof(size_t);
+    u64 file_size = sizeof(MeshFileHeader);
+    auto place = [&](MeshFileSection* section, u64 size) {
+        section->m_offset = align_mesh_file_offset(file_size);
+        section->m_size = size;
+        file_size = section->m_offset + size;
+    };
+    place(&header.m_name, mesh->m_name.size());
+    place(&header.m_attribs, attribs.size() * sizeof(MeshFileAttrib));
+    place(&header.m_vertices, u64(header.m_vertex_count) * stride * sizeof(f32));
+    place(&header.m_indices, indices.size() * sizeof(u32));
+    place(&header.m_lods, mesh->m_lods.size() * sizeof(MeshLod));
+    place(&header.m_meshlets, mesh->m_meshlets.size() * sizeof(Meshlet));
+    file_size = align_mesh_file_offset(file_size);
+
+    vec<u8> buffer(file_size, 0);
+    auto write = [&](const MeshFileSection& section, const void* data) {
+        if (section.m_size > 0) {
+            memcopy(&buffer[section.m_offset], data, section.m_size);
+        }
+    };
+    write(header.m_name, mesh->m_name.data());
+    write(header.m_attribs, attribs.data());
+    write(header.m_vertices, vertices.data());
+    write(header.m_indices, indices.data());
+    write(header.m_lods, mesh->m_lods.data());
+    write(header.m_meshlets, mesh->m_meshlets.data());
+
+    if (checksum) {
+        header.m_flags |= MESH_FILE_CHECKSUM;
+        header.m_checksum = mesh_file_checksum(buffer.data() + sizeof(MeshFileHeader),
+                                               file_size - sizeof(MeshFileHeader));
+    }
+    memcopy(buffer.data(), &header, sizeof(MeshFileHeader));
 
-    memcopy(ptr, mesh->m_name.data(), name_size * sizeof(char));
-    ptr += name_size * sizeof(char);
+    // The file may be mapped by a running game, it is replaced rather than rewritten in place.
+    str temporary_path = path + ".tmp";
+    Error err = write_to_file(temporary_path, buffer.data(), buffer.size());
+    if (err) {
+        return err;
+    }
+    if (std::rename(temporary_path.c_str(), path.c_str()) != 0) {
+        std::remove(path.c_str());
+        if (std::rename(temporary_path.c_str(), path.c_str()) != 0) {
+            return Error("Failed to replace file '" + path + "'");
+        }
+    }
+    return Error();
+}
 
-    size_t n_attribs = mesh->m_attribs.size();
-    memcopy(ptr, &n_attribs, sizeof(size_t));
-    ptr += sizeof(size_t);
+static bool mesh_file_section_valid(const MeshFileSection& section, u64 file_size,
+                                    u64 element_size) {
+    return section.m_offset % MESH_FILE_ALIGNMENT == 0 && section.m_offset <= file_size &&
+           section.m_size <= file_size - section.m_offset && section.m_size % element_size == 0;
+}
 
-    for (auto& attrib : mesh->m_attribs) {
-        size_t attrib_name_size = attrib.first.size();
-        memcopy(ptr, &attrib_name_size, sizeof(size_t));
-        ptr += sizeof(size_t);
+static Error read_mesh_file(Mesh* mesh, const MappedFile& file) {
+    const str& path = mesh->m_path;
+    MeshFileHeader header;
+    if (file.m_size < sizeof(MeshFileHeader)) {
+        return Error("Mesh file '" + path + "' is truncated");
+    }
+    memcopy(&header, file.m_data, sizeof(MeshFileHeader));
+    if (header.m_magic != MESH_FILE_MAGIC) {
+        return Error("'" + path + "' is not a mesh file, files in the legacy format are " +
+                     "converted with mesh_convert");
+    }
+    if (header.m_version != MESH_FILE_VERSION) {
+        return Error("Mesh file '" + path + "' has version " +
+                     std::to_string(header.m_version) + ", expected " +
+                     std::to_string(MESH_FILE_VERSION));
+    }
 
-        memcopy(ptr, attrib.first.data(), attrib_name_size * sizeof(char));
-        ptr += attrib_name_size * sizeof(char);
+    u64 vertices_size = u64(header.m_vertex_count) * header.m_vertex_stride * sizeof(f32);
+    u64 indices_size = u64(header.m_index_count) * sizeof(u32);
+    if (!mesh_file_section_valid(header.m_name, file.m_size, 1) ||
+        !mesh_file_section_valid(header.m_attribs, file.m_size, sizeof(MeshFileAttrib)) ||
+        !mesh_file_section_valid(header.m_vertices, file.m_size, sizeof(f32)) ||
+        !mesh_file_section_valid(header.m_indices, file.m_size, sizeof(u32)) ||
+        !mesh_file_section_valid(header.m_lods, file.m_size, sizeof(MeshLod)) ||
+        !mesh_file_section_valid(header.m_meshlets, file.m_size, sizeof(Meshlet)) ||
+        header.m_vertices.m_size != vertices_size || header.m_indices.m_size != indices_size ||
+        header.m_primitive > u32(MeshPrimitive::LINES)) {
+        return Error("Mesh file '" + path + "' is corrupted");
+    }
+    span<const u32> indices((const u32*)(file.m_data + header.m_indices.m_offset),
+                            header.m_index_count);
+    if (header.m_flags & MESH_FILE_CHECKSUM) {
+        if (mesh_file_checksum(file.m_data + sizeof(MeshFileHeader),
+                               file.m_size - sizeof(MeshFileHeader)) != header.m_checksum) {
+            return Error("Mesh file '" + path + "' does not match its checksum");
+        }
+        for (u32 index : indices) {
+            if (index >= header.m_vertex_count) {
+                return Error("Mesh file '" + path + "' has out of range indices");
+            }
+        }
+    }
 
-        memcopy(ptr, &attrib.second, sizeof(u32));
-        ptr += sizeof(u32);
+    vec<pair<str, u32>> attribs;
+    u32 stride = 0;
+    const MeshFileAttrib* file_attribs =
+        (const MeshFileAttrib*)(file.m_data + header.m_attribs.m_offset);
+    for (u64 i = 0; i < header.m_attribs.m_size / sizeof(MeshFileAttrib); i++) {
+        const char* name = file_attribs[i].m_name;
+        attribs.push_back(
+            std::make_pair(str(name, strnlen(name, MESH_FILE_ATTRIB_NAME_SIZE)),
+                           file_attribs[i].m_size));
+        stride += file_attribs[i].m_size;
+    }
+    if (stride != header.m_vertex_stride) {
+        return Error("Mesh file '" + path + "' is corrupted");
     }
 
-    size_t vertices_size = mesh->m_vertices.size();
-    memcopy(ptr, &vertices_size, sizeof(size_t));
-    ptr += sizeof(size_t);
-    memcopy(ptr, mesh->m_vertices.data(), vertices_size * sizeof(f32));
-    ptr += vertices_size * sizeof(f32);
+    mesh->m_name.assign((const char*)file.m_data + header.m_name.m_offset, header.m_name.m_size);
+    mesh->m_attribs = attribs;
+    mesh->m_lods.resize(header.m_lods.m_size / sizeof(MeshLod));
+    memcopy(mesh->m_lods.data(), file.m_data + header.m_lods.m_offset, header.m_lods.m_size);
+    mesh->m_meshlets.resize(header.m_meshlets.m_size / sizeof(Meshlet));
+    memcopy(mesh->m_meshlets.data(), file.m_data + header.m_meshlets.m_offset,
+            header.m_meshlets.m_size);
+    mesh->m_primitive = MeshPrimitive(header.m_primitive);
+
+    unmap_file(&mesh->m_file);
+    mesh->m_vertices = vec<f32>();
+    mesh->m_indices = vec<u32>();
+    mesh->m_file = file;
+    mesh->m_mapped_vertices =
+        span<const f32>((const f32*)(file.m_data + header.m_vertices.m_offset),
+                        vertices_size / sizeof(f32));
+    mesh->m_mapped_indices = indices;
+
+    if (header.m_flags & MESH_FILE_BOUNDS) {
+        mesh->m_aabb_min = Vec3(header.m_aabb_min[0], header.m_aabb_min[1], header.m_aabb_min[2]);
+        mesh->m_aabb_max = Vec3(header.m_aabb_max[0], header.m_aabb_max[1], header.m_aabb_max[2]);
+        mesh->m_bounding_sphere_center =
+            Vec3(header.m_bounding_sphere_center[0], header.m_bounding_sphere_center[1],
+                 header.m_bounding_sphere_center[2]);
+        mesh->m_bounding_sphere_radius = header.m_bounding_sphere_radius;
+        mesh->m_has_bounds = true;
+    } else {
+        compute_mesh_bounds(mesh);
+    }
+    return Error();
+}
 
-    size_t indices_size = mesh->m_indices.size();
-    memcopy(ptr, &indices_size, sizeof(size_t));
-    ptr += sizeof(size_t);
-    memcopy(ptr, mesh->m_indices.data(), indices_size * sizeof(u32));
-    ptr += indices_size * sizeof(u32);
+Error load_mesh_from_file(Mesh* mesh) {
+    pair<Error, MappedFile> file = map_file(mesh->m_path);
+    if (file.first) {
+        return file.first;
+    }
 
-    Error err = write_to_file(path, buffer, buffer_size);
-    dealloc(buffer);
+    Error err = read_mesh_file(mesh, file.second);
+    if (err) {
+        unmap_file(&file.second);
+    }
     return err;
 }
 
-Error load_mesh_from_file(Mesh* mesh) {
+Error load_legacy_mesh_file(Mesh* mesh) {
     pair<Error, vec<u8>> file_content = read_whole_file_binary(mesh->m_path);
     if (file_content.first) {
         return file_content.first;
     }
 
+    unmap_file(&mesh->m_file);
+    mesh->m_mapped_vertices = {};
+    mesh->m_mapped_indices = {};
     u8* ptr = file_content.second.data();
+    u8* end = file_content.second.data() + file_content.second.size();
 
     size_t name_size;
     memcopy(&name_size, ptr, sizeof(size_t));
@@ -308,6 +540,7 @@ Error load_mesh_from_file(Mesh* mesh) {
     memcopy(&n_attribs, ptr, sizeof(size_t));
     ptr += sizeof(size_t);
 
+    mesh->m_attribs.clear();
     for (size_t i = 0; i < n_attribs; i++) {
         size_t attrib_name_size;
         memcopy(&attrib_name_size, ptr, sizeof(size_t));
@@ -328,6 +561,9 @@ Error load_mesh_from_file(Mesh* mesh) {
     size_t vertices_size;
     memcopy(&vertices_size, ptr, sizeof(size_t));
     ptr += sizeof(size_t);
+    if (ptr > end || vertices_size > size_t(end - ptr) / sizeof(f32)) {
+        return Error("Mesh file '" + mesh->m_path + "' is truncated");
+    }
 
     mesh->m_vertices.resize(vertices_size);
     memcopy(mesh->m_vertices.data(), ptr, vertices_size * sizeof(f32));
@@ -336,13 +572,42 @@ Error load_mesh_from_file(Mesh* mesh) {
     size_t indices_size;
     memcopy(&indices_size, ptr, sizeof(size_t));
     ptr += sizeof(size_t);
+    // Some files were written with their last indices cut off, the whole triangles are kept.
+    size_t indices_available = ptr <= end ? size_t(end - ptr) / sizeof(u32) : 0;
+    if (indices_size > indices_available) {
+        indices_size = indices_available / 3 * 3;
+    }
 
     mesh->m_indices.resize(indices_size);
     memcopy(mesh->m_indices.data(), ptr, indices_size * sizeof(u32));
     ptr += indices_size * sizeof(u32);
 
+    // Files written before detail levels existed end with the indices.
+    mesh->m_lods.clear();
+    if (ptr + sizeof(size_t) <= end) {
+        size_t lods_size;
+        memcopy(&lods_size, ptr, sizeof(size_t));
+        ptr += sizeof(size_t);
+
+        mesh->m_lods.resize(lods_size);
+        memcopy(mesh->m_lods.data(), ptr, lods_size * sizeof(MeshLod));
+        ptr += lods_size * sizeof(MeshLod);
+    }
+
+    mesh->m_meshlets.clear();
+    if (ptr + sizeof(size_t) <= end) {
+        size_t meshlets_size;
+        memcopy(&meshlets_size, ptr, sizeof(size_t));
+        ptr += sizeof(size_t);
+
+        mesh->m_meshlets.resize(meshlets_size);
+        memcopy(mesh->m_meshlets.data(), ptr, meshlets_size * sizeof(Meshlet));
+        ptr += meshlets_size * sizeof(Meshlet);
+    }
+
     mesh->m_primitive = MeshPrimitive::TRIANGLES;
 
+    compute_mesh_bounds(mesh);
     return Error();
 }
 
@@ -481,6 +746,7 @@ Error load_mesh_from_obj_file(Mesh* mesh) {
 
     generate_tangent(mesh);
 
+    compute_mesh_bounds(mesh);
     return Error();
 }
 
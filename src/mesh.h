@@ -7,6 +7,66 @@ namespace blaz {
 
 struct Mesh;
 
+// A mesh file is a fixed header followed by sections placed at MESH_FILE_ALIGNMENT byte
+// offsets, so that a mapped file can be used in place. Sections are located by their offset
+// and size in bytes from the start of the file. All values are little endian.
+const u32 MESH_FILE_MAGIC = 0x4d5a4c42;  // "BLZM"
+const u32 MESH_FILE_VERSION = 1;
+const u32 MESH_FILE_ALIGNMENT = 16;
+const u32 MESH_FILE_ATTRIB_NAME_SIZE = 28;
+// m_checksum is the FNV-1a hash of all the bytes after the header. Loading such a file also
+// checks every index, reading the whole file, so only files written by the tools for debugging
+// set it. Shipped files leave it unset and their loads only touch the pages that get used.
+const u32 MESH_FILE_CHECKSUM = 1 << 0;
+const u32 MESH_FILE_BOUNDS = 1 << 1;
+
+struct MeshFileSection {
+    u64 m_offset = 0;
+    u64 m_size = 0;
+};
+
+struct MeshFileAttrib {
+    char m_name[MESH_FILE_ATTRIB_NAME_SIZE] = {};
+    u32 m_size = 0;
+};
+
+struct MeshFileHeader {
+    u32 m_magic = MESH_FILE_MAGIC;
+    u32 m_version = MESH_FILE_VERSION;
+    u32 m_flags = 0;
+    u32 m_checksum = 0;
+    u32 m_primitive = 0;
+    // Floats per vertex, the sum of the attribute sizes.
+    u32 m_vertex_stride = 0;
+    u32 m_vertex_count = 0;
+    u32 m_index_count = 0;
+    f32 m_aabb_min[3] = {};
+    f32 m_aabb_max[3] = {};
+    f32 m_bounding_sphere_center[3] = {};
+    f32 m_bounding_sphere_radius = 0;
+    MeshFileSection m_name;
+    // MeshFileAttrib array.
+    MeshFileSection m_attribs;
+    MeshFileSection m_vertices;
+    MeshFileSection m_indices;
+    // MeshLod array.
+    MeshFileSection m_lods;
+    // Meshlet array.
+    MeshFileSection m_meshlets;
+    u32 m_reserved[2] = {};
+};
+static_assert(sizeof(MeshFileHeader) % MESH_FILE_ALIGNMENT == 0);
+
+// Vertices and indices of the mesh, read in place from its mapped file when it has one.
+span<const f32> mesh_vertices(const Mesh* mesh);
+span<const u32> mesh_indices(const Mesh* mesh);
+// Copies the mapped vertices and indices into m_vertices and m_indices and unmaps the file, so
+// that they can be edited.
+void copy_mesh_data(Mesh* mesh);
+
+bool mesh_position_layout(const Mesh* mesh, u32* stride, u32* position_offset);
+void compute_mesh_bounds(Mesh* mesh);
+
 Error make_cube(Mesh* mesh);
 Error make_cube_wireframe(Mesh* mesh);
 Error make_plane(Mesh* mesh);
@@ -14,7 +74,12 @@ Error make_uv_sphere(Mesh* mesh, u32 slices, u32 stacks);
 Error make_wireframe_sphere(Mesh* mesh, u32 vertices);
 
 Error load_mesh_from_obj_file(Mesh* mesh);
+// Maps the file at m_path. The vertex and index sections are not copied, the upload to the GPU
+// reads them from the mapping.
 Error load_mesh_from_file(Mesh* mesh);
-Error export_mesh_file(const str& path, Mesh* mesh);
+// Reads the unversioned format written before MESH_FILE_VERSION 1, where every array is
+// prefixed with a host size_t length.
+Error load_legacy_mesh_file(Mesh* mesh);
+Error export_mesh_file(const str& path, Mesh* mesh, bool checksum = false);
 
 }  // namespace blaz
\ No newline at end of file
@@ -0,0 +1,265 @@
+#include "mesh_simplify.h"
+
+#include <cmath>
+#include <queue>
+#include <unordered_map>
+
+#include "mesh.h"
+#include "my_math.h"
+#include "renderer.h"
+
+namespace blaz {
+
+const f32 LOD_MIN_REDUCTION = 0.8f;
+// Largest error of a level relative to the bounding sphere radius of the mesh.
+const f32 LOD_MAX_RELATIVE_ERROR = 0.02f;
+
+// Symmetric 4x4 matrix summing the squared distance to a set of planes.
+struct Quadric {
+    f64 m[10] = {};
+
+    void add_plane(f64 a, f64 b, f64 c, f64 d) {
+        f64 plane[4] = {a, b, c, d};
+        u32 k = 0;
+        for (u32 i = 0; i < 4; i++) {
+            for (u32 j = i; j < 4; j++) {
+                m[k++] += plane[i] * plane[j];
+            }
+        }
+    }
+
+    void add(const Quadric& other) {
+        for (u32 i = 0; i < 10; i++) {
+            m[i] += other.m[i];
+        }
+    }
+
+    f64 evaluate(Vec3 p) const {
+        f64 x = p.v[0];
+        f64 y = p.v[1];
+        f64 z = p.v[2];
+        return m[0] * x * x + 2 * m[1] * x * y + 2 * m[2] * x * z + 2 * m[3] * x + m[4] * y * y +
+               2 * m[5] * y * z + 2 * m[6] * y + m[7] * z * z + 2 * m[8] * z + m[9];
+    }
+};
+
+struct Collapse {
+    f64 m_cost;
+    u32 m_from;
+    u32 m_to;
+    u32 m_from_version;
+    u32 m_to_version;
+
+    bool operator>(const Collapse& other) const {
+        return m_cost > other.m_cost;
+    }
+};
+
+static Vec3 triangle_normal(Vec3 a, Vec3 b, Vec3 c) {
+    return vec3_cross(b - a, c - a);
+}
+
+vec<u32> simplify_mesh(const vec<f32>& vertices, u32 stride, u32 position_offset,
+                       const u32* indices, u32 index_count, u32 target_index_count,
+                       f32 max_error, f32* error) {
+    u32 vertex_count = u32(vertices.size() / stride);
+    u32 triangle_count = index_count / 3;
+    vec<u32> triangles(indices, indices + triangle_count * 3);
+    vec<bool> triangle_alive(triangle_count, true);
+    *error = 0;
+
+    vec<Vec3> positions(vertex_count);
+    for (u32 i = 0; i < vertex_count; i++) {
+        const f32* position = &vertices[i * stride + position_offset];
+        positions[i] = Vec3(position[0], position[1], position[2]);
+    }
+
+    vec<Quadric> quadrics(vertex_count);
+    vec<vec<u32>> vertex_triangles(vertex_count);
+    std::unordered_map<u64, u32> edge_counts;
+    for (u32 t = 0; t < triangle_count; t++) {
+        u32* triangle = &triangles[t * 3];
+        Vec3 normal =
+            triangle_normal(positions[triangle[0]], positions[triangle[1]], positions[triangle[2]]);
+        f32 length = normal.length();
+        if (length > 0) {
+            normal = normal / length;
+            f64 d = -vec3_dot(normal, positions[triangle[0]]);
+            for (u32 i = 0; i < 3; i++) {
+                quadrics[triangle[i]].add_plane(normal.v[0], normal.v[1], normal.v[2], d);
+            }
+        }
+        for (u32 i = 0; i < 3; i++) {
+            vertex_triangles[triangle[i]].push_back(t);
+            u32 a = std::min(triangle[i], triangle[(i + 1) % 3]);
+            u32 b = std::max(triangle[i], triangle[(i + 1) % 3]);
+            edge_counts[u64(a) << 32 | b]++;
+        }
+    }
+
+    vec<bool> locked(vertex_count, false);
+    for (const auto& edge : edge_counts) {
+        if (edge.second != 2) {
+            locked[edge.first >> 32] = true;
+            locked[edge.first & UINT32_MAX] = true;
+        }
+    }
+
+    vec<u32> versions(vertex_count, 0);
+    vec<bool> removed(vertex_count, false);
+    std::priority_queue<Collapse, vec<Collapse>, std::greater<Collapse>> collapses;
+    auto push_collapse = [&](u32 from, u32 to) {
+        if (locked[from] || from == to) {
+            return;
+        }
+        Quadric quadric = quadrics[from];
+        quadric.add(quadrics[to]);
+        collapses.push(Collapse{
+            .m_cost = std::max(quadric.evaluate(positions[to]), 0.0),
+            .m_from = from,
+            .m_to = to,
+            .m_from_version = versions[from],
+            .m_to_version = versions[to],
+        });
+    };
+    for (u32 t = 0; t < triangle_count; t++) {
+        for (u32 i = 0; i < 3; i++) {
+            push_collapse(triangles[t * 3 + i], triangles[t * 3 + (i + 1) % 3]);
+            push_collapse(triangles[t * 3 + (i + 1) % 3], triangles[t * 3 + i]);
+        }
+    }
+
+    u32 alive_count = triangle_count;
+    f64 max_cost = 0;
+    f64 cost_limit = f64(max_error) * f64(max_error);
+    while (alive_count * 3 > target_index_count && !collapses.empty() &&
+           collapses.top().m_cost <= cost_limit) {
+        Collapse collapse = collapses.top();
+        collapses.pop();
+        u32 from = collapse.m_from;
+        u32 to = collapse.m_to;
+        if (removed[from] || removed[to] || versions[from] != collapse.m_from_version ||
+            versions[to] != collapse.m_to_version) {
+            continue;
+        }
+
+        // The edge has to still exist, and no remaining triangle may flip or degenerate.
+        bool connected = false;
+        bool valid = true;
+        for (u32 t : vertex_triangles[from]) {
+            if (!triangle_alive[t]) {
+                continue;
+            }
+            u32* triangle = &triangles[t * 3];
+            if (triangle[0] == to || triangle[1] == to || triangle[2] == to) {
+                connected = true;
+                continue;
+            }
+            Vec3 corners[3];
+            for (u32 i = 0; i < 3; i++) {
+                corners[i] = positions[triangle[i]];
+            }
+            Vec3 before = triangle_normal(corners[0], corners[1], corners[2]);
+            for (u32 i = 0; i < 3; i++) {
+                if (triangle[i] == from) {
+                    corners[i] = positions[to];
+                }
+            }
+            Vec3 after = triangle_normal(corners[0], corners[1], corners[2]);
+            if (vec3_dot(before, after) <= 0) {
+                valid = false;
+                break;
+            }
+        }
+        if (!connected || !valid) {
+            continue;
+        }
+
+        for (u32 t : vertex_triangles[from]) {
+            if (!triangle_alive[t]) {
+                continue;
+            }
+            u32* triangle = &triangles[t * 3];
+            if (triangle[0] == to || triangle[1] == to || triangle[2] == to) {
+                triangle_alive[t] = false;
+                alive_count--;
+                continue;
+            }
+            for (u32 i = 0; i < 3; i++) {
+                if (triangle[i] == from) {
+                    triangle[i] = to;
+                }
+            }
+            vertex_triangles[to].push_back(t);
+        }
+        removed[from] = true;
+        quadrics[to].add(quadrics[from]);
+        versions[to]++;
+        max_cost = std::max(max_cost, collapse.m_cost);
+
+        for (u32 t : vertex_triangles[to]) {
+            if (!triangle_alive[t]) {
+                continue;
+            }
+            for (u32 i = 0; i < 3; i++) {
+                u32 neighbor = triangles[t * 3 + i];
+                if (neighbor != to) {
+                    push_collapse(neighbor, to);
+                    push_collapse(to, neighbor);
+                }
+            }
+        }
+    }
+
+    vec<u32> result;
+    result.reserve(alive_count * 3);
+    for (u32 t = 0; t < triangle_count; t++) {
+        if (triangle_alive[t]) {
+            result.insert(result.end(), &triangles[t * 3], &triangles[t * 3 + 3]);
+        }
+    }
+    *error = f32(std::sqrt(max_cost));
+    return result;
+}
+
+// Each level is simplified from the previous one, so level errors add up. Generation stops
+// early once a level cannot remove enough triangles.
+void generate_mesh_lods(Mesh* mesh, u32 lod_count) {
+    u32 stride;
+    u32 position_offset;
+    if (mesh->m_primitive != MeshPrimitive::TRIANGLES ||
+        !mesh_position_layout(mesh, &stride, &position_offset)) {
+        return;
+    }
+    // The levels are appended to m_indices, a mapped mesh is copied first.
+    copy_mesh_data(mesh);
+
+    u32 base_index_count =
+        mesh->m_lods.empty() ? u32(mesh->m_indices.size()) : mesh->m_lods[0].m_index_count;
+    mesh->m_indices.resize(base_index_count);
+    mesh->m_meshlets.clear();
+    mesh->m_lods = {MeshLod{.m_first_index = 0, .m_index_count = base_index_count}};
+
+    for (u32 level = 1; level < lod_count; level++) {
+        MeshLod previous = mesh->m_lods.back();
+        u32 target_index_count = previous.m_index_count / 6 * 3;
+        f32 level_error;
+        vec<u32> indices = simplify_mesh(
+            mesh->m_vertices, stride, position_offset, &mesh->m_indices[previous.m_first_index],
+            previous.m_index_count, target_index_count,
+            mesh->m_bounding_sphere_radius * LOD_MAX_RELATIVE_ERROR, &level_error);
+        if (indices.empty() ||
+            f32(indices.size()) > f32(previous.m_index_count) * LOD_MIN_REDUCTION) {
+            break;
+        }
+
+        mesh->m_lods.push_back(MeshLod{
+            .m_first_index = u32(mesh->m_indices.size()),
+            .m_index_count = u32(indices.size()),
+            .m_error = previous.m_error + level_error,
+        });
+        mesh->m_indices.insert(mesh->m_indices.end(), indices.begin(), indices.end());
+    }
+}
+
+}  // namespace blaz
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "types.h"
+
+namespace blaz {
+
+struct Mesh;
+
+const u32 MESH_DEFAULT_LOD_COUNT = 4;
+
+// Quadric error edge collapse. Vertices are only moved onto a neighbor, so the vertex buffer is
+// shared by every result and attributes are never interpolated. Vertices on an open edge,
+// which includes attribute seams since those split vertices, are locked. Returns the indices
+// of the remaining triangles and writes an estimate of the largest position error, which stops
+// the simplification before target_index_count is reached if it would exceed max_error.
+vec<u32> simplify_mesh(const vec<f32>& vertices, u32 stride, u32 position_offset,
+                       const u32* indices, u32 index_count, u32 target_index_count,
+                       f32 max_error, f32* error);
+
+// Appends up to lod_count - 1 levels, each with about half the triangles of the previous one,
+// to the mesh indices and describes all levels in m_lods. Meshlets built before are dropped.
+void generate_mesh_lods(Mesh* mesh, u32 lod_count);
+
+}  // namespace blaz
@@ -0,0 +1,288 @@
+#include "meshlet.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "mesh.h"
+#include "renderer.h"
+
+namespace blaz {
+
+// Below this, the normals spread too close to a hemisphere for the cone to cull anything.
+const f32 MESHLET_MIN_CONE_DOT = 0.1f;
+// Unused triangles, in index order, searched for the nearest one once a meshlet has no
+// neighbor left. Attribute seams split vertices, so this happens long before a meshlet is full.
+const u32 MESHLET_SEARCH_WINDOW = 128;
+
+static Vec3 vertex_position(const vec<f32>& vertices, u32 stride, u32 position_offset,
+                            u32 vertex) {
+    const f32* position = &vertices[vertex * stride + position_offset];
+    return Vec3(position[0], position[1], position[2]);
+}
+
+Meshlet compute_meshlet_bounds(const vec<f32>& vertices, u32 stride, u32 position_offset,
+                               const u32* indices, u32 index_count) {
+    Vec3 min = vertex_position(vertices, stride, position_offset, indices[0]);
+    Vec3 max = min;
+    for (u32 i = 1; i < index_count; i++) {
+        Vec3 position = vertex_position(vertices, stride, position_offset, indices[i]);
+        for (u32 axis = 0; axis < 3; axis++) {
+            min.v[axis] = std::min(min.v[axis], position.v[axis]);
+            max.v[axis] = std::max(max.v[axis], position.v[axis]);
+        }
+    }
+    Vec3 center = (min + max) * 0.5f;
+
+    Meshlet meshlet;
+    f32 radius = 0;
+    for (u32 i = 0; i < index_count; i++) {
+        Vec3 position = vertex_position(vertices, stride, position_offset, indices[i]);
+        radius = std::max(radius, (position - center).length());
+    }
+
+    vec<Vec3> normals;
+    Vec3 axis(0, 0, 0);
+    for (u32 i = 0; i + 2 < index_count; i += 3) {
+        Vec3 a = vertex_position(vertices, stride, position_offset, indices[i]);
+        Vec3 b = vertex_position(vertices, stride, position_offset, indices[i + 1]);
+        Vec3 c = vertex_position(vertices, stride, position_offset, indices[i + 2]);
+        Vec3 normal = vec3_cross(b - a, c - a);
+        f32 length = normal.length();
+        if (length > 0) {
+            normals.push_back(normal / length);
+            axis += normals.back();
+        }
+    }
+
+    f32 axis_length = axis.length();
+    if (axis_length > 0) {
+        axis = axis / axis_length;
+        f32 min_dot = 1;
+        for (Vec3 normal : normals) {
+            min_dot = std::min(min_dot, vec3_dot(axis, normal));
+        }
+        if (min_dot > MESHLET_MIN_CONE_DOT) {
+            meshlet.m_cone_cutoff = std::sqrt(1 - min_dot * min_dot);
+        }
+    }
+
+    for (u32 i = 0; i < 3; i++) {
+        meshlet.m_center[i] = center.v[i];
+        meshlet.m_cone_axis[i] = axis.v[i];
+    }
+    meshlet.m_radius = radius;
+    return meshlet;
+}
+
+// Grows each meshlet from the first unused triangle by adding, among the unused triangles
+// sharing one of its vertices, the one that brings the fewest new vertices, or else the nearest
+// unused triangle close in index order. The arrays indexed by vertex only span the vertices
+// used by the range, which may be a small part of a large mesh.
+static void build_level_meshlets(Mesh* mesh, u32 stride, u32 position_offset, u32 first_index,
+                                 u32 index_count) {
+    u32 triangle_count = index_count / 3;
+    if (triangle_count == 0) {
+        return;
+    }
+    const u32* indices = &mesh->m_indices[first_index];
+
+    u32 first_vertex = indices[0];
+    u32 last_vertex = indices[0];
+    for (u32 i = 1; i < triangle_count * 3; i++) {
+        first_vertex = std::min(first_vertex, indices[i]);
+        last_vertex = std::max(last_vertex, indices[i]);
+    }
+    u32 vertex_count = last_vertex - first_vertex + 1;
+
+    vec<u32> vertex_offsets(vertex_count + 1, 0);
+    for (u32 i = 0; i < triangle_count * 3; i++) {
+        vertex_offsets[indices[i] - first_vertex + 1]++;
+    }
+    for (u32 i = 0; i < vertex_count; i++) {
+        vertex_offsets[i + 1] += vertex_offsets[i];
+    }
+    vec<u32> vertex_triangles(triangle_count * 3);
+    vec<u32> cursors(vertex_offsets.begin(), vertex_offsets.end() - 1);
+    for (u32 t = 0; t < triangle_count; t++) {
+        for (u32 k = 0; k < 3; k++) {
+            vertex_triangles[cursors[indices[t * 3 + k] - first_vertex]++] = t;
+        }
+    }
+
+    vec<Vec3> centroids(triangle_count);
+    for (u32 t = 0; t < triangle_count; t++) {
+        for (u32 k = 0; k < 3; k++) {
+            centroids[t] += vertex_position(mesh->m_vertices, stride, position_offset,
+                                            indices[t * 3 + k]) /
+                            3.0f;
+        }
+    }
+
+    vec<bool> triangle_used(triangle_count, false);
+    vec<u32> vertex_meshlet(vertex_count, INVALID_INDEX);
+    vec<u32> reordered;
+    reordered.reserve(triangle_count * 3);
+    vec<u32> candidates;
+    u32 seed = 0;
+    for (u32 meshlet = 0;; meshlet++) {
+        while (seed < triangle_count && triangle_used[seed]) {
+            seed++;
+        }
+        if (seed == triangle_count) {
+            break;
+        }
+
+        u32 meshlet_first_index = u32(reordered.size());
+        u32 meshlet_vertex_count = 0;
+        u32 meshlet_triangle_count = 0;
+        Vec3 centroid_sum(0, 0, 0);
+        candidates.clear();
+        for (u32 triangle = seed; triangle != INVALID_INDEX;) {
+            triangle_used[triangle] = true;
+            centroid_sum += centroids[triangle];
+            for (u32 k = 0; k < 3; k++) {
+                reordered.push_back(indices[triangle * 3 + k]);
+                u32 vertex = indices[triangle * 3 + k] - first_vertex;
+                if (vertex_meshlet[vertex] == meshlet) {
+                    continue;
+                }
+
+                vertex_meshlet[vertex] = meshlet;
+                meshlet_vertex_count++;
+                for (u32 j = vertex_offsets[vertex]; j < vertex_offsets[vertex + 1]; j++) {
+                    if (!triangle_used[vertex_triangles[j]]) {
+                        candidates.push_back(vertex_triangles[j]);
+                    }
+                }
+            }
+            if (++meshlet_triangle_count == MESHLET_MAX_TRIANGLES) {
+                break;
+            }
+
+            triangle = INVALID_INDEX;
+            u32 best_new_vertices = 4;
+            u32 candidate_count = 0;
+            for (u32 candidate : candidates) {
+                if (triangle_used[candidate]) {
+                    continue;
+                }
+                candidates[candidate_count++] = candidate;
+
+                u32 new_vertices = 0;
+                for (u32 k = 0; k < 3; k++) {
+                    new_vertices +=
+                        vertex_meshlet[indices[candidate * 3 + k] - first_vertex] != meshlet;
+                }
+                if (new_vertices < best_new_vertices &&
+                    meshlet_vertex_count + new_vertices <= MESHLET_MAX_VERTICES) {
+                    best_new_vertices = new_vertices;
+                    triangle = candidate;
+                }
+            }
+            candidates.resize(candidate_count);
+            if (triangle != INVALID_INDEX || candidate_count > 0) {
+                continue;
+            }
+
+            Vec3 center = centroid_sum / f32(meshlet_triangle_count);
+            f32 best_distance = INFINITY;
+            u32 searched = 0;
+            for (u32 t = seed; t < triangle_count && searched < MESHLET_SEARCH_WINDOW; t++) {
+                if (triangle_used[t]) {
+                    continue;
+                }
+                searched++;
+
+                u32 new_vertices = 0;
+                for (u32 k = 0; k < 3; k++) {
+                    new_vertices += vertex_meshlet[indices[t * 3 + k] - first_vertex] != meshlet;
+                }
+                f32 distance = (centroids[t] - center).length();
+                if (distance < best_distance &&
+                    meshlet_vertex_count + new_vertices <= MESHLET_MAX_VERTICES) {
+                    best_distance = distance;
+                    triangle = t;
+                }
+            }
+        }
+
+        Meshlet bounds = compute_meshlet_bounds(mesh->m_vertices, stride, position_offset,
+                                                &reordered[meshlet_first_index],
+                                                u32(reordered.size()) - meshlet_first_index);
+        bounds.m_first_index = first_index + meshlet_first_index;
+        bounds.m_index_count = u32(reordered.size()) - meshlet_first_index;
+        mesh->m_meshlets.push_back(bounds);
+    }
+
+    std::copy(reordered.begin(), reordered.end(), mesh->m_indices.begin() + first_index);
+}
+
+void build_mesh_meshlets(Mesh* mesh) {
+    // The triangles are reordered in place, a mapped mesh is copied first.
+    copy_mesh_data(mesh);
+    mesh->m_meshlets.clear();
+    u32 stride;
+    u32 position_offset;
+    if (mesh->m_primitive != MeshPrimitive::TRIANGLES || mesh->m_indices.empty() ||
+        !mesh_position_layout(mesh, &stride, &position_offset)) {
+        return;
+    }
+
+    if (mesh->m_lods.empty()) {
+        build_level_meshlets(mesh, stride, position_offset, 0, u32(mesh->m_indices.size()));
+        return;
+    }
+    for (MeshLod& lod : mesh->m_lods) {
+        lod.m_first_meshlet = u32(mesh->m_meshlets.size());
+        build_level_meshlets(mesh, stride, position_offset, lod.m_first_index,
+                             lod.m_index_count);
+        lod.m_meshlet_count = u32(mesh->m_meshlets.size()) - lod.m_first_meshlet;
+    }
+}
+
+void build_range_meshlets(Mesh* mesh, u32 first_index, u32 index_count) {
+    copy_mesh_data(mesh);
+    u32 stride;
+    u32 position_offset;
+    if (mesh->m_primitive != MeshPrimitive::TRIANGLES ||
+        !mesh_position_layout(mesh, &stride, &position_offset)) {
+        return;
+    }
+    build_level_meshlets(mesh, stride, position_offset, first_index, index_count);
+}
+
+Frustum make_meshlet_frustum(const Mat4& model_view_projection) {
+    Frustum frustum = make_frustum(model_view_projection);
+    for (Vec4& plane : frustum.m_planes) {
+        f32 length = Vec3(plane.v[0], plane.v[1], plane.v[2]).length();
+        if (length > 0) {
+            plane = Vec4(plane.v[0] / length, plane.v[1] / length, plane.v[2] / length,
+                         plane.v[3] / length);
+        }
+    }
+    return frustum;
+}
+
+bool meshlet_visible(const Meshlet& meshlet, const Frustum& frustum, Vec3 camera_position,
+                     bool cone_culling) {
+    const f32* center = meshlet.m_center;
+    for (const Vec4& plane : frustum.m_planes) {
+        if (plane.v[0] * center[0] + plane.v[1] * center[1] + plane.v[2] * center[2] +
+                plane.v[3] <
+            -meshlet.m_radius) {
+            return false;
+        }
+    }
+
+    if (cone_culling && meshlet.m_cone_cutoff < 1) {
+        Vec3 direction = Vec3(center[0], center[1], center[2]) - camera_position;
+        Vec3 axis(meshlet.m_cone_axis[0], meshlet.m_cone_axis[1], meshlet.m_cone_axis[2]);
+        if (vec3_dot(direction, axis) >=
+            meshlet.m_cone_cutoff * direction.length() + meshlet.m_radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace blaz
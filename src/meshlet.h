@@ -0,0 +1,50 @@
+#pragma once
+
+#include "culling.h"
+#include "my_math.h"
+#include "types.h"
+
+namespace blaz {
+
+struct Mesh;
+
+const u32 MESHLET_MAX_VERTICES = 64;
+const u32 MESHLET_MAX_TRIANGLES = 124;
+
+// A cluster of triangles stored as a contiguous range of Mesh::m_indices, bounded by a sphere
+// and by a cone around the triangle normals. No triangle of the cluster faces a viewer at p
+// when dot(center - p, cone_axis) >= cone_cutoff * length(center - p) + radius.
+struct Meshlet {
+    u32 m_first_index = 0;
+    u32 m_index_count = 0;
+    f32 m_center[3] = {};
+    f32 m_radius = 0;
+    f32 m_cone_axis[3] = {};
+    // 1 when the normals are too spread out for the cone to ever cull the cluster.
+    f32 m_cone_cutoff = 1;
+};
+
+// Reorders the triangles of every level of the mesh into meshlets of at most
+// MESHLET_MAX_VERTICES vertices and MESHLET_MAX_TRIANGLES triangles, grown across shared
+// vertices, and records them in m_meshlets and the meshlet range of each level.
+void build_mesh_meshlets(Mesh* mesh);
+
+// Same for the triangles of indices [first_index, first_index + index_count) only, whose
+// meshlets are appended to m_meshlets.
+void build_range_meshlets(Mesh* mesh, u32 first_index, u32 index_count);
+
+// Bounding sphere and normal cone of the triangles in indices. m_first_index and m_index_count
+// are left for the caller to set.
+Meshlet compute_meshlet_bounds(const vec<f32>& vertices, u32 stride, u32 position_offset,
+                               const u32* indices, u32 index_count);
+
+// Frustum with unit plane normals, so spheres can be tested against it. model_view_projection
+// maps mesh space to clip space.
+Frustum make_meshlet_frustum(const Mat4& model_view_projection);
+
+// frustum and camera_position are in mesh space. The cone test holds for rotations,
+// translations and uniform scales of the mesh.
+bool meshlet_visible(const Meshlet& meshlet, const Frustum& frustum, Vec3 camera_position,
+                     bool cone_culling);
+
+}  // namespace blaz
@@ -8,6 +8,7 @@ void init_scene(Scene* scene) {
     Node root_node = Node{.m_name = "root_node"};
     root_node.m_scene = scene;
     root_node.is_root_node = true;
+    root_node.m_index = u32(scene->m_nodes.size());
     scene->m_nodes.add(root_node);
 }
 
@@ -15,6 +16,7 @@ void add_node(Scene* scene, Node node, str parent) {
     node.m_scene = scene;
     if (scene->m_nodes.contains(parent)) {
         node.m_parent = parent;
+        node.m_index = u32(scene->m_nodes.size());
         scene->m_nodes.add(node);
         scene->m_nodes[parent].m_children.push_back(node.m_name);
         node.update_matrix();
@@ -25,6 +27,12 @@ void add_node(Scene* scene, Node node, str parent) {
 
 void Node::update_matrix() {
     m_was_dirty = true;
+    m_scene->m_version++;
+    m_version = m_scene->m_version;
+    if (!m_in_dirty_list) {
+        m_in_dirty_list = true;
+        m_scene->m_dirty_nodes.push_back(m_index);
+    }
     m_local_matrix = translate_3d(m_position) * rotate_3d(m_rotation) * scale_3d(m_scale);
     if (!is_root_node) {
         m_global_matrix = m_local_matrix * m_scene->m_nodes[m_parent].m_global_matrix;
@@ -10,6 +10,7 @@ struct Scene;
 struct Node {
     str m_name;
     Scene* m_scene = NULL;
+    u32 m_index = 0;
     bool is_root_node = false;
     str m_parent;
     vec<str> m_children;
@@ -22,6 +23,8 @@ struct Node {
     Mat4 m_local_matrix = Mat4();
 
     bool m_was_dirty = true;
+    u64 m_version = 0;
+    bool m_in_dirty_list = false;
 
     void update_matrix();
     void set_position(Vec3 position);
@@ -38,6 +41,9 @@ struct Node {
 
 struct Scene {
     ArrayMap<Node> m_nodes;
+    u64 m_version = 0;
+    // Indices of the nodes whose matrix changed since the list was last drained.
+    vec<u32> m_dirty_nodes;
 };
 
 void init_scene(Scene* scene);
@@ -0,0 +1,300 @@
+#include "occlusion.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define OCCLUSION_SSE
+#endif
+
+namespace blaz {
+
+const f32 OCCLUSION_NEAR_W = 1e-4f;
+const u32 OCCLUSION_MAX_TEST_TEXELS = 4;
+
+void OcclusionBuffer::resize(u32 width, u32 height) {
+    m_width = std::max(width / OCCLUSION_TILE_SIZE, 1u) * OCCLUSION_TILE_SIZE;
+    m_height = std::max(height / OCCLUSION_TILE_SIZE, 1u) * OCCLUSION_TILE_SIZE;
+    m_tile_columns = m_width / OCCLUSION_TILE_SIZE;
+    m_tile_rows = m_height / OCCLUSION_TILE_SIZE;
+    m_tile_triangles.resize(m_tile_columns * m_tile_rows);
+
+    m_levels.clear();
+    m_level_sizes.clear();
+    i32 level_width = i32(m_width);
+    i32 level_height = i32(m_height);
+    while (true) {
+        m_levels.push_back(vec<f32>(level_width * level_height, 1.0f));
+        m_level_sizes.push_back(Vec2I(level_width, level_height));
+        if (level_width == 1 && level_height == 1) {
+            break;
+        }
+        level_width = (level_width + 1) / 2;
+        level_height = (level_height + 1) / 2;
+    }
+}
+
+void OcclusionBuffer::begin(const Mat4& view_projection) {
+    m_view_projection = view_projection;
+    m_triangles.clear();
+    for (vec<u32>& triangles : m_tile_triangles) {
+        triangles.clear();
+    }
+}
+
+// Vertices are transformed once, then each triangle is projected to pixels and binned into
+// the tiles its screen rectangle overlaps. Both windings are kept.
+void OcclusionBuffer::add_occluder(const Mat4& matrix, span<const f32> vertices, u32 stride,
+                                   u32 position_offset, const u32* indices, u32 index_count) {
+    // Mat4 products read right to left, so this is view_projection * matrix.
+    Mat4 model_view_projection = matrix * m_view_projection;
+    const f32* m = model_view_projection.m;
+    u32 vertex_count = u32(vertices.size() / stride);
+    m_clip_positions.resize(vertex_count);
+    for (u32 i = 0; i < vertex_count; i++) {
+        const f32* position = &vertices[i * stride + position_offset];
+        for (u32 r = 0; r < 4; r++) {
+            m_clip_positions[i].v[r] = m[r] * position[0] + m[4 + r] * position[1] +
+                                       m[8 + r] * position[2] + m[12 + r];
+        }
+    }
+
+    u32 triangle_count = index_count == 0 ? vertex_count / 3 : index_count / 3;
+    for (u32 t = 0; t < triangle_count; t++) {
+        OcclusionTriangle triangle;
+        bool clipped = false;
+        for (u32 i = 0; i < 3; i++) {
+            u32 index = index_count == 0 ? t * 3 + i : indices[t * 3 + i];
+            const Vec4& clip = m_clip_positions[index];
+            if (clip.v[3] < OCCLUSION_NEAR_W) {
+                clipped = true;
+                break;
+            }
+            triangle.m_x[i] = (clip.v[0] / clip.v[3] * 0.5f + 0.5f) * f32(m_width);
+            triangle.m_y[i] = (clip.v[1] / clip.v[3] * 0.5f + 0.5f) * f32(m_height);
+            triangle.m_z[i] = clip.v[2] / clip.v[3];
+        }
+        if (clipped) {
+            continue;
+        }
+
+        f32 area = (triangle.m_x[1] - triangle.m_x[0]) * (triangle.m_y[2] - triangle.m_y[0]) -
+                   (triangle.m_y[1] - triangle.m_y[0]) * (triangle.m_x[2] - triangle.m_x[0]);
+        if (area == 0 || std::isnan(area)) {
+            continue;
+        }
+        if (area < 0) {
+            std::swap(triangle.m_x[1], triangle.m_x[2]);
+            std::swap(triangle.m_y[1], triangle.m_y[2]);
+            std::swap(triangle.m_z[1], triangle.m_z[2]);
+        }
+
+        f32 min_x = std::min({triangle.m_x[0], triangle.m_x[1], triangle.m_x[2]});
+        f32 max_x = std::max({triangle.m_x[0], triangle.m_x[1], triangle.m_x[2]});
+        f32 min_y = std::min({triangle.m_y[0], triangle.m_y[1], triangle.m_y[2]});
+        f32 max_y = std::max({triangle.m_y[0], triangle.m_y[1], triangle.m_y[2]});
+        if (max_x < 0 || max_y < 0 || min_x >= f32(m_width) || min_y >= f32(m_height)) {
+            continue;
+        }
+
+        u32 index = u32(m_triangles.size());
+        m_triangles.push_back(triangle);
+        u32 first_column = u32(std::max(min_x, 0.0f)) / OCCLUSION_TILE_SIZE;
+        u32 last_column = u32(std::min(max_x, f32(m_width - 1))) / OCCLUSION_TILE_SIZE;
+        u32 first_row = u32(std::max(min_y, 0.0f)) / OCCLUSION_TILE_SIZE;
+        u32 last_row = u32(std::min(max_y, f32(m_height - 1))) / OCCLUSION_TILE_SIZE;
+        for (u32 row = first_row; row <= last_row; row++) {
+            for (u32 column = first_column; column <= last_column; column++) {
+                m_tile_triangles[row * m_tile_columns + column].push_back(index);
+            }
+        }
+    }
+}
+
+void OcclusionBuffer::rasterize(ThreadPool* thread_pool) {
+    u32 tile_count = m_tile_columns * m_tile_rows;
+    if (thread_pool != NULL) {
+        thread_pool->parallel_for(tile_count, [&](u32 tile) { rasterize_tile(tile); });
+    } else {
+        for (u32 tile = 0; tile < tile_count; tile++) {
+            rasterize_tile(tile);
+        }
+    }
+    build_hierarchy();
+}
+
+// Pixels are covered when their center is inside the three edges, so occluders never grow.
+// Edge functions and depth are planes in screen space and are evaluated four pixels at a time.
+void OcclusionBuffer::rasterize_tile(u32 tile) {
+    u32 tile_x = tile % m_tile_columns * OCCLUSION_TILE_SIZE;
+    u32 tile_y = tile / m_tile_columns * OCCLUSION_TILE_SIZE;
+    f32* depth = m_levels[0].data();
+    for (u32 y = tile_y; y < tile_y + OCCLUSION_TILE_SIZE; y++) {
+        std::fill_n(depth + y * m_width + tile_x, OCCLUSION_TILE_SIZE, 1.0f);
+    }
+
+    for (u32 index : m_tile_triangles[tile]) {
+        const OcclusionTriangle& triangle = m_triangles[index];
+        const f32* x = triangle.m_x;
+        const f32* y = triangle.m_y;
+        const f32* z = triangle.m_z;
+
+        // Edge i goes from vertex i to vertex i + 1: e(px, py) = a * px + b * py + c.
+        f32 edge_a[3];
+        f32 edge_b[3];
+        f32 edge_c[3];
+        for (u32 i = 0; i < 3; i++) {
+            u32 j = (i + 1) % 3;
+            edge_a[i] = y[i] - y[j];
+            edge_b[i] = x[j] - x[i];
+            edge_c[i] = x[i] * y[j] - y[i] * x[j];
+        }
+        // The barycentric weight of vertex i is the edge opposite to it over the area.
+        f32 area = edge_c[0] + edge_c[1] + edge_c[2];
+        f32 depth_a = (edge_a[1] * z[0] + edge_a[2] * z[1] + edge_a[0] * z[2]) / area;
+        f32 depth_b = (edge_b[1] * z[0] + edge_b[2] * z[1] + edge_b[0] * z[2]) / area;
+        f32 depth_c = (edge_c[1] * z[0] + edge_c[2] * z[1] + edge_c[0] * z[2]) / area;
+
+        f32 tile_min_x = f32(tile_x);
+        f32 tile_max_x = f32(tile_x + OCCLUSION_TILE_SIZE - 1);
+        f32 tile_min_y = f32(tile_y);
+        f32 tile_max_y = f32(tile_y + OCCLUSION_TILE_SIZE - 1);
+        i32 min_x = i32(std::clamp(std::floor(std::min({x[0], x[1], x[2]})), tile_min_x,
+                                   tile_max_x)) & ~3;
+        i32 max_x = i32(std::clamp(std::ceil(std::max({x[0], x[1], x[2]})), tile_min_x,
+                                   tile_max_x));
+        i32 min_y = i32(std::clamp(std::floor(std::min({y[0], y[1], y[2]})), tile_min_y,
+                                   tile_max_y));
+        i32 max_y = i32(std::clamp(std::ceil(std::max({y[0], y[1], y[2]})), tile_min_y,
+                                   tile_max_y));
+
+        for (i32 py = min_y; py <= max_y; py++) {
+            f32 center_y = f32(py) + 0.5f;
+            f32* row = depth + py * m_width;
+            i32 px = min_x;
+#ifdef OCCLUSION_SSE
+            __m128 lane_offsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+            __m128 zero = _mm_setzero_ps();
+            __m128 row_edges[3];
+            for (u32 i = 0; i < 3; i++) {
+                row_edges[i] = _mm_set1_ps(edge_b[i] * center_y + edge_c[i]);
+            }
+            __m128 row_depth = _mm_set1_ps(depth_b * center_y + depth_c);
+            for (; px <= max_x; px += 4) {
+                __m128 center_x = _mm_add_ps(_mm_set1_ps(f32(px)), lane_offsets);
+                __m128 inside = _mm_cmpge_ps(
+                    _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edge_a[0]), center_x), row_edges[0]),
+                    zero);
+                for (u32 i = 1; i < 3; i++) {
+                    __m128 edge =
+                        _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edge_a[i]), center_x), row_edges[i]);
+                    inside = _mm_and_ps(inside, _mm_cmpge_ps(edge, zero));
+                }
+                __m128 pixel_depth =
+                    _mm_add_ps(_mm_mul_ps(_mm_set1_ps(depth_a), center_x), row_depth);
+                __m128 old_depth = _mm_loadu_ps(row + px);
+                __m128 new_depth = _mm_min_ps(old_depth, pixel_depth);
+                _mm_storeu_ps(row + px, _mm_or_ps(_mm_and_ps(inside, new_depth),
+                                                  _mm_andnot_ps(inside, old_depth)));
+            }
+#endif
+            for (; px <= max_x; px++) {
+                f32 center_x = f32(px) + 0.5f;
+                bool inside = true;
+                for (u32 i = 0; i < 3; i++) {
+                    inside &= edge_a[i] * center_x + edge_b[i] * center_y + edge_c[i] >= 0;
+                }
+                if (inside) {
+                    f32 pixel_depth = depth_a * center_x + depth_b * center_y + depth_c;
+                    row[px] = std::min(row[px], pixel_depth);
+                }
+            }
+        }
+    }
+}
+
+void OcclusionBuffer::build_hierarchy() {
+    for (u32 level = 1; level < m_levels.size(); level++) {
+        const vec<f32>& source = m_levels[level - 1];
+        Vec2I source_size = m_level_sizes[level - 1];
+        vec<f32>& destination = m_levels[level];
+        Vec2I size = m_level_sizes[level];
+        auto source_at = [&](i32 x, i32 y) { return source[y * source_size.v[0] + x]; };
+        for (i32 y = 0; y < size.v[1]; y++) {
+            i32 y0 = std::min(y * 2, source_size.v[1] - 1);
+            i32 y1 = std::min(y * 2 + 1, source_size.v[1] - 1);
+            for (i32 x = 0; x < size.v[0]; x++) {
+                i32 x0 = std::min(x * 2, source_size.v[0] - 1);
+                i32 x1 = std::min(x * 2 + 1, source_size.v[0] - 1);
+                destination[y * size.v[0] + x] =
+                    std::max({source_at(x0, y0), source_at(x1, y0), source_at(x0, y1),
+                              source_at(x1, y1)});
+            }
+        }
+    }
+}
+
+// The box is tested at the first level where its rectangle spans at most
+// OCCLUSION_MAX_TEST_TEXELS texels in each direction.
+bool OcclusionBuffer::is_visible(const Aabb& bounds) const {
+    if (m_levels.empty()) {
+        return true;
+    }
+    const f32* m = m_view_projection.m;
+    f32 min_x = INFINITY;
+    f32 max_x = -INFINITY;
+    f32 min_y = INFINITY;
+    f32 max_y = -INFINITY;
+    f32 min_z = INFINITY;
+    for (u32 corner = 0; corner < 8; corner++) {
+        f32 position[3] = {
+            corner & 1 ? bounds.m_max.v[0] : bounds.m_min.v[0],
+            corner & 2 ? bounds.m_max.v[1] : bounds.m_min.v[1],
+            corner & 4 ? bounds.m_max.v[2] : bounds.m_min.v[2],
+        };
+        f32 clip[4];
+        for (u32 r = 0; r < 4; r++) {
+            clip[r] = m[r] * position[0] + m[4 + r] * position[1] + m[8 + r] * position[2] +
+                      m[12 + r];
+        }
+        if (clip[3] < OCCLUSION_NEAR_W) {
+            return true;
+        }
+        f32 x = (clip[0] / clip[3] * 0.5f + 0.5f) * f32(m_width);
+        f32 y = (clip[1] / clip[3] * 0.5f + 0.5f) * f32(m_height);
+        min_x = std::min(min_x, x);
+        max_x = std::max(max_x, x);
+        min_y = std::min(min_y, y);
+        max_y = std::max(max_y, y);
+        min_z = std::min(min_z, clip[2] / clip[3]);
+    }
+
+    if (max_x < 0 || max_y < 0 || min_x >= f32(m_width) || min_y >= f32(m_height)) {
+        return true;
+    }
+    i32 x0 = std::max(i32(std::floor(min_x)), 0);
+    i32 x1 = std::min(i32(std::floor(max_x)), i32(m_width) - 1);
+    i32 y0 = std::max(i32(std::floor(min_y)), 0);
+    i32 y1 = std::min(i32(std::floor(max_y)), i32(m_height) - 1);
+
+    u32 level = 0;
+    while (level + 1 < m_levels.size() &&
+           (u32((x1 >> level) - (x0 >> level)) >= OCCLUSION_MAX_TEST_TEXELS ||
+            u32((y1 >> level) - (y0 >> level)) >= OCCLUSION_MAX_TEST_TEXELS)) {
+        level++;
+    }
+
+    const vec<f32>& depth = m_levels[level];
+    i32 level_width = m_level_sizes[level].v[0];
+    for (i32 y = y0 >> level; y <= y1 >> level; y++) {
+        for (i32 x = x0 >> level; x <= x1 >> level; x++) {
+            if (depth[y * level_width + x] >= min_z) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+}  // namespace blaz
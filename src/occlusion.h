@@ -0,0 +1,53 @@
+#pragma once
+
+#include "culling.h"
+#include "my_math.h"
+#include "thread_pool.h"
+#include "types.h"
+
+namespace blaz {
+
+const u32 OCCLUSION_TILE_SIZE = 32;
+const u32 OCCLUSION_BUFFER_WIDTH = 256;
+const u32 OCCLUSION_BUFFER_HEIGHT = 128;
+const char* const OCCLUDER_TAG = "occluder";
+
+struct OcclusionTriangle {
+    f32 m_x[3];
+    f32 m_y[3];
+    f32 m_z[3];
+};
+
+// Low resolution depth buffer of the occluders seen from one camera, with a max depth
+// hierarchy to test boxes against. Depth is clip z / w, growing with the distance. The size
+// has to be a multiple of OCCLUSION_TILE_SIZE.
+struct OcclusionBuffer {
+    u32 m_width = 0;
+    u32 m_height = 0;
+    u32 m_tile_columns = 0;
+    u32 m_tile_rows = 0;
+    Mat4 m_view_projection;
+
+    // m_levels[0] is the depth buffer, each following level holds the max of 2x2 texels.
+    vec<vec<f32>> m_levels;
+    vec<Vec2I> m_level_sizes;
+
+    vec<OcclusionTriangle> m_triangles;
+    vec<vec<u32>> m_tile_triangles;
+    vec<Vec4> m_clip_positions;
+
+    void resize(u32 width, u32 height);
+    void begin(const Mat4& view_projection);
+    // Triangles crossing the near plane are dropped, which only makes the occluder smaller.
+    void add_occluder(const Mat4& matrix, span<const f32> vertices, u32 stride,
+                      u32 position_offset, const u32* indices, u32 index_count);
+    void rasterize(ThreadPool* thread_pool);
+    void rasterize_tile(u32 tile);
+    void build_hierarchy();
+
+    // Conservative: returns true unless every texel under the screen rectangle of the box is
+    // nearer than the nearest point of the box.
+    bool is_visible(const Aabb& bounds) const;
+};
+
+}  // namespace blaz
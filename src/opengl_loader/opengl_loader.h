@@ -42,6 +42,8 @@ typedef float GLfloat;
 typedef float GLclampf;
 typedef double GLdouble;
 typedef double GLclampd;
+typedef uint64_t GLuint64;
+typedef struct __GLsync* GLsync;
 
 #define GL_2D 0x0600
 #define GL_2_BYTES 0x1407
@@ -1523,6 +1525,9 @@ typedef double GLclampd;
 #define GL_MAX_VERTEX_ATTRIB_RELATIVE_OFFSET 0x82D9
 #define GL_MAX_VERTEX_ATTRIB_BINDINGS 0x82DA
 #define GL_MAX_VERTEX_ATTRIB_STRIDE 0x82E5
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT 0x0080
+#define GL_DYNAMIC_STORAGE_BIT 0x0100
 
 #define GL_OLD_FUNCTIONS_LIST                                                               \
     GL_FUNCTION(void, glGetIntegerv, GLenum, GLint*)                                        \
@@ -1538,6 +1543,7 @@ typedef double GLclampd;
                 const GLvoid* data)                                                         \
     GL_FUNCTION(void, glBindTexture, GLenum target, GLuint texture)                         \
     GL_FUNCTION(void, glGenTextures, GLsizei n, GLuint* textures)                           \
+    GL_FUNCTION(void, glDeleteTextures, GLsizei n, const GLuint* textures)                  \
     GL_FUNCTION(void, glEnable, GLenum cap)                                                 \
     GL_FUNCTION(void, glDisable, GLenum cap)                                                \
     GL_FUNCTION(void, glDrawElements, GLenum mode, GLsizei count, GLenum type,              \
@@ -1630,7 +1636,39 @@ typedef void (*GLDEBUGPROC)(GLenum source, GLenum type, GLuint id, GLenum severi
     GL_FUNCTION(void, glDispatchCompute, GLuint num_groups_x, GLuint num_groups_y,                \
                 GLuint num_groups_z)                                                              \
     GL_FUNCTION(void, glGetTexParameterIiv, GLenum target, GLenum pname, GLint* params)           \
-    GL_FUNCTION(void, glBindBufferRange, GLenum, GLuint, GLuint, GLintptr, GLsizeiptr)
+    GL_FUNCTION(void, glBindBufferRange, GLenum, GLuint, GLuint, GLintptr, GLsizeiptr)            \
+    GL_FUNCTION(GLint, glGetAttribLocation, GLuint program, const GLchar* name)                   \
+    GL_FUNCTION(void, glVertexAttribDivisor, GLuint index, GLuint divisor)                        \
+    GL_FUNCTION(void, glDrawElementsInstancedBaseInstance, GLenum mode, GLsizei count,            \
+                GLenum type, const void* indices, GLsizei instancecount, GLuint baseinstance)     \
+    GL_FUNCTION(void, glMultiDrawElements, GLenum mode, const GLsizei* count, GLenum type,        \
+                const void* const* indices, GLsizei drawcount)                                    \
+    GL_FUNCTION(void, glMultiDrawElementsBaseVertex, GLenum mode, const GLsizei* count,           \
+                GLenum type, const void* const* indices, GLsizei drawcount,                       \
+                const GLint* basevertex)                                                          \
+    GL_FUNCTION(void, glDrawElementsBaseVertex, GLenum mode, GLsizei count, GLenum type,          \
+                const void* indices, GLint basevertex)                                            \
+    GL_FUNCTION(void, glDrawElementsInstancedBaseVertexBaseInstance, GLenum mode, GLsizei count,  \
+                GLenum type, const void* indices, GLsizei instancecount, GLint basevertex,        \
+                GLuint baseinstance)                                                              \
+    GL_FUNCTION(void, glMultiDrawElementsIndirect, GLenum mode, GLenum type,                      \
+                const void* indirect, GLsizei drawcount, GLsizei stride)                          \
+    GL_FUNCTION(void, glCopyBufferSubData, GLenum readTarget, GLenum writeTarget,                 \
+                GLintptr readOffset, GLintptr writeOffset, GLsizeiptr size)                       \
+    GL_FUNCTION(void, glDeleteBuffers, GLsizei n, const GLuint* buffers)                          \
+    GL_FUNCTION(void, glBufferStorage, GLenum target, GLsizeiptr size, const void* data,          \
+                GLbitfield flags)                                                                 \
+    GL_FUNCTION(void*, glMapBufferRange, GLenum target, GLintptr offset, GLsizeiptr length,       \
+                GLbitfield access)                                                                \
+    GL_FUNCTION(GLsync, glFenceSync, GLenum condition, GLbitfield flags)                          \
+    GL_FUNCTION(GLenum, glClientWaitSync, GLsync sync, GLbitfield flags, GLuint64 timeout)        \
+    GL_FUNCTION(void, glDeleteSync, GLsync sync)                                                  \
+    GL_FUNCTION(void, glDeleteFramebuffers, GLsizei n, const GLuint* framebuffers)                \
+    GL_FUNCTION(void, glGenQueries, GLsizei n, GLuint* ids)                                       \
+    GL_FUNCTION(void, glBeginQuery, GLenum target, GLuint id)                                     \
+    GL_FUNCTION(void, glEndQuery, GLenum target)                                                  \
+    GL_FUNCTION(void, glGetQueryObjectiv, GLuint id, GLenum pname, GLint* params)                 \
+    GL_FUNCTION(void, glGetQueryObjectui64v, GLuint id, GLenum pname, GLuint64* params)
 
 #define GL_FUNCTION(return_type, name, ...) typedef return_type name##Type(__VA_ARGS__);
 
@@ -1642,6 +1680,8 @@ namespace blaz {
 struct OpenglLoader {
     Error init(Window* window, bool debug_context);
     void swap_buffers(Window* window);
+    void make_current(Window* window);
+    void release_current(Window* window);
     void set_swap_interval(u32 interval);
 
     void* m_context;
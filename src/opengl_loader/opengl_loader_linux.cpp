@@ -57,11 +57,20 @@ typedef GLXFBConfig* (*glXChooseFBConfigType)(::Display*, int, const int*, int*)
 typedef void (*glXSwapBuffersType)(::Display*, GLXDrawable);
 
 glXSwapBuffersType glXSwapBuffers;
+glXMakeCurrentType glXMakeCurrent;
 
 void OpenglLoader::swap_buffers(blaz::Window* window) {
     glXSwapBuffers(m_x11->display, m_x11->window);
 }
 
+void OpenglLoader::make_current(blaz::Window* window) {
+    glXMakeCurrent(m_x11->display, m_x11->window, (GLXContext)m_context);
+}
+
+void OpenglLoader::release_current(blaz::Window* window) {
+    glXMakeCurrent(m_x11->display, None, NULL);
+}
+
 Error OpenglLoader::init(blaz::Window* window, bool debug_context) {
     GLXContext m_context_linux;
     m_x11 = (Window_X11*)window->m_os_data;
@@ -78,7 +87,7 @@ Error OpenglLoader::init(blaz::Window* window, bool debug_context) {
         (glXChooseFBConfigType)dlsym(libgl_handle, "glXChooseFBConfig");
     glXCreateContextAttribsARBType glXCreateContextAttribsARB =
         (glXCreateContextAttribsARBType)dlsym(libgl_handle, "glXCreateContextAttribsARB");
-    glXMakeCurrentType glXMakeCurrent = (glXMakeCurrentType)dlsym(libgl_handle, "glXMakeCurrent");
+    glXMakeCurrent = (glXMakeCurrentType)dlsym(libgl_handle, "glXMakeCurrent");
     glXSwapBuffers = (glXSwapBuffersType)dlsym(libgl_handle, "glXSwapBuffers");
 
     i32 visual_attributes[] = {GLX_X_RENDERABLE,
@@ -54,6 +54,14 @@ void OpenglLoader::swap_buffers(blaz::Window* window) {
     SwapBuffers(m_win32_opengl->device_context);
 }
 
+void OpenglLoader::make_current(blaz::Window* window) {
+    wglMakeCurrent(m_win32_opengl->device_context, (HGLRC)m_context);
+}
+
+void OpenglLoader::release_current(blaz::Window* window) {
+    wglMakeCurrent(NULL, NULL);
+}
+
 Error OpenglLoader::init(blaz::Window* window, bool debug_context) {
     m_win32_opengl = (Window_WIN32_Opengl*)window->m_os_data;
 
@@ -41,6 +41,7 @@ std::map<int, str> x11_keycodes = {
 Error Window::init() {
     m_x11 = new Window_X11();
     m_os_data = m_x11;
+    XInitThreads();
     m_x11->display = XOpenDisplay(0);
     if (m_x11->display == NULL) {
         return Error("XOpenDisplay: Failed to open display");
@@ -0,0 +1,19 @@
+#include "platform.h"
+
+namespace blaz {
+
+Error Window::init(const str& title) {
+    return Error();
+}
+
+bool Window::event_loop() {
+    return true;
+}
+
+void Window::close() {
+}
+
+void Window::screenshot(str filename) {
+}
+
+}  // namespace blaz
\ No newline at end of file
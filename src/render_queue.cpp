@@ -0,0 +1,86 @@
+#include "render_queue.h"
+
+namespace blaz {
+
+u64 make_sort_key(u32 shader, u32 material, u32 mesh, u32 depth_bucket) {
+    u64 key = u64(shader) & ((1ull << SORT_KEY_SHADER_BITS) - 1);
+    key <<= SORT_KEY_MATERIAL_BITS;
+    key |= u64(material) & ((1ull << SORT_KEY_MATERIAL_BITS) - 1);
+    key <<= SORT_KEY_MESH_BITS;
+    key |= u64(mesh) & ((1ull << SORT_KEY_MESH_BITS) - 1);
+    key <<= SORT_KEY_DEPTH_BITS;
+    key |= u64(depth_bucket) & ((1ull << SORT_KEY_DEPTH_BITS) - 1);
+    return key;
+}
+
+u32 make_depth_bucket(f32 depth, f32 max_depth) {
+    const u32 max_bucket = (1u << SORT_KEY_DEPTH_BITS) - 1;
+    if (max_depth <= 0 || depth <= 0) {
+        return 0;
+    }
+    if (depth >= max_depth) {
+        return max_bucket;
+    }
+    return u32(depth / max_depth * f32(max_bucket));
+}
+
+void RenderQueue::clear() {
+    m_keys.clear();
+    m_items.clear();
+}
+
+void RenderQueue::resize(size_t count) {
+    m_keys.resize(count);
+    m_items.resize(count);
+}
+
+void RenderQueue::push(u64 key, u32 item) {
+    m_keys.push_back(key);
+    m_items.push_back(item);
+}
+
+void RenderQueue::sort() {
+    size_t count = m_keys.size();
+    if (count < 2) {
+        return;
+    }
+
+    m_keys_tmp.resize(count);
+    m_items_tmp.resize(count);
+
+    u64 keys_or = 0;
+    u64 keys_and = ~0ull;
+    for (u64 key : m_keys) {
+        keys_or |= key;
+        keys_and &= key;
+    }
+
+    for (u32 shift = 0; shift < 64; shift += 8) {
+        if ((((keys_or ^ keys_and) >> shift) & 0xff) == 0) {
+            continue;
+        }
+
+        u32 histogram[256] = {};
+        for (u64 key : m_keys) {
+            histogram[(key >> shift) & 0xff]++;
+        }
+
+        u32 offset = 0;
+        for (u32 i = 0; i < 256; i++) {
+            u32 bucket_count = histogram[i];
+            histogram[i] = offset;
+            offset += bucket_count;
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            u32 position = histogram[(m_keys[i] >> shift) & 0xff]++;
+            m_keys_tmp[position] = m_keys[i];
+            m_items_tmp[position] = m_items[i];
+        }
+
+        std::swap(m_keys, m_keys_tmp);
+        std::swap(m_items, m_items_tmp);
+    }
+}
+
+}  // namespace blaz
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "types.h"
+
+namespace blaz {
+
+const u32 SORT_KEY_SHADER_BITS = 12;
+const u32 SORT_KEY_MATERIAL_BITS = 16;
+const u32 SORT_KEY_MESH_BITS = 16;
+const u32 SORT_KEY_DEPTH_BITS = 20;
+
+u64 make_sort_key(u32 shader, u32 material, u32 mesh, u32 depth_bucket);
+u32 make_depth_bucket(f32 depth, f32 max_depth);
+
+struct RenderQueue {
+    vec<u64> m_keys;
+    vec<u32> m_items;
+    vec<u64> m_keys_tmp;
+    vec<u32> m_items_tmp;
+
+    void clear();
+    void resize(size_t count);
+    void push(u64 key, u32 item);
+    void sort();
+
+    size_t size() const {
+        return m_items.size();
+    }
+
+    void set(size_t index, u64 key, u32 item) {
+        m_keys[index] = key;
+        m_items[index] = item;
+    }
+
+    u32 operator[](size_t index) const {
+        return m_items[index];
+    }
+};
+
+}  // namespace blaz
@@ -1,9 +1,14 @@
 #include "renderer.h"
 
+#include <algorithm>
+#include <cstring>
+
 #include "filesystem.h"
 #include "game.h"
 #include "logger.h"
+#include "memory.h"
 #include "my_time.h"
+#include "static_batch.h"
 #include "types.h"
 
 namespace blaz {
@@ -18,17 +23,7 @@ Error Renderer::init(Window* window) {
 
     set_swap_interval(1);
 
-    auto resize_callback = [this](Window* window) {
-        for (auto& texture : m_textures) {
-            if (texture.m_resize_to_viewport) {
-                texture.m_width = m_window->m_size.width;
-                texture.m_height = m_window->m_size.height;
-                reload_texture(texture.m_name);
-            }
-        }
-    };
-    m_window->m_resize_callbacks.push_back(resize_callback);
-    resize_callback(m_window);
+    resize_viewport(m_window->m_size);
 
     Shader internal_error_shader;
     internal_error_shader.m_name = "internal_error_shader";
@@ -79,7 +74,28 @@ Error Renderer::init(Window* window) {
             },
         .m_should_reload = true,
     });
+    create_uniform_buffer(UniformBuffer{
+        .m_name = "u_resolution",
+        .m_uniforms =
+            {
+                Uniform{
+                    .m_name = "u_render_scale",
+                    .m_type = UNIFORM_VEC2,
+                },
+            },
+        .m_should_reload = true,
+    });
 
+    m_model_mat_uniform = find_uniform("u_mat", "u_model_mat").value();
+    m_view_mat_uniform = find_uniform("u_mat", "u_view_mat").value();
+    m_projection_mat_uniform = find_uniform("u_mat", "u_projection_mat").value();
+    m_camera_position_uniform = find_uniform("u_view", "u_camera_position").value();
+    m_frame_number_uniform = find_uniform("u_time", "u_frame_number").value();
+    m_render_scale_uniform = find_uniform("u_resolution", "u_render_scale").value();
+
+    set_worker_count(default_worker_count());
+
+    compile_passes();
     for (Pass& pass : m_passes_do_once) {
         do_pass(pass);
     }
@@ -87,220 +103,1820 @@ Error Renderer::init(Window* window) {
     return Error();
 }
 
-u32 Renderer::special_value(const str& name) {
-    if (name == "viewport_width") {
-        return m_window->m_size.width;
-    } else if (name == "viewport_height") {
-        return m_window->m_size.height;
-    } else {
-        return 0;
+void Renderer::set_worker_count(u32 worker_count) {
+    m_thread_pool.init(worker_count);
+}
+
+Renderer::~Renderer() {
+    stop_render_thread();
+}
+
+u32 Renderer::viewport_value(const Expression& expression, Window::Size viewport_size) {
+    f32 value = expression.evaluate(f32(viewport_size.width), f32(viewport_size.height));
+    return value > 0 ? u32(value) : 0;
+}
+
+// Textures without any size expression predate them and simply follow the viewport.
+Window::Size Renderer::viewport_texture_size(const Texture& texture, Window::Size viewport_size) {
+    Window::Size size = {.width = texture.m_width, .height = texture.m_height};
+    if (!texture.m_resize_to_viewport) {
+        return size;
+    }
+    if (texture.m_width_expression.empty() && texture.m_height_expression.empty()) {
+        return viewport_size;
+    }
+    if (!texture.m_width_expression.empty()) {
+        size.width = std::max(viewport_value(texture.m_width_expression, viewport_size), 1u);
+    }
+    if (!texture.m_height_expression.empty()) {
+        size.height = std::max(viewport_value(texture.m_height_expression, viewport_size), 1u);
     }
+    return size;
 }
 
-void Renderer::do_pass(Pass& pass) {
-    if (!pass.m_enabled) return;
+// The part of a texture that is rendered this frame, smaller than the texture itself when
+// dynamic resolution scales viewport sized targets down.
+Window::Size Renderer::texture_render_size(u32 texture_index) {
+    const Texture& texture = m_textures[texture_index];
+    Window::Size size = viewport_texture_size(texture, m_render_size);
+    size.width = std::min(size.width, texture.m_width);
+    size.height = std::min(size.height, texture.m_height);
+    return size;
+}
 
-    u64 pass_start_cpu_time = get_timestamp_microsecond();
+void Renderer::resize_texture_to_viewport(Texture* texture) {
+    Window::Size size = viewport_texture_size(*texture, max_render_size());
+    texture->m_width = size.width;
+    texture->m_height = size.height;
+}
 
-#ifdef DEBUG_RENDERER
-    debug_marker_start(pass.m_name);
-#endif
+void Renderer::evaluate_compute_work_groups(Pass& pass) {
+    for (u32 i = 0; i < 3; i++) {
+        if (std::holds_alternative<u32>(pass.m_compute_work_groups[i])) {
+            pass.m_plan.m_compute_work_groups[i] = std::get<u32>(pass.m_compute_work_groups[i]);
+        } else {
+            pass.m_plan.m_compute_work_groups[i] = viewport_value(
+                std::get<Expression>(pass.m_compute_work_groups[i]), m_render_size);
+        }
+    }
+}
 
-    if (pass.m_type == PassType::COPY) {
-        copy_texture(pass.m_copy_src_texture, pass.m_copy_dst_texture, Vec3I(0, 0, 0),
-                     Vec2I(m_textures[pass.m_copy_src_texture].m_width,
-                           m_textures[pass.m_copy_src_texture].m_height),
-                     Vec3I(0, 0, 0));
+void Renderer::compile_passes() {
+    m_should_compile_passes = false;
+    m_should_build_bvh = true;
+    // New plans draw other renderables, meshes or batches, so what was cached or recorded for
+    // the old ones is stale.
+    m_resource_version++;
+
+    for (Material& material : m_materials) {
+        material.m_resolved_uniforms.clear();
+        for (const auto& uniform_block : material.m_uniforms) {
+            for (const auto& uniform : uniform_block.second) {
+                opt<UniformId> uniform_id = find_uniform(uniform_block.first, uniform.first);
+                if (!uniform_id) {
+                    logger.error("Renderer::compile_passes: Uniform \"" + uniform_block.first +
+                                 "." + uniform.first + "\" not found in material \"" +
+                                 material.m_name + "\"");
+                    continue;
+                }
+                material.m_resolved_uniforms.push_back(
+                    std::make_pair(uniform_id.value(), &uniform.second));
+            }
+        }
+    }
 
-    } else if (pass.m_type == PassType::COMPUTE) {
-        Shader pass_shader = m_shaders[pass.m_shader];
-        if (pass_shader.m_should_reload) {
-            Error err = reload_shader(pass.m_shader);
+    for (vec<Pass>* passes : {&m_passes_do_once, &m_passes}) {
+        for (Pass& pass : *passes) {
+            Error err = compile_pass(pass);
             if (err) {
                 logger.error(err);
             }
         }
+    }
+
+    resolve_history_textures();
+    compile_frame_graph();
+    create_history_framebuffers();
+}
 
-        str shader_to_use = pass.m_shader;
+Error Renderer::compile_pass(Pass& pass) {
+    pass.m_plan = PassPlan();
+    PassPlan& plan = pass.m_plan;
 
-        set_current_shader(shader_to_use);
+    plan.m_cacheable = pass.m_cacheable;
+    if (pass.m_cacheable && pass.m_type == PassType::RENDER && pass.m_use_default_framebuffer) {
+        logger.error("Renderer::compile_pass: Pass \"" + pass.m_name +
+                     "\" renders to the default framebuffer and can't be cached");
+        plan.m_cacheable = false;
+    }
+
+    plan.m_update_every = std::max(pass.m_update_every, 1u);
+    if (plan.m_update_every > 1 && pass.m_type == PassType::RENDER &&
+        pass.m_use_default_framebuffer) {
+        logger.error("Renderer::compile_pass: Pass \"" + pass.m_name +
+                     "\" renders to the default framebuffer and has to run every frame");
+        plan.m_update_every = 1;
+    }
 
-        set_uniform_buffer_data("u_time", {{"u_frame_number", m_frame_number}});
+    if (pass.m_type == PassType::COPY) {
+        if (!m_textures.contains(pass.m_copy_src_texture) ||
+            !m_textures.contains(pass.m_copy_dst_texture)) {
+            return Error("Renderer::compile_pass: Copy textures not found in pass \"" +
+                         pass.m_name + "\"");
+        }
+        plan.m_copy_src_texture = m_textures.index_of(pass.m_copy_src_texture);
+        plan.m_copy_dst_texture = m_textures.index_of(pass.m_copy_dst_texture);
+        plan.m_compiled = true;
+        return Error();
+    }
+
+    if (!m_shaders.contains(pass.m_shader)) {
+        return Error("Renderer::compile_pass: Shader \"" + pass.m_shader +
+                     "\" not found in pass \"" + pass.m_name + "\"");
+    }
+    plan.m_pass_shader = m_shaders.index_of(pass.m_shader);
+    plan.m_shader = plan.m_pass_shader;
+
+    if (m_shaders[plan.m_pass_shader].m_should_reload) {
+        Error err = reload_shader(pass.m_shader);
+        if (err) {
+            logger.error(err);
+        }
+    }
+    plan.m_pass_shader_version = m_shaders[plan.m_pass_shader].m_version;
+
+    if (pass.m_type == PassType::RENDER && m_shaders[plan.m_pass_shader].m_is_error) {
+        plan.m_shader = m_shaders.index_of("internal_error_shader");
+    }
+    plan.m_instanced = m_shaders[plan.m_shader].m_instanced;
+
+    for (const auto& uniform_binding : m_shaders[plan.m_shader].m_uniform_bindings) {
+        PassBinding binding;
+        binding.m_type = uniform_binding.second.m_type;
+        binding.m_binding_point = uniform_binding.second.m_binding_point;
+
+        str resource;
+        if (binding.m_type == UniformBindingType::BLOCK) {
+            if (!m_uniform_buffers.contains(uniform_binding.first)) {
+                logger.error("Renderer::compile_pass: Uniform buffer \"" + uniform_binding.first +
+                             "\" not found in pass \"" + pass.m_name + "\"");
+                continue;
+            }
+            binding.m_resource = m_uniform_buffers.index_of(uniform_binding.first);
+        } else {
+            if (binding.m_type == UniformBindingType::SAMPLER &&
+                pass.m_sampler_uniforms_bindings.contains(uniform_binding.first)) {
+                resource = pass.m_sampler_uniforms_bindings.at(uniform_binding.first);
+            } else if (binding.m_type == UniformBindingType::IMAGE &&
+                       pass.m_image_uniforms_bindings.contains(uniform_binding.first)) {
+                resource = pass.m_image_uniforms_bindings.at(uniform_binding.first).first;
+                binding.m_access = pass.m_image_uniforms_bindings.at(uniform_binding.first).second;
+            }
+            if (!m_textures.contains(resource)) {
+                logger.error("Renderer::compile_pass: No texture bound to \"" +
+                             uniform_binding.first + "\" in pass \"" + pass.m_name + "\"");
+                continue;
+            }
+            binding.m_resource = m_textures.index_of(resource);
+        }
+        plan.m_bindings.push_back(binding);
+    }
 
-        bind_uniforms(&pass, shader_to_use);
+    for (const PassBinding& binding : plan.m_bindings) {
+        if (plan.m_cacheable && binding.m_type == UniformBindingType::BLOCK &&
+            binding.m_resource == m_frame_number_uniform.m_uniform_buffer) {
+            logger.error("Renderer::compile_pass: Pass \"" + pass.m_name +
+                         "\" reads the per frame uniform block \"u_time\" and can't be cached");
+            plan.m_cacheable = false;
+        }
+    }
 
-        u32 work_groups[3];
+    if (pass.m_type == PassType::COMPUTE) {
         for (u32 i = 0; i < 3; i++) {
-            if (std::holds_alternative<u32>(pass.m_compute_work_groups[i])) {
-                work_groups[i] = std::get<u32>(pass.m_compute_work_groups[i]);
-            } else if (std::holds_alternative<str>(pass.m_compute_work_groups[i])) {
-                work_groups[i] = special_value(std::get<str>(pass.m_compute_work_groups[i]));
+            if (std::holds_alternative<Expression>(pass.m_compute_work_groups[i]) &&
+                std::get<Expression>(pass.m_compute_work_groups[i]).empty()) {
+                return Error("Renderer::compile_pass: Empty work group expression in pass \"" +
+                             pass.m_name + "\"");
             }
         }
-        dispatch_compute(work_groups[0], work_groups[1], work_groups[2]);
+        evaluate_compute_work_groups(pass);
+        plan.m_compiled = true;
+        return Error();
+    }
 
-    } else if (pass.m_type == PassType::RENDER) {
-        f32 framebuffer_aspect_ratio = 1.0;
-        if (pass.m_use_default_framebuffer) {
-            set_default_framebuffer();
-            framebuffer_aspect_ratio = f32(m_window->m_size.width) / f32(m_window->m_size.height);
-            set_viewport(0, 0, m_window->m_size.width, m_window->m_size.height);
+    if (!pass.m_use_default_framebuffer) {
+        if (!m_framebuffers.contains(pass.m_framebuffer)) {
+            return Error("Renderer::compile_pass: Framebuffer \"" + pass.m_framebuffer +
+                         "\" not found in pass \"" + pass.m_name + "\"");
+        }
+        plan.m_framebuffer = m_framebuffers.index_of(pass.m_framebuffer);
+
+        Framebuffer* framebuffer = &m_framebuffers[plan.m_framebuffer];
+        if (framebuffer->m_color_attachment_texture != "") {
+            plan.m_framebuffer_texture =
+                m_textures.index_of(framebuffer->m_color_attachment_texture);
+        } else if (framebuffer->m_depth_attachment_texture != "") {
+            plan.m_framebuffer_texture =
+                m_textures.index_of(framebuffer->m_depth_attachment_texture);
         } else {
-            set_current_framebuffer(pass.m_framebuffer);
+            logger.error("Framebuffer " + framebuffer->m_name + " doesn't have any attachment");
+        }
+    }
+
+    if (pass.m_camera != "") {
+        if (!m_current_cameras->contains(pass.m_camera)) {
+            return Error("Renderer::compile_pass: Camera \"" + pass.m_camera +
+                         "\" not found in pass \"" + pass.m_name + "\"");
+        }
+        plan.m_camera = m_current_cameras->index_of(pass.m_camera);
+        Camera* camera = &(*m_current_cameras)[plan.m_camera];
+        if (m_current_scene != NULL) {
+            plan.m_camera_node = m_current_scene->m_nodes.index_of(camera->m_node);
+        }
+    }
 
-            Texture* texture = NULL;
-            Framebuffer* framebuffer = &m_framebuffers[pass.m_framebuffer];
-            if (framebuffer->m_color_attachment_texture != "") {
-                texture = &m_textures[framebuffer->m_color_attachment_texture];
-            } else if (framebuffer->m_depth_attachment_texture != "") {
-                texture = &m_textures[framebuffer->m_depth_attachment_texture];
+    if (!pass.m_bufferless_draw && m_current_scene != NULL) {
+        for (const str& tag : pass.m_tags) {
+            auto tagged_renderables = m_tagged_renderables.find(tag);
+            if (tagged_renderables == m_tagged_renderables.end()) {
+                continue;
             }
+            for (const u32 id : tagged_renderables->second) {
+                Renderable* renderable = &m_renderables[id];
+                if (renderable->m_static_batch != INVALID_INDEX) {
+                    continue;
+                }
+                if (!m_meshes.contains(renderable->m_mesh) ||
+                    !m_current_scene->m_nodes.contains(renderable->m_node)) {
+                    logger.error("Renderer::compile_pass: Renderable \"" + renderable->m_name +
+                                 "\" has an invalid mesh or node");
+                    continue;
+                }
 
-            if (texture != NULL) {
-                framebuffer_aspect_ratio = f32(texture->m_width) / f32(texture->m_height);
-                set_viewport(0, 0, texture->m_width, texture->m_height);
-            } else {
-                logger.error("Framebuffer " + framebuffer->m_name + " doesn't have any attachment");
+                DrawItem draw_item;
+                draw_item.m_renderable = id;
+                draw_item.m_mesh = m_meshes.index_of(renderable->m_mesh);
+                draw_item.m_node = m_current_scene->m_nodes.index_of(renderable->m_node);
+                if (m_materials.contains(renderable->m_material)) {
+                    draw_item.m_material = m_materials.index_of(renderable->m_material);
+                } else if (renderable->m_material != "") {
+                    logger.error("Renderer::compile_pass: Material \"" + renderable->m_material +
+                                 "\" not found in renderable \"" + renderable->m_name + "\"");
+                }
+                plan.m_draws.push_back(draw_item);
+                if (draw_item.m_material != INVALID_INDEX) {
+                    plan.m_materials.push_back(draw_item.m_material);
+                }
             }
         }
+    }
+    std::sort(plan.m_materials.begin(), plan.m_materials.end());
+    plan.m_materials.erase(std::unique(plan.m_materials.begin(), plan.m_materials.end()),
+                           plan.m_materials.end());
 
-        if (pass.m_enable_depth_test) {
-            set_depth_test(true);
-        } else {
-            set_depth_test(false);
+    plan.m_compiled = true;
+    return Error();
+}
+
+// Tests the world bounds of every draw against the frustum of the pass camera, keeping the
+// indices of the visible draws in plan.m_visible_draws.
+void Renderer::cull_draws(Pass& pass) {
+    PassPlan& plan = pass.m_plan;
+    u32 draw_count = u32(plan.m_draws.size());
+    plan.m_visible_draws.clear();
+
+    if (!m_frustum_culling || plan.m_camera == INVALID_INDEX) {
+        for (u32 i = 0; i < draw_count; i++) {
+            plan.m_visible_draws.push_back(i);
+        }
+    } else if (m_bvh_culling) {
+        Camera* camera = &(*m_current_cameras)[plan.m_camera];
+        Frustum frustum = make_frustum(camera->m_view_matrix * camera->m_projection_matrix);
+        m_bvh_query_items.clear();
+        m_bvh.query_frustum(frustum, &m_bvh_query_items);
+        m_bvh_visibility.assign(m_bvh.m_item_leaves.size(), 0);
+        for (u32 item : m_bvh_query_items) {
+            m_bvh_visibility[item] = 1;
         }
 
-        set_face_culling(pass.m_enable_face_culling, pass.m_culling_mode, pass.m_culling_order);
+        for (u32 i = 0; i < draw_count; i++) {
+            u32 renderable = plan.m_draws[i].m_renderable;
+            // Renderables without bounds are not in the tree and are always drawn.
+            if (renderable >= m_bvh.m_item_leaves.size() ||
+                m_bvh.m_item_leaves[renderable] == INVALID_INDEX ||
+                m_bvh_visibility[renderable]) {
+                plan.m_visible_draws.push_back(i);
+            }
+        }
+    } else {
+        Camera* camera = &(*m_current_cameras)[plan.m_camera];
+        // Mat4 products read right to left, so this is u_projection_mat * u_view_mat.
+        Frustum frustum = make_frustum(camera->m_view_matrix * camera->m_projection_matrix);
+        plan.m_bounds.resize(draw_count);
+        plan.m_visibility.resize(draw_count);
+
+        u32 chunk_count =
+            (draw_count + PARALLEL_RECORD_CHUNK_SIZE - 1) / PARALLEL_RECORD_CHUNK_SIZE;
+        m_thread_pool.parallel_for(chunk_count, [&](u32 chunk) {
+            u32 begin = chunk * PARALLEL_RECORD_CHUNK_SIZE;
+            u32 end = std::min(draw_count, begin + PARALLEL_RECORD_CHUNK_SIZE);
+            for (u32 i = begin; i < end; i++) {
+                const DrawItem& draw_item = plan.m_draws[i];
+                const Mesh& mesh = m_meshes[draw_item.m_mesh];
+                if (mesh.m_has_bounds) {
+                    const Mat4& matrix = m_current_scene->m_nodes[draw_item.m_node].m_global_matrix;
+                    plan.m_bounds.set(i, transform_aabb(matrix, mesh.m_aabb_min, mesh.m_aabb_max));
+                } else {
+                    plan.m_bounds.set_infinite(i);
+                }
+            }
+            cull_bounds(frustum, plan.m_bounds, begin, end, plan.m_visibility.data());
+        });
+
+        for (u32 i = 0; i < draw_count; i++) {
+            if (plan.m_visibility[i]) {
+                plan.m_visible_draws.push_back(i);
+            }
+        }
+    }
 
-        clear(pass.m_clear_flag, pass.m_clear_color, pass.m_clear_depth);
+    pass.m_culled_count = draw_count - u32(plan.m_visible_draws.size());
+    pass.m_occluded_count = 0;
+    if (m_occlusion_culling && plan.m_camera != INVALID_INDEX) {
+        occlusion_cull_draws(pass);
+    }
+    pass.m_visible_count = u32(plan.m_visible_draws.size());
+}
 
-        Shader pass_shader = m_shaders[pass.m_shader];
-        if (pass_shader.m_should_reload) {
-            Error err = reload_shader(pass.m_shader);
-            if (err) {
-                logger.error(err);
+void Renderer::render_occluders(u32 camera) {
+    if (m_occlusion_buffer.m_levels.empty()) {
+        m_occlusion_buffer.resize(OCCLUSION_BUFFER_WIDTH, OCCLUSION_BUFFER_HEIGHT);
+    }
+    Camera* occlusion_camera = &(*m_current_cameras)[camera];
+    m_occlusion_buffer.begin(occlusion_camera->m_view_matrix *
+                             occlusion_camera->m_projection_matrix);
+    m_renderable_occluders.assign(m_renderables.size(), 0);
+
+    auto occluders = m_tagged_renderables.find(OCCLUDER_TAG);
+    if (occluders != m_tagged_renderables.end()) {
+        for (u32 id : occluders->second) {
+            const Renderable& renderable = m_renderables[id];
+            if (renderable.m_static_batch != INVALID_INDEX) {
+                continue;
+            }
+            const str& mesh_name =
+                renderable.m_occluder_mesh != "" ? renderable.m_occluder_mesh : renderable.m_mesh;
+            if (!m_meshes.contains(mesh_name) ||
+                !m_current_scene->m_nodes.contains(renderable.m_node)) {
+                continue;
+            }
+            const Mesh& mesh = m_meshes[mesh_name];
+            u32 stride;
+            u32 position_offset;
+            if (mesh.m_primitive != MeshPrimitive::TRIANGLES ||
+                !mesh_position_layout(&mesh, &stride, &position_offset)) {
+                continue;
+            }
+            // The coarsest detail level is enough for a low resolution depth buffer.
+            u32 first_index = 0;
+            u32 index_count = u32(mesh_indices(&mesh).size());
+            if (!mesh.m_lods.empty()) {
+                first_index = mesh.m_lods.back().m_first_index;
+                index_count = mesh.m_lods.back().m_index_count;
             }
+            m_occlusion_buffer.add_occluder(
+                m_current_scene->m_nodes[renderable.m_node].m_global_matrix, mesh_vertices(&mesh),
+                stride, position_offset, mesh_indices(&mesh).data() + first_index, index_count);
+            m_renderable_occluders[id] = 1;
         }
+    }
+
+    m_occlusion_buffer.rasterize(&m_thread_pool);
+    m_occlusion_camera = camera;
+    m_occlusion_frame = m_frame_number;
+}
 
-        str shader_to_use = pass.m_shader;
-        if (pass_shader.m_is_error) {
-            shader_to_use = "internal_error_shader";
+// Occluders and draws without bounds are kept. The remaining draws are tested in parallel
+// chunks, then the visible list is compacted in order.
+void Renderer::occlusion_cull_draws(Pass& pass) {
+    PassPlan& plan = pass.m_plan;
+    if (m_occlusion_camera != plan.m_camera || m_occlusion_frame != m_frame_number) {
+        render_occluders(plan.m_camera);
+    }
+
+    u32 visible_count = u32(plan.m_visible_draws.size());
+    plan.m_occlusion_visibility.resize(visible_count);
+    u32 chunk_count =
+        (visible_count + PARALLEL_RECORD_CHUNK_SIZE - 1) / PARALLEL_RECORD_CHUNK_SIZE;
+    m_thread_pool.parallel_for(chunk_count, [&](u32 chunk) {
+        u32 begin = chunk * PARALLEL_RECORD_CHUNK_SIZE;
+        u32 end = std::min(visible_count, begin + PARALLEL_RECORD_CHUNK_SIZE);
+        for (u32 i = begin; i < end; i++) {
+            const DrawItem& draw_item = plan.m_draws[plan.m_visible_draws[i]];
+            const Mesh& mesh = m_meshes[draw_item.m_mesh];
+            bool visible = true;
+            if (mesh.m_has_bounds && !m_renderable_occluders[draw_item.m_renderable]) {
+                const Mat4& matrix = m_current_scene->m_nodes[draw_item.m_node].m_global_matrix;
+                visible = m_occlusion_buffer.is_visible(
+                    transform_aabb(matrix, mesh.m_aabb_min, mesh.m_aabb_max));
+            }
+            plan.m_occlusion_visibility[i] = visible;
         }
+    });
 
-        set_current_shader(shader_to_use);
+    u32 kept = 0;
+    for (u32 i = 0; i < visible_count; i++) {
+        if (plan.m_occlusion_visibility[i]) {
+            plan.m_visible_draws[kept++] = plan.m_visible_draws[i];
+        }
+    }
+    plan.m_visible_draws.resize(kept);
+    pass.m_occluded_count = visible_count - kept;
+}
 
-        if (pass.m_camera != "") {
-            Camera* camera = &m_cameras[pass.m_camera];
-            camera->set_aspect_ratio(framebuffer_aspect_ratio);
-            camera->update_projection_matrix();
-            camera->update_view_matrix();
-            set_uniform_buffer_data("u_mat", {{"u_projection_mat", camera->m_projection_matrix},
-                                              {"u_view_mat", camera->m_view_matrix}});
-            set_uniform_buffer_data(
-                "u_view",
-                {{"u_camera_position", camera->m_scene->m_nodes[camera->m_node].m_position}});
+void Renderer::select_draw_lods(Pass& pass) {
+    PassPlan& plan = pass.m_plan;
+    if (!m_mesh_lod || plan.m_camera == INVALID_INDEX) {
+        for (u32 draw_index : plan.m_visible_draws) {
+            plan.m_draws[draw_index].m_lod = 0;
         }
+        return;
+    }
 
-        set_uniform_buffer_data("u_time", {{"u_frame_number", m_frame_number}});
+    Camera* camera = &(*m_current_cameras)[plan.m_camera];
+    Mat4 view_projection = camera->m_view_matrix * camera->m_projection_matrix;
+    const f32* vp = view_projection.m;
+    // Pixels covered by one world unit at a clip w of 1.
+    f32 pixel_scale = camera->m_projection_matrix.m[5] * f32(m_render_size.height) * 0.5f;
+    f32 coarser_pixel_error = m_lod_pixel_error * (1.0f - m_lod_hysteresis);
+
+    for (u32 draw_index : plan.m_visible_draws) {
+        DrawItem& draw_item = plan.m_draws[draw_index];
+        const Mesh& mesh = m_meshes[draw_item.m_mesh];
+        u32 lod_count = u32(mesh.m_lods.size());
+        if (lod_count < 2) {
+            draw_item.m_lod = 0;
+            continue;
+        }
 
-        bind_uniforms(&pass, shader_to_use);
+        const f32* m = m_current_scene->m_nodes[draw_item.m_node].m_global_matrix.m;
+        Vec3 center = mesh.m_bounding_sphere_center;
+        f32 world_center[3];
+        f32 scale = 0;
+        for (u32 r = 0; r < 3; r++) {
+            world_center[r] = m[r] * center.v[0] + m[4 + r] * center.v[1] +
+                              m[8 + r] * center.v[2] + m[12 + r];
+            scale = std::max(scale, Vec3(m[r * 4], m[r * 4 + 1], m[r * 4 + 2]).length());
+        }
+        f32 w = vp[3] * world_center[0] + vp[7] * world_center[1] + vp[11] * world_center[2] +
+                vp[15];
+        if (w <= 1e-4f) {
+            draw_item.m_lod = 0;
+            continue;
+        }
 
-        if (pass.m_bufferless_draw) {
-            set_bufferless_mesh();
-            draw(MeshPrimitive::TRIANGLES, pass.m_bufferless_draw_count);
-        } else {
-            for (const str tag : pass.m_tags) {
-                for (const u32 id : m_tagged_renderables[tag]) {
-                    Renderable* renderable = &m_renderables[id];
+        f32 error_to_pixels = scale * pixel_scale / w;
+        u32 lod = std::min(draw_item.m_lod, lod_count - 1);
+        while (lod > 0 && mesh.m_lods[lod].m_error * error_to_pixels > m_lod_pixel_error) {
+            lod--;
+        }
+        while (lod + 1 < lod_count &&
+               mesh.m_lods[lod + 1].m_error * error_to_pixels <= coarser_pixel_error) {
+            lod++;
+        }
+        draw_item.m_lod = lod;
+    }
+}
 
-					if(renderable->m_material != ""){
-						Material* material = &m_materials[renderable->m_material];
+bool Renderer::renderable_bounds(u32 renderable, Aabb* bounds) {
+    const Renderable& current = m_renderables[renderable];
+    if (current.m_static_batch != INVALID_INDEX || !m_meshes.contains(current.m_mesh) ||
+        !m_current_scene->m_nodes.contains(current.m_node)) {
+        return false;
+    }
+    const Mesh& mesh = m_meshes[current.m_mesh];
+    if (!mesh.m_has_bounds) {
+        return false;
+    }
+    *bounds = transform_aabb(m_current_scene->m_nodes[current.m_node].m_global_matrix,
+                             mesh.m_aabb_min, mesh.m_aabb_max);
+    return true;
+}
 
-						for (const auto& uniform_block : material->m_uniforms) {
-							const str& block_name = uniform_block.first;
-							const auto& uniforms = uniform_block.second;
+// Drains the scene dirty node list. The tree is built after passes are compiled, since that is
+// when renderables, meshes or nodes may have changed, and refitted from the dirty nodes
+// otherwise. Once as many leaves were refitted as there are items, a full rebuild is started in
+// the background to recover from the quality loss of refitting.
+void Renderer::update_bvh() {
+    if (m_current_scene == NULL) {
+        return;
+    }
+    vec<u32>& dirty_nodes = m_current_scene->m_dirty_nodes;
+    ArrayMap<Node>& nodes = m_current_scene->m_nodes;
+
+    if (m_bvh_culling && m_should_build_bvh) {
+        m_should_build_bvh = false;
+        u32 renderable_count = u32(m_renderables.size());
+        vec<Aabb> item_bounds(renderable_count);
+        vec<bool> item_valid(renderable_count);
+        m_node_renderables.assign(nodes.size(), {});
+        for (u32 i = 0; i < renderable_count; i++) {
+            item_valid[i] = renderable_bounds(i, &item_bounds[i]);
+            if (item_valid[i]) {
+                m_node_renderables[nodes.index_of(m_renderables[i].m_node)].push_back(i);
+            }
+        }
+        m_bvh.build(item_bounds, item_valid);
+    } else if (m_bvh_culling) {
+        for (u32 node : dirty_nodes) {
+            if (node >= m_node_renderables.size()) {
+                continue;
+            }
+            for (u32 renderable : m_node_renderables[node]) {
+                Aabb bounds;
+                if (renderable_bounds(renderable, &bounds)) {
+                    m_bvh.update(renderable, bounds);
+                }
+            }
+        }
+    }
 
-							vec<pair<str, UniformValue>> uniform_data;
-							for (const auto& uniform : uniforms) {
-								uniform_data.push_back(std::make_pair(uniform.first, uniform.second));
-							}
+    for (u32 node : dirty_nodes) {
+        if (node < nodes.size()) {
+            nodes[node].m_in_dirty_list = false;
+        }
+    }
+    dirty_nodes.clear();
 
-							set_uniform_buffer_data(block_name, uniform_data);
-						}
-					}
+    if (m_bvh_culling) {
+        m_bvh.finish_rebuild();
+        if (!m_bvh.rebuilding() && m_bvh.m_refit_count > m_bvh.m_item_leaves.size()) {
+            m_bvh.start_rebuild();
+        }
+    }
+}
 
-                    set_uniform_buffer_data(
-                        "u_mat", {{"u_model_mat",
-                                   m_current_scene->m_nodes[renderable->m_node].m_global_matrix}});
-                    Mesh* mesh = &m_meshes[renderable->m_mesh];
+void Renderer::build_render_queue(Pass& pass) {
+    PassPlan& plan = pass.m_plan;
+    plan.m_queue.resize(plan.m_visible_draws.size());
 
-                    if (mesh->m_should_reload) {
-                        Error err = reload_mesh(renderable->m_mesh);
-                    }
+    Vec3 camera_position = Vec3(0, 0, 0);
+    f32 max_depth = 0;
+    if (plan.m_camera != INVALID_INDEX) {
+        Camera* camera = &(*m_current_cameras)[plan.m_camera];
+        camera_position = m_current_scene->m_nodes[plan.m_camera_node].get_global_position();
+        max_depth = camera->m_z_far;
+    }
+
+    u32 draw_count = u32(plan.m_visible_draws.size());
+    u32 chunk_count = (draw_count + PARALLEL_RECORD_CHUNK_SIZE - 1) / PARALLEL_RECORD_CHUNK_SIZE;
+    m_thread_pool.parallel_for(chunk_count, [&](u32 chunk) {
+        u32 end = std::min(draw_count, (chunk + 1) * PARALLEL_RECORD_CHUNK_SIZE);
+        for (u32 i = chunk * PARALLEL_RECORD_CHUNK_SIZE; i < end; i++) {
+            u32 draw_index = plan.m_visible_draws[i];
+            const DrawItem& draw_item = plan.m_draws[draw_index];
+            Vec3 position = m_current_scene->m_nodes[draw_item.m_node].get_global_position();
+            f32 depth = (position - camera_position).length();
+            plan.m_queue.set(i,
+                             make_sort_key(plan.m_shader, draw_item.m_material, draw_item.m_mesh,
+                                           make_depth_bucket(depth, max_depth)),
+                             draw_index);
+        }
+    });
+
+    plan.m_queue.sort();
+}
+
+void Renderer::build_draw_batches(Pass& pass) {
+    PassPlan& plan = pass.m_plan;
+    plan.m_batches.clear();
+    m_instance_data.clear();
+
+    for (size_t i = 0; i < plan.m_queue.size(); i++) {
+        const DrawItem& draw_item = plan.m_draws[plan.m_queue[i]];
+
+        bool new_batch = !plan.m_instanced || plan.m_batches.empty() ||
+                         plan.m_batches.back().m_mesh != draw_item.m_mesh ||
+                         plan.m_batches.back().m_material != draw_item.m_material ||
+                         plan.m_batches.back().m_lod != draw_item.m_lod;
+        if (new_batch) {
+            plan.m_batches.push_back(DrawBatch{
+                .m_mesh = draw_item.m_mesh,
+                .m_material = draw_item.m_material,
+                .m_node = draw_item.m_node,
+                .m_lod = draw_item.m_lod,
+                .m_first_instance = u32(m_instance_data.size()),
+                .m_instance_count = 0,
+            });
+        }
+        plan.m_batches.back().m_instance_count++;
+
+        if (plan.m_instanced) {
+            m_instance_data.push_back(m_current_scene->m_nodes[draw_item.m_node].m_global_matrix);
+        }
+    }
+}
+
+void Renderer::record_pass(Pass& pass, CommandBuffer& command_buffer) {
+    PassPlan& plan = pass.m_plan;
+    command_buffer.reset();
 
-                    set_current_mesh(renderable->m_mesh);
-                    draw_indexed(mesh->m_primitive, mesh->m_indices.size());
+#ifdef DEBUG_RENDERER
+    command_buffer.debug_marker_start(pass.m_name);
+#endif
+
+    if (pass.m_type == PassType::COPY) {
+        Window::Size src_size = texture_render_size(plan.m_copy_src_texture);
+        command_buffer.copy_texture(plan.m_copy_src_texture, plan.m_copy_dst_texture,
+                                    Vec3I(0, 0, 0), Vec2I(src_size.width, src_size.height),
+                                    Vec3I(0, 0, 0));
+
+    } else if (pass.m_type == PassType::COMPUTE) {
+        command_buffer.set_shader(plan.m_shader);
+        command_buffer.bind_uniforms(plan.m_bindings);
+        command_buffer.dispatch_compute(plan.m_compute_work_groups[0],
+                                        plan.m_compute_work_groups[1],
+                                        plan.m_compute_work_groups[2]);
+
+    } else if (pass.m_type == PassType::RENDER) {
+        if (pass.m_use_default_framebuffer) {
+            command_buffer.set_default_framebuffer();
+            command_buffer.set_viewport(0, 0, m_viewport_size.width, m_viewport_size.height);
+        } else {
+            command_buffer.set_framebuffer(plan.m_framebuffer);
+
+            if (plan.m_framebuffer_texture != INVALID_INDEX) {
+                Window::Size size = texture_render_size(plan.m_framebuffer_texture);
+                command_buffer.set_viewport(0, 0, size.width, size.height);
+            }
+        }
+
+        command_buffer.set_depth_test(pass.m_enable_depth_test);
+        command_buffer.set_face_culling(pass.m_enable_face_culling, pass.m_culling_mode,
+                                        pass.m_culling_order);
+        command_buffer.clear(pass.m_clear_flag, pass.m_clear_color, pass.m_clear_depth);
+        command_buffer.set_shader(plan.m_shader);
+        command_buffer.bind_uniforms(plan.m_bindings);
+
+        if (pass.m_bufferless_draw) {
+            command_buffer.set_bufferless_mesh();
+            command_buffer.draw(MeshPrimitive::TRIANGLES, pass.m_bufferless_draw_count);
+        } else {
+            cull_draws(pass);
+            select_draw_lods(pass);
+            build_render_queue(pass);
+            build_draw_batches(pass);
+
+            if (plan.m_instanced && !m_instance_data.empty()) {
+                command_buffer.set_instance_data(m_instance_data.data(),
+                                                 u32(m_instance_data.size()));
+            }
+
+            for (const DrawBatch& draw_batch : plan.m_batches) {
+                Mesh* mesh = &m_meshes[draw_batch.m_mesh];
+                if (mesh->m_should_reload) {
+                    Error err = reload_mesh(mesh->m_name);
+                }
+            }
+
+            u32 batch_count = u32(plan.m_batches.size());
+            if (m_thread_pool.m_workers.empty() || batch_count <= PARALLEL_RECORD_CHUNK_SIZE) {
+                record_draw_batches(pass, 0, batch_count, command_buffer, m_frame_stats);
+            } else {
+                // Chunks record on their own, so an indirect draw can't span two of them.
+                vec<u32> chunk_begins;
+                for (u32 begin = 0; begin < batch_count;) {
+                    chunk_begins.push_back(begin);
+                    begin = std::min(batch_count, begin + PARALLEL_RECORD_CHUNK_SIZE);
+                    while (begin < batch_count && joins_indirect_draw(plan, begin - 1, begin)) {
+                        begin++;
+                    }
+                }
+                chunk_begins.push_back(batch_count);
+                u32 chunk_count = u32(chunk_begins.size()) - 1;
+                if (m_chunk_command_buffers.size() < chunk_count) {
+                    m_chunk_command_buffers.resize(chunk_count);
+                }
+                vec<FrameStats> chunk_stats(chunk_count);
+                m_thread_pool.parallel_for(chunk_count, [&](u32 chunk) {
+                    m_chunk_command_buffers[chunk].reset();
+                    record_draw_batches(pass, chunk_begins[chunk], chunk_begins[chunk + 1],
+                                        m_chunk_command_buffers[chunk], chunk_stats[chunk]);
+                });
+
+                for (u32 chunk = 0; chunk < chunk_count; chunk++) {
+                    command_buffer.append(m_chunk_command_buffers[chunk]);
+                    m_frame_stats.m_material_binds += chunk_stats[chunk].m_material_binds;
+                    m_frame_stats.m_material_binds_skipped +=
+                        chunk_stats[chunk].m_material_binds_skipped;
+                    m_frame_stats.m_mesh_binds += chunk_stats[chunk].m_mesh_binds;
+                    m_frame_stats.m_mesh_binds_skipped += chunk_stats[chunk].m_mesh_binds_skipped;
+                    m_frame_stats.m_meshlets_drawn += chunk_stats[chunk].m_meshlets_drawn;
+                    m_frame_stats.m_meshlets_culled += chunk_stats[chunk].m_meshlets_culled;
                 }
             }
         }
     }
 
 #ifdef DEBUG_RENDERER
-    debug_marker_end();
+    command_buffer.debug_marker_end();
 #endif
+}
+
+static u32 uniform_value_bytes(const UniformValue& uniform_value, u8* bytes) {
+    if (std::holds_alternative<bool>(uniform_value)) {
+        u32 bool_value = std::get<bool>(uniform_value);
+        memcopy(bytes, &bool_value, sizeof(bool_value));
+        return sizeof(bool_value);
+    }
+    return std::visit(
+        [bytes](const auto& value) {
+            memcopy(bytes, &value, sizeof(value));
+            return u32(sizeof(value));
+        },
+        uniform_value);
+}
+
+void Renderer::material_values(const PassPlan& plan, vec<u8>& values) {
+    values.clear();
+    u8 bytes[sizeof(Mat4)];
+    for (u32 material : plan.m_materials) {
+        for (const auto& uniform : m_materials[material].m_resolved_uniforms) {
+            u32 size = uniform_value_bytes(*uniform.second, bytes);
+            values.insert(values.end(), bytes, bytes + size);
+        }
+    }
+}
+
+static MeshLod draw_lod(const Mesh* mesh, u32 lod) {
+    if (lod < mesh->m_lods.size()) {
+        return mesh->m_lods[lod];
+    }
+    return MeshLod{.m_first_index = 0, .m_index_count = u32(mesh_indices(mesh).size())};
+}
+
+// Instanced batches of pooled meshes with the same material and pool as the batch first are
+// drawn with it, in one indirect draw.
+bool Renderer::joins_indirect_draw(const PassPlan& plan, u32 first, u32 batch) {
+    const Mesh* first_mesh = &m_meshes[plan.m_batches[first].m_mesh];
+    const Mesh* batch_mesh = &m_meshes[plan.m_batches[batch].m_mesh];
+    return plan.m_instanced && m_multi_draw_indirect && first_mesh->m_pool != INVALID_INDEX &&
+           plan.m_batches[batch].m_material == plan.m_batches[first].m_material &&
+           batch_mesh->m_pool == first_mesh->m_pool &&
+           batch_mesh->m_primitive == first_mesh->m_primitive;
+}
+
+void Renderer::record_draw_batches(Pass& pass, u32 begin, u32 end, CommandBuffer& command_buffer,
+                                   FrameStats& stats) {
+    PassPlan& plan = pass.m_plan;
+    vec<DrawIndirectCommand> indirect_draws;
+
+    u32 current_material = INVALID_INDEX;
+    u32 current_mesh = INVALID_INDEX;
+    if (begin > 0) {
+        current_material = plan.m_batches[begin - 1].m_material;
+        current_mesh = plan.m_batches[begin - 1].m_mesh;
+    }
+
+    for (u32 i = begin; i < end; i++) {
+        const DrawBatch& draw_batch = plan.m_batches[i];
+        if (draw_batch.m_material != current_material) {
+            current_material = draw_batch.m_material;
+            if (current_material != INVALID_INDEX) {
+                Material* material = &m_materials[current_material];
+                for (const auto& uniform : material->m_resolved_uniforms) {
+                    record_uniform(command_buffer, uniform.first, *uniform.second);
+                }
+                stats.m_material_binds++;
+            }
+        } else if (current_material != INVALID_INDEX) {
+            stats.m_material_binds_skipped++;
+        }
+
+        if (!plan.m_instanced) {
+            record_uniform(command_buffer, m_model_mat_uniform,
+                           m_current_scene->m_nodes[draw_batch.m_node].m_global_matrix);
+        }
+        Mesh* mesh = &m_meshes[draw_batch.m_mesh];
+
+        if (draw_batch.m_mesh != current_mesh) {
+            current_mesh = draw_batch.m_mesh;
+            command_buffer.set_mesh(current_mesh);
+            stats.m_mesh_binds++;
+        } else {
+            stats.m_mesh_binds_skipped++;
+        }
+
+        if (plan.m_instanced && m_multi_draw_indirect && mesh->m_pool != INVALID_INDEX) {
+            indirect_draws.clear();
+            u32 run_end = i;
+            for (; run_end < end && joins_indirect_draw(plan, i, run_end); run_end++) {
+                const DrawBatch& batch = plan.m_batches[run_end];
+                const Mesh* batch_mesh = &m_meshes[batch.m_mesh];
+                MeshLod lod = draw_lod(batch_mesh, batch.m_lod);
+                indirect_draws.push_back(DrawIndirectCommand{
+                    .m_count = lod.m_index_count,
+                    .m_instance_count = batch.m_instance_count,
+                    .m_first_index = batch_mesh->m_pool_first_index + lod.m_first_index,
+                    .m_base_vertex = i32(batch_mesh->m_pool_base_vertex),
+                    .m_first_instance = batch.m_first_instance,
+                });
+            }
+            command_buffer.multi_draw_indexed_indirect(mesh->m_primitive, indirect_draws.data(),
+                                                       u32(indirect_draws.size()));
+            stats.m_mesh_binds_skipped += run_end - i - 1;
+            current_mesh = plan.m_batches[run_end - 1].m_mesh;
+            i = run_end - 1;
+            continue;
+        }
+
+        MeshLod lod = draw_lod(mesh, draw_batch.m_lod);
+        if (plan.m_instanced) {
+            command_buffer.draw_indexed_instanced(mesh->m_primitive, lod.m_index_count,
+                                                  draw_batch.m_instance_count,
+                                                  draw_batch.m_first_instance,
+                                                  lod.m_first_index);
+        } else if (m_meshlet_culling && !mesh->m_meshlets.empty() &&
+                   plan.m_camera != INVALID_INDEX) {
+            record_meshlet_draw(pass, mesh, draw_batch, command_buffer, stats);
+        } else {
+            command_buffer.draw_indexed(mesh->m_primitive, lod.m_index_count,
+                                        lod.m_first_index);
+        }
+    }
+}
+
+void Renderer::record_meshlet_draw(const Pass& pass, const Mesh* mesh,
+                                   const DrawBatch& draw_batch, CommandBuffer& command_buffer,
+                                   FrameStats& stats) {
+    const PassPlan& plan = pass.m_plan;
+    u32 first_meshlet = 0;
+    u32 meshlet_count = u32(mesh->m_meshlets.size());
+    if (draw_batch.m_lod < mesh->m_lods.size()) {
+        first_meshlet = mesh->m_lods[draw_batch.m_lod].m_first_meshlet;
+        meshlet_count = mesh->m_lods[draw_batch.m_lod].m_meshlet_count;
+    }
+
+    // Meshlets are tested in mesh space, so their bounds are used as stored.
+    Mat4 model = m_current_scene->m_nodes[draw_batch.m_node].m_global_matrix;
+    Camera* camera = &(*m_current_cameras)[plan.m_camera];
+    Frustum frustum =
+        make_meshlet_frustum(model * camera->m_view_matrix * camera->m_projection_matrix);
+    Mat4 inverse_model = model.invert();
+    Vec3 world_camera_position =
+        m_current_scene->m_nodes[plan.m_camera_node].get_global_position();
+    Vec3 camera_position;
+    for (u32 row = 0; row < 3; row++) {
+        camera_position.v[row] = inverse_model.m[12 + row];
+        for (u32 col = 0; col < 3; col++) {
+            camera_position.v[row] += inverse_model.m[col * 4 + row] * world_camera_position.v[col];
+        }
+    }
+    bool cone_culling = pass.m_enable_face_culling && pass.m_culling_mode == CullingMode::BACK &&
+                        pass.m_culling_order == CullingOrder::CCW;
+
+    // Visible meshlets that follow each other in the index buffer share one range.
+    vec<u32> counts;
+    vec<u32> first_indices;
+    for (u32 i = first_meshlet; i < first_meshlet + meshlet_count; i++) {
+        const Meshlet& meshlet = mesh->m_meshlets[i];
+        if (!meshlet_visible(meshlet, frustum, camera_position, cone_culling)) {
+            stats.m_meshlets_culled++;
+            continue;
+        }
+        stats.m_meshlets_drawn++;
+        if (!counts.empty() && first_indices.back() + counts.back() == meshlet.m_first_index) {
+            counts.back() += meshlet.m_index_count;
+        } else {
+            counts.push_back(meshlet.m_index_count);
+            first_indices.push_back(meshlet.m_first_index);
+        }
+    }
+
+    if (counts.size() == 1) {
+        command_buffer.draw_indexed(mesh->m_primitive, counts[0], first_indices[0]);
+    } else if (!counts.empty()) {
+        command_buffer.multi_draw_indexed(mesh->m_primitive, counts.data(), first_indices.data(),
+                                          u32(counts.size()));
+    }
+}
+
+void Renderer::record_uniform(CommandBuffer& command_buffer, UniformId uniform_id,
+                              const UniformValue& uniform_value) {
+    const Uniform& uniform =
+        m_uniform_buffers[uniform_id.m_uniform_buffer].m_uniforms[uniform_id.m_uniform];
+    u8 bytes[sizeof(Mat4)];
+    u32 size = std::min(uniform_value_bytes(uniform_value, bytes), uniform.m_size);
+    command_buffer.write_uniform(uniform_id.m_uniform_buffer, uniform.m_offset, bytes, size);
+}
 
-    u64 pass_cpu_time = get_timestamp_microsecond() - pass_start_cpu_time;
+void Renderer::execute(CommandBuffer& command_buffer) {
+    for (const Command& command : command_buffer.m_commands) {
+        const u32* args = command.m_args;
+        switch (command.m_type) {
+            case CommandType::SET_FRAMEBUFFER:
+                set_current_framebuffer(args[0]);
+                break;
+            case CommandType::SET_DEFAULT_FRAMEBUFFER:
+                set_default_framebuffer();
+                break;
+            case CommandType::SET_VIEWPORT:
+                set_viewport(args[0], args[1], args[2], args[3]);
+                break;
+            case CommandType::SET_DEPTH_TEST:
+                set_depth_test(args[0]);
+                break;
+            case CommandType::SET_FACE_CULLING:
+                set_face_culling(args[0], CullingMode(args[1]), CullingOrder(args[2]));
+                break;
+            case CommandType::CLEAR: {
+                f32 values[5];
+                memcopy(values, &args[1], sizeof(values));
+                clear(args[0], RGBA(values[0], values[1], values[2], values[3]), values[4]);
+            } break;
+            case CommandType::SET_SHADER:
+                set_current_shader(args[0]);
+                break;
+            case CommandType::BIND_UNIFORMS:
+                bind_uniforms((const PassBinding*)command_buffer.data(args[0]), args[1]);
+                break;
+            case CommandType::SET_MESH:
+                set_current_mesh(args[0]);
+                break;
+            case CommandType::SET_BUFFERLESS_MESH:
+                set_bufferless_mesh();
+                break;
+            case CommandType::WRITE_UNIFORM:
+                write_uniform_buffer(args[0], args[1], command_buffer.data(args[2]), args[3]);
+                break;
+            case CommandType::SET_INSTANCE_DATA:
+                set_instance_data((const Mat4*)command_buffer.data(args[0]), args[1]);
+                break;
+            case CommandType::DRAW:
+                flush_uniform_buffers();
+                draw(MeshPrimitive(args[0]), args[1]);
+                break;
+            case CommandType::DRAW_INDEXED:
+                flush_uniform_buffers();
+                draw_indexed(MeshPrimitive(args[0]), args[1], args[2]);
+                m_frame_stats.m_draw_calls++;
+                m_frame_stats.m_instances++;
+                m_frame_stats.m_indexed_vertices += args[1];
+                break;
+            case CommandType::DRAW_INDEXED_INSTANCED:
+                flush_uniform_buffers();
+                draw_indexed_instanced(MeshPrimitive(args[0]), args[1], args[2], args[3], args[4]);
+                m_frame_stats.m_draw_calls++;
+                m_frame_stats.m_instances += args[2];
+                m_frame_stats.m_indexed_vertices += u64(args[1]) * args[2];
+                break;
+            case CommandType::MULTI_DRAW_INDEXED: {
+                flush_uniform_buffers();
+                const u32* counts = (const u32*)command_buffer.data(args[1]);
+                multi_draw_indexed(MeshPrimitive(args[0]), counts,
+                                   (const u32*)command_buffer.data(args[2]), args[3]);
+                m_frame_stats.m_draw_calls++;
+                m_frame_stats.m_instances++;
+                for (u32 i = 0; i < args[3]; i++) {
+                    m_frame_stats.m_indexed_vertices += counts[i];
+                }
+            } break;
+            case CommandType::MULTI_DRAW_INDEXED_INDIRECT: {
+                flush_uniform_buffers();
+                const DrawIndirectCommand* draws =
+                    (const DrawIndirectCommand*)command_buffer.data(args[1]);
+                multi_draw_indexed_indirect(MeshPrimitive(args[0]), draws, args[2]);
+                m_frame_stats.m_draw_calls++;
+                for (u32 i = 0; i < args[2]; i++) {
+                    m_frame_stats.m_instances += draws[i].m_instance_count;
+                    m_frame_stats.m_indexed_vertices +=
+                        u64(draws[i].m_count) * draws[i].m_instance_count;
+                }
+            } break;
+            case CommandType::DISPATCH_COMPUTE:
+                flush_uniform_buffers();
+                dispatch_compute(args[0], args[1], args[2]);
+                break;
+            case CommandType::COPY_TEXTURE: {
+                const CopyTextureArgs* copy_args =
+                    (const CopyTextureArgs*)command_buffer.data(args[0]);
+                copy_texture(copy_args->m_src, copy_args->m_dst,
+                             Vec3I(copy_args->m_src_pos[0], copy_args->m_src_pos[1],
+                                   copy_args->m_src_pos[2]),
+                             Vec2I(copy_args->m_src_size[0], copy_args->m_src_size[1]),
+                             Vec3I(copy_args->m_dst_pos[0], copy_args->m_dst_pos[1],
+                                   copy_args->m_dst_pos[2]));
+            } break;
+            case CommandType::DEBUG_MARKER_START:
+                debug_marker_start((const char*)command_buffer.data(args[0]));
+                break;
+            case CommandType::DEBUG_MARKER_END:
+                debug_marker_end();
+                break;
+        }
+    }
+    m_frame_stats.m_commands_executed += u32(command_buffer.m_commands.size());
+}
+
+void Renderer::do_pass(Pass& pass) {
+    if (!pass.m_enabled) {
+        return;
+    }
+
+    PassPlan& plan = pass.m_plan;
+    if (!plan.m_compiled || plan.m_culled) {
+        return;
+    }
+
+    // A shader reload only recompiles the passes using it. The textures a pass accesses, and
+    // with them the frame graph, don't depend on the shader.
+    bool shader_changed =
+        pass.m_type != PassType::COPY &&
+        (m_shaders[plan.m_pass_shader].m_should_reload ||
+         m_shaders[plan.m_pass_shader].m_version != plan.m_pass_shader_version);
+    if (shader_changed) {
+        vec<FrameGraphAccess> texture_accesses = std::move(plan.m_texture_accesses);
+        Error err = compile_pass(pass);
+        plan.m_texture_accesses = std::move(texture_accesses);
+        if (err) {
+            logger.error(err);
+            return;
+        }
+    }
+
+    u64 pass_start_cpu_time = get_timestamp_microsecond();
+
+    Camera* camera = NULL;
+    Node* camera_node = NULL;
+    if (pass.m_type == PassType::RENDER && plan.m_camera != INVALID_INDEX) {
+        f32 framebuffer_aspect_ratio = 1.0;
+        if (pass.m_use_default_framebuffer) {
+            framebuffer_aspect_ratio = f32(m_viewport_size.width) / f32(m_viewport_size.height);
+        } else if (plan.m_framebuffer_texture != INVALID_INDEX) {
+            Window::Size size = texture_render_size(plan.m_framebuffer_texture);
+            framebuffer_aspect_ratio = f32(size.width) / f32(size.height);
+        }
+
+        camera = &(*m_current_cameras)[plan.m_camera];
+        camera->set_aspect_ratio(framebuffer_aspect_ratio);
+        camera_node = &m_current_scene->m_nodes[plan.m_camera_node];
+        camera->update_projection_matrix();
+        camera->update_view_matrix(camera_node);
+    }
+
+    if (plan.m_cacheable) {
+        if (pass_cache_hit(pass)) {
+            pass.m_cache_hits++;
+            m_frame_stats.m_pass_cache_hits++;
+            return;
+        }
+        pass.m_cache_misses++;
+        m_frame_stats.m_pass_cache_misses++;
+    }
+
+    // Visibility is decided while recording, so the commands also depend on the camera.
+    u64 scene_version = m_current_scene != NULL ? m_current_scene->m_version : 0;
+    Mat4 view_projection;
+    if (camera != NULL) {
+        view_projection = camera->m_view_matrix * camera->m_projection_matrix;
+    }
+    material_values(plan, m_material_values);
+    if (plan.m_recorded && plan.m_recorded_scene_version == scene_version &&
+        plan.m_recorded_resource_version == m_resource_version &&
+        std::memcmp(&plan.m_recorded_view_projection, &view_projection, sizeof(Mat4)) == 0 &&
+        m_material_values == plan.m_recorded_material_values) {
+        m_frame_stats.m_command_buffers_reused++;
+    } else {
+        record_pass(pass, plan.m_commands);
+        plan.m_recorded = true;
+        plan.m_recorded_scene_version = scene_version;
+        plan.m_recorded_resource_version = m_resource_version;
+        plan.m_recorded_view_projection = view_projection;
+        std::swap(plan.m_recorded_material_values, m_material_values);
+        m_frame_stats.m_command_buffers_recorded++;
+    }
+    m_frame_stats.m_draws_visible += pass.m_visible_count;
+    m_frame_stats.m_draws_culled += pass.m_culled_count;
+    m_frame_stats.m_draws_occluded += pass.m_occluded_count;
+
+    if (camera != NULL) {
+        set_uniform_buffer_data(m_projection_mat_uniform, camera->m_projection_matrix);
+        set_uniform_buffer_data(m_view_mat_uniform, camera->m_view_matrix);
+        set_uniform_buffer_data(m_camera_position_uniform, camera_node->m_position);
+    }
+
+    if (pass.m_type != PassType::COPY) {
+        set_uniform_buffer_data(m_frame_number_uniform, m_frame_number);
+    }
+
+    u64 execute_start_cpu_time = get_timestamp_microsecond();
+    m_frame_stats.m_record_time_us += execute_start_cpu_time - pass_start_cpu_time;
+
+    m_executing_pass = true;
+    execute(plan.m_commands);
+    m_executing_pass = false;
+
+    for (const FrameGraphAccess& access : plan.m_texture_accesses) {
+        if (access.m_write) {
+            m_textures[access.m_texture].m_version++;
+        }
+    }
+    if (plan.m_cacheable) {
+        store_pass_cache(pass);
+    }
+
+    m_frame_stats.m_execute_time_us += get_timestamp_microsecond() - execute_start_cpu_time;
+}
+
+// Passes with an update interval run on the frames matching their phase, so several expensive
+// passes with the same interval and different phases take turns instead of all running at once.
+bool Renderer::pass_scheduled(Pass& pass) {
+    u32 update_every = pass.m_plan.m_update_every;
+    return update_every <= 1 || m_frame_number % update_every == pass.m_phase % update_every;
+}
+
+// Texture, uniform buffer, resource and shader versions only grow, so their sum changes
+// whenever one of them does. The resource version covers material, mesh and renderable edits.
+// The per pass camera and model matrices are covered by the camera and node checks instead, and
+// passes binding the per frame u_time block are not cacheable.
+u64 Renderer::pass_input_version(Pass& pass) {
+    PassPlan& plan = pass.m_plan;
+    u64 version = m_resource_version;
+    if (plan.m_shader != INVALID_INDEX) {
+        version += m_shaders[plan.m_shader].m_version;
+    }
+    for (const FrameGraphAccess& access : plan.m_texture_accesses) {
+        version += m_textures[access.m_texture].m_version;
+    }
+    for (const PassBinding& binding : plan.m_bindings) {
+        if (binding.m_type == UniformBindingType::BLOCK &&
+            binding.m_resource != m_model_mat_uniform.m_uniform_buffer &&
+            binding.m_resource != m_camera_position_uniform.m_uniform_buffer) {
+            version += m_uniform_buffers[binding.m_resource].m_version;
+        }
+    }
+    return version;
+}
+
+// A cached pass keeps the output of its last run while its camera, the nodes it draws, the
+// textures it touches and the uniform blocks it binds are unchanged.
+bool Renderer::pass_cache_hit(Pass& pass) {
+    PassPlan& plan = pass.m_plan;
+    if (!plan.m_cache_valid || pass_input_version(pass) != plan.m_cached_input_version) {
+        return false;
+    }
+
+    if (plan.m_camera != INVALID_INDEX) {
+        Camera* camera = &(*m_current_cameras)[plan.m_camera];
+        if (std::memcmp(&camera->m_view_matrix, &plan.m_cached_view_matrix, sizeof(Mat4)) != 0 ||
+            std::memcmp(&camera->m_projection_matrix, &plan.m_cached_projection_matrix,
+                        sizeof(Mat4)) != 0) {
+            return false;
+        }
+    }
+
+    if (m_current_scene != NULL && m_current_scene->m_version != plan.m_cached_scene_version) {
+        for (const DrawItem& draw_item : plan.m_draws) {
+            if (m_current_scene->m_nodes[draw_item.m_node].m_version >
+                plan.m_cached_scene_version) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void Renderer::store_pass_cache(Pass& pass) {
+    PassPlan& plan = pass.m_plan;
+    plan.m_cache_valid = true;
+    plan.m_cached_input_version = pass_input_version(pass);
+    plan.m_cached_scene_version = m_current_scene != NULL ? m_current_scene->m_version : 0;
+    if (plan.m_camera != INVALID_INDEX) {
+        plan.m_cached_view_matrix = (*m_current_cameras)[plan.m_camera].m_view_matrix;
+        plan.m_cached_projection_matrix = (*m_current_cameras)[plan.m_camera].m_projection_matrix;
+    }
 }
 
 void Renderer::update() {
+    if (m_render_thread.joinable()) {
+        submit_frame();
+        return;
+    }
+
+    m_frame_stats = FrameStats();
+    render_frame(m_window->m_size);
+    m_last_frame_stats = m_frame_stats;
+}
+
+void Renderer::render_frame(Window::Size viewport_size) {
     u64 frame_start_cpu_time = get_timestamp_microsecond();
+    if (viewport_size.width != m_viewport_size.width ||
+        viewport_size.height != m_viewport_size.height) {
+        resize_viewport(viewport_size);
+    }
+
+    if (m_should_compile_passes) {
+        compile_passes();
+    }
+    update_bvh();
+
+    Window::Size max_size = max_render_size();
+    set_uniform_buffer_data(m_render_scale_uniform,
+                            Vec2(f32(m_render_size.width) / f32(max_size.width),
+                                 f32(m_render_size.height) / f32(max_size.height)));
+
+    begin_gpu_frame_timer();
     for (Pass& pass : m_passes) {
+        if (!pass_scheduled(pass)) {
+            m_frame_stats.m_passes_deferred++;
+            continue;
+        }
         do_pass(pass);
     }
-
-    u64 frame_cpu_time = get_timestamp_microsecond() - frame_start_cpu_time;
+    end_gpu_frame_timer();
+
+    // The governor follows the work of the frame rather than the time between frames, which
+    // with vsync includes waiting for the display whatever the render scale.
+    if (m_dynamic_resolution.m_enabled) {
+        f32 frame_cpu_time_ms = f32(get_timestamp_microsecond() - frame_start_cpu_time) / 1000.0f;
+        if (m_dynamic_resolution.update(std::max(frame_cpu_time_ms, last_gpu_frame_time_ms()))) {
+            update_render_size();
+        }
+    }
     m_frame_number++;
 
     present();
+    swap_history_textures();
+}
+
+void Renderer::resize_viewport(Window::Size viewport_size) {
+    m_viewport_size = viewport_size;
+    m_dynamic_resolution.reset();
+    for (auto& texture : m_textures) {
+        if (texture.m_resize_to_viewport) {
+            reload_texture(texture.m_name);
+        }
+    }
+    update_render_size();
+    m_should_compile_passes = true;
+}
+
+Window::Size Renderer::scaled_viewport_size(f32 scale) {
+    return Window::Size{
+        .width = std::max(u32(f32(m_viewport_size.width) * scale + 0.5f), 1u),
+        .height = std::max(u32(f32(m_viewport_size.height) * scale + 0.5f), 1u),
+    };
+}
+
+Window::Size Renderer::max_render_size() {
+    return scaled_viewport_size(m_dynamic_resolution.m_enabled ? m_dynamic_resolution.m_max_scale
+                                                               : 1.0f);
+}
+
+// Changing the render scale only moves the viewports and compute dispatches of the scaled
+// passes: the render targets keep their maximum size, and the passes are just re-recorded.
+void Renderer::update_render_size() {
+    m_render_size = scaled_viewport_size(
+        m_dynamic_resolution.m_enabled ? m_dynamic_resolution.m_scale : 1.0f);
+
+    for (vec<Pass>* passes : {&m_passes_do_once, &m_passes}) {
+        for (Pass& pass : *passes) {
+            if (pass.m_type == PassType::COMPUTE && pass.m_plan.m_compiled) {
+                evaluate_compute_work_groups(pass);
+            }
+            pass.m_plan.m_recorded = false;
+            pass.m_plan.m_cache_valid = false;
+        }
+    }
+}
+
+Error Renderer::start_render_thread() {
+#ifdef EMSCRIPTEN
+    return Error("Renderer::start_render_thread: Pipelined rendering needs threads");
+#else
+    if (m_render_thread.joinable()) {
+        return Error();
+    }
+
+    m_sim_scene = m_current_scene;
+    if (m_sim_scene != NULL) {
+        m_render_scene = *m_sim_scene;
+        for (Node& node : m_render_scene.m_nodes) {
+            node.m_scene = &m_render_scene;
+        }
+        m_current_scene = &m_render_scene;
+        m_captured_node_count = m_sim_scene->m_nodes.size();
+    }
+    m_render_cameras = m_cameras;
+    for (Camera& camera : m_render_cameras) {
+        if (camera.m_scene == m_sim_scene) {
+            camera.m_scene = &m_render_scene;
+        }
+    }
+    m_current_cameras = &m_render_cameras;
+    m_published_stats.reset();
+
+    m_snapshots.reset();
+    m_published_frames = 0;
+    m_consumed_frames = 0;
+    m_stop_render_thread = false;
+    m_pending_uniform_writes.reset();
+    m_pending_edits.clear();
+
+    release_context();
+    m_render_thread = std::thread([this]() {
+        make_context_current();
+        render_thread_loop();
+        release_context();
+    });
+    return Error();
+#endif
+}
+
+void Renderer::stop_render_thread() {
+    if (!m_render_thread.joinable()) {
+        return;
+    }
+
+    m_stop_render_thread = true;
+    m_published_frames++;
+    m_published_frames.notify_one();
+    m_render_thread.join();
+
+    make_context_current();
+    for (u32 i = 0; i < m_cameras.size() && i < m_render_cameras.size(); i++) {
+        m_cameras[i].m_aspect_ratio = m_render_cameras[i].m_aspect_ratio;
+        m_cameras[i].m_dirty_projection_matrix = true;
+        m_cameras[i].m_view_matrix = m_render_cameras[i].m_view_matrix;
+    }
+    m_current_cameras = &m_cameras;
+    if (m_sim_scene != NULL) {
+        m_current_scene = m_sim_scene;
+        m_sim_scene = NULL;
+        m_should_compile_passes = true;
+    }
+    execute(m_pending_uniform_writes);
+    m_pending_uniform_writes.reset();
+    for (auto& edit : m_pending_edits) {
+        edit();
+    }
+    m_pending_edits.clear();
+}
+
+void Renderer::render_thread_loop() {
+    u64 seen_frames = 0;
+    while (true) {
+        m_published_frames.wait(seen_frames);
+        seen_frames = m_published_frames.load();
+        bool stop = m_stop_render_thread.load();
+
+        if (m_snapshots.acquire()) {
+            FrameSnapshot* snapshot = &m_snapshots.front();
+            m_frame_stats = FrameStats();
+            apply_snapshot(snapshot);
+            m_consumed_frames++;
+            m_consumed_frames.notify_one();
+            render_frame(snapshot->m_viewport_size);
+            m_published_stats.back() = m_frame_stats;
+            m_published_stats.publish();
+        }
+
+        if (stop) {
+            return;
+        }
+    }
+}
+
+void Renderer::submit_frame() {
+    if (m_pipeline_throttle) {
+        u64 published_frames = m_published_frames.load();
+        u64 consumed_frames = m_consumed_frames.load();
+        while (consumed_frames < published_frames) {
+            m_consumed_frames.wait(consumed_frames);
+            consumed_frames = m_consumed_frames.load();
+        }
+    }
+
+    if (m_published_stats.acquire()) {
+        m_last_frame_stats = m_published_stats.front();
+    }
+
+    capture_snapshot(&m_snapshots.back(), m_snapshots.back_unread());
+    m_snapshots.publish();
+    m_published_frames++;
+    m_published_frames.notify_one();
+}
+
+void Renderer::capture_snapshot(FrameSnapshot* snapshot, bool merge) {
+    snapshot->m_viewport_size = m_window->m_size;
+
+    if (merge) {
+        snapshot->m_uniform_writes.append(m_pending_uniform_writes);
+        std::move(m_pending_edits.begin(), m_pending_edits.end(),
+                  std::back_inserter(snapshot->m_edits));
+    } else {
+        std::swap(snapshot->m_uniform_writes, m_pending_uniform_writes);
+        std::swap(snapshot->m_edits, m_pending_edits);
+        snapshot->m_scene_structure_changed = false;
+    }
+    m_pending_uniform_writes.reset();
+    m_pending_edits.clear();
+
+    snapshot->m_cameras.resize(m_cameras.size());
+    for (u32 i = 0; i < m_cameras.size(); i++) {
+        const Camera& camera = m_cameras[i];
+        snapshot->m_cameras[i] = CameraSnapshot{
+            .m_fov = camera.m_fov,
+            .m_z_near = camera.m_z_near,
+            .m_z_far = camera.m_z_far,
+            .m_keep_screen_aspect_ratio = camera.m_keep_screen_aspect_ratio,
+            .m_left = camera.m_left,
+            .m_right = camera.m_right,
+            .m_bottom = camera.m_bottom,
+            .m_top = camera.m_top,
+            .m_projection = camera.m_projection,
+        };
+    }
+
+    if (m_sim_scene == NULL) {
+        return;
+    }
+
+    ArrayMap<Node>& nodes = m_sim_scene->m_nodes;
+    if (nodes.size() != m_captured_node_count) {
+        snapshot->m_scene = *m_sim_scene;
+        snapshot->m_scene_structure_changed = true;
+        m_captured_node_count = nodes.size();
+    }
+    snapshot->m_scene_version = m_sim_scene->m_version;
+
+    if (!merge || snapshot->m_nodes.size() != nodes.size()) {
+        snapshot->m_nodes.assign(nodes.size(), NodeSnapshot{.m_was_dirty = false});
+    }
+    for (u32 i = 0; i < nodes.size(); i++) {
+        Node& node = nodes[i];
+        NodeSnapshot& node_snapshot = snapshot->m_nodes[i];
+        node_snapshot.m_global_matrix = node.m_global_matrix;
+        node_snapshot.m_position = node.m_position;
+        node_snapshot.m_was_dirty |= node.m_was_dirty;
+        node.m_was_dirty = false;
+        node.m_in_dirty_list = false;
+    }
+    m_sim_scene->m_dirty_nodes.clear();
+}
+
+void Renderer::apply_snapshot(FrameSnapshot* snapshot) {
+    if (snapshot->m_scene_structure_changed) {
+        m_render_scene = std::move(snapshot->m_scene);
+        for (Node& node : m_render_scene.m_nodes) {
+            node.m_scene = &m_render_scene;
+        }
+        m_should_compile_passes = true;
+    }
+
+    if (m_sim_scene != NULL) {
+        m_render_scene.m_version = snapshot->m_scene_version;
+        ArrayMap<Node>& nodes = m_render_scene.m_nodes;
+        u32 node_count = u32(std::min(nodes.size(), snapshot->m_nodes.size()));
+        for (u32 i = 0; i < node_count; i++) {
+            Node& node = nodes[i];
+            const NodeSnapshot& node_snapshot = snapshot->m_nodes[i];
+            node.m_global_matrix = node_snapshot.m_global_matrix;
+            node.m_position = node_snapshot.m_position;
+            node.m_was_dirty |= node_snapshot.m_was_dirty;
+            if (node_snapshot.m_was_dirty) {
+                node.m_version = snapshot->m_scene_version;
+                if (!node.m_in_dirty_list) {
+                    node.m_in_dirty_list = true;
+                    m_render_scene.m_dirty_nodes.push_back(i);
+                }
+            }
+        }
+    }
+
+    u32 camera_count = u32(std::min(m_render_cameras.size(), snapshot->m_cameras.size()));
+    for (u32 i = 0; i < camera_count; i++) {
+        Camera& camera = m_render_cameras[i];
+        const CameraSnapshot& camera_snapshot = snapshot->m_cameras[i];
+        camera.m_fov = camera_snapshot.m_fov;
+        camera.m_z_near = camera_snapshot.m_z_near;
+        camera.m_z_far = camera_snapshot.m_z_far;
+        camera.m_keep_screen_aspect_ratio = camera_snapshot.m_keep_screen_aspect_ratio;
+        camera.m_left = camera_snapshot.m_left;
+        camera.m_right = camera_snapshot.m_right;
+        camera.m_bottom = camera_snapshot.m_bottom;
+        camera.m_top = camera_snapshot.m_top;
+        camera.m_projection = camera_snapshot.m_projection;
+        camera.m_dirty_projection_matrix = true;
+    }
+
+    for (auto& edit : snapshot->m_edits) {
+        edit();
+    }
+    snapshot->m_edits.clear();
+    execute(snapshot->m_uniform_writes);
+}
+
+// Runs the edit right away, or on the render thread before its next frame when called from
+// another thread while pipelining.
+void Renderer::edit_resources(std::function<void()> edit) {
+    if (m_render_thread.joinable() && std::this_thread::get_id() != m_render_thread.get_id()) {
+        m_pending_edits.push_back(std::move(edit));
+        return;
+    }
+    edit();
 }
 
 Error Renderer::create_uniform_buffer(UniformBuffer uniform_buffer) {
     u32 aligned_offset = 0;
     u32 total_size = 0;
-    for (u32 i = 0; i < uniform_buffer.m_uniforms.size(); i++) {
-        Uniform& uniform = uniform_buffer.m_uniforms[i];
-        uniform_buffer.m_uniforms_ids[uniform.m_name] = i;
-        uniform.m_size = UniformTypeSize[uniform.m_type];
+    for (Uniform& uniform : uniform_buffer.m_uniforms) {
+        uniform.m_size = uniform_type_size(uniform.m_type);
 
-        u32 alignment = UniformTypeAlignment[uniform.m_type];
+        u32 alignment = uniform_type_alignment(uniform.m_type);
         aligned_offset = (aligned_offset + alignment - 1) & ~(alignment - 1);
         uniform.m_offset = aligned_offset;
         aligned_offset += uniform.m_size;
         total_size = aligned_offset;
     }
     uniform_buffer.m_size = total_size;
+    return add_uniform_buffer(uniform_buffer);
+}
+
+Error Renderer::add_uniform_buffer(UniformBuffer uniform_buffer) {
+    for (u32 i = 0; i < uniform_buffer.m_uniforms.size(); i++) {
+        uniform_buffer.m_uniforms_ids[uniform_buffer.m_uniforms[i].m_name] = i;
+    }
+    uniform_buffer.m_data.assign(uniform_buffer.m_size, 0);
+    uniform_buffer.m_dirty_begin = 0;
+    uniform_buffer.m_dirty_end = uniform_buffer.m_size;
 
-    m_uniform_buffers.add(uniform_buffer);
+    u32 uniform_buffer_index = m_uniform_buffers.add(uniform_buffer);
+    m_dirty_uniform_buffers.push_back(uniform_buffer_index);
+    m_should_compile_passes = true;
     return create_uniform_buffer_api(uniform_buffer.m_name);
 }
 
+Error Renderer::set_uniform_buffer_data(UniformId uniform_id, const UniformValue& uniform_value) {
+    const Uniform& uniform =
+        m_uniform_buffers[uniform_id.m_uniform_buffer].m_uniforms[uniform_id.m_uniform];
+    u8 bytes[sizeof(Mat4)];
+    u32 size = std::min(uniform_value_bytes(uniform_value, bytes), uniform.m_size);
+    write_uniform_buffer(uniform_id.m_uniform_buffer, uniform.m_offset, bytes, size);
+    return Error();
+}
+
+Error Renderer::set_uniform_buffer_block(u32 uniform_buffer_index, const void* data, u32 size) {
+    write_uniform_buffer(uniform_buffer_index, 0, data, size);
+    return Error();
+}
+
+void Renderer::write_uniform_buffer(u32 uniform_buffer_index, u32 offset, const void* data,
+                                    u32 size) {
+    if (m_render_thread.joinable() && std::this_thread::get_id() != m_render_thread.get_id()) {
+        m_pending_uniform_writes.write_uniform(uniform_buffer_index, offset, data, size);
+        return;
+    }
+
+    UniformBuffer* uniform_buffer = &m_uniform_buffers[uniform_buffer_index];
+
+    m_frame_stats.m_uniform_writes++;
+    u8* staging = uniform_buffer->m_data.data() + offset;
+    if (std::memcmp(staging, data, size) == 0) {
+        m_frame_stats.m_uniform_writes_skipped++;
+        return;
+    }
+    memcopy(staging, data, size);
+    if (!m_executing_pass) {
+        uniform_buffer->m_version++;
+    }
+
+    if (uniform_buffer->m_dirty_begin >= uniform_buffer->m_dirty_end) {
+        m_dirty_uniform_buffers.push_back(uniform_buffer_index);
+    }
+    uniform_buffer->m_dirty_begin = std::min(uniform_buffer->m_dirty_begin, offset);
+    uniform_buffer->m_dirty_end = std::max(uniform_buffer->m_dirty_end, offset + size);
+}
+
+void Renderer::flush_uniform_buffers() {
+    for (u32 uniform_buffer_index : m_dirty_uniform_buffers) {
+        UniformBuffer* uniform_buffer = &m_uniform_buffers[uniform_buffer_index];
+        if (uniform_buffer->m_dirty_begin >= uniform_buffer->m_dirty_end) {
+            continue;
+        }
+
+        flush_uniform_buffer_api(uniform_buffer_index);
+
+        m_frame_stats.m_uniform_buffer_uploads++;
+        m_frame_stats.m_uniform_bytes_uploaded +=
+            uniform_buffer->m_dirty_end - uniform_buffer->m_dirty_begin;
+        uniform_buffer->m_dirty_begin = UINT32_MAX;
+        uniform_buffer->m_dirty_end = 0;
+    }
+    m_dirty_uniform_buffers.clear();
+}
+
+opt<UniformId> Renderer::find_uniform(const str& uniform_buffer_id, const str& uniform_name) {
+    if (!m_uniform_buffers.contains(uniform_buffer_id)) {
+        return std::nullopt;
+    }
+    u32 uniform_buffer_index = m_uniform_buffers.index_of(uniform_buffer_id);
+    UniformBuffer* uniform_buffer = &m_uniform_buffers[uniform_buffer_index];
+    auto uniform = uniform_buffer->m_uniforms_ids.find(uniform_name);
+    if (uniform == uniform_buffer->m_uniforms_ids.end()) {
+        return std::nullopt;
+    }
+    return UniformId{.m_uniform_buffer = uniform_buffer_index, .m_uniform = uniform->second};
+}
+
+Error Renderer::set_uniform_buffer_data(str uniform_buffer_id,
+                                        vec<pair<str, UniformValue>> uniform_values) {
+    for (auto& uniform_value : uniform_values) {
+        opt<UniformId> uniform_id = find_uniform(uniform_buffer_id, uniform_value.first);
+        if (!uniform_id) {
+            return Error("Renderer::set_uniform_buffer_data: Uniform \"" + uniform_buffer_id +
+                         "." + uniform_value.first + "\" not found");
+        }
+        set_uniform_buffer_data(uniform_id.value(), uniform_value.second);
+    }
+    return Error();
+}
+
 void Renderer::create_renderable(Renderable renderable) {
     m_renderables.push_back(renderable);
     u32 id = u32(m_renderables.size()) - 1;
     for (auto& tag : renderable.m_tags) {
         m_tagged_renderables[tag].push_back(id);
     }
+    m_should_compile_passes = true;
+}
+
+void Renderer::set_renderable_mesh(u32 renderable_index, str mesh_id) {
+    edit_resources([this, renderable_index, mesh_id]() {
+        m_renderables[renderable_index].m_mesh = mesh_id;
+        m_should_compile_passes = true;
+        m_resource_version++;
+    });
+}
+
+void Renderer::build_static_batches() {
+    if (!m_static_batching || m_current_scene == NULL) {
+        return;
+    }
+
+    // Renderables are grouped by a key made of their material index and the indices of their tag
+    // list and vertex layout among those seen so far.
+    vec<vec<str>> tag_lists;
+    vec<vec<pair<str, u32>>> layouts;
+    RenderQueue groups;
+    u32 renderable_count = u32(m_renderables.size());
+    for (u32 i = 0; i < renderable_count; i++) {
+        const Renderable& renderable = m_renderables[i];
+        if (!renderable.m_static || renderable.m_static_batch != INVALID_INDEX ||
+            !m_meshes.contains(renderable.m_mesh) ||
+            !m_current_scene->m_nodes.contains(renderable.m_node)) {
+            continue;
+        }
+        Mesh* mesh = &m_meshes[renderable.m_mesh];
+        if (mesh_vertices(mesh).empty() && mesh->m_path != "") {
+            Error err = load_mesh_from_file(mesh);
+            if (err) {
+                logger.error(err);
+                continue;
+            }
+        }
+        u32 stride;
+        u32 position_offset;
+        if (mesh->m_primitive != MeshPrimitive::TRIANGLES ||
+            !mesh_position_layout(mesh, &stride, &position_offset)) {
+            continue;
+        }
+
+        u32 material = m_materials.contains(renderable.m_material)
+                           ? m_materials.index_of(renderable.m_material)
+                           : INVALID_INDEX;
+        u32 tag_list = u32(std::find(tag_lists.begin(), tag_lists.end(), renderable.m_tags) -
+                           tag_lists.begin());
+        if (tag_list == tag_lists.size()) {
+            tag_lists.push_back(renderable.m_tags);
+        }
+        u32 layout =
+            u32(std::find(layouts.begin(), layouts.end(), mesh->m_attribs) - layouts.begin());
+        if (layout == layouts.size()) {
+            layouts.push_back(mesh->m_attribs);
+        }
+        groups.push((u64(material) << 32) | (u64(tag_list) << 16) | layout, i);
+    }
+    groups.sort();
+
+    // Parts are baked relative to the root node the batches are attached to, so a transformed
+    // root is applied once, and moves the batches along with the parts.
+    Node* root = &m_current_scene->m_nodes[0];
+    Mat4 inverse_root = root->m_global_matrix;
+    inverse_root = inverse_root.invert();
+
+    u32 merged_count = 0;
+    for (u32 group_begin = 0; group_begin < groups.size();) {
+        u32 group_end = group_begin + 1;
+        while (group_end < groups.size() &&
+               groups.m_keys[group_end] == groups.m_keys[group_begin]) {
+            group_end++;
+        }
+        const Renderable first = m_renderables[groups[group_begin]];
+        Mesh batch;
+        vec<u32> parts;
+        auto flush = [&]() {
+            if (parts.empty()) {
+                return;
+            }
+            str name = "static_batch_" + std::to_string(m_static_batch_count++);
+            batch.m_name = name + "_mesh";
+            compute_mesh_bounds(&batch);
+            create_mesh(batch);
+            for (u32 part : parts) {
+                m_renderables[part].m_static_batch = u32(m_renderables.size());
+            }
+            create_renderable(Renderable{
+                .m_name = name,
+                .m_tags = first.m_tags,
+                .m_material = first.m_material,
+                .m_mesh = batch.m_name,
+                .m_node = root->m_name,
+            });
+            merged_count += u32(parts.size());
+            parts.clear();
+        };
+
+        u32 batch_vertex_count = 0;
+        for (u32 i = group_begin; i < group_end; i++) {
+            u32 id = groups[i];
+            const Mesh* mesh = &m_meshes[m_renderables[id].m_mesh];
+            u32 stride;
+            u32 position_offset;
+            mesh_position_layout(mesh, &stride, &position_offset);
+            u32 vertex_count = u32(mesh_vertices(mesh).size() / stride);
+            if (!parts.empty() && batch_vertex_count + vertex_count > STATIC_BATCH_MAX_VERTICES) {
+                flush();
+                // Creating the batch mesh and renderable may have moved the others.
+                mesh = &m_meshes[m_renderables[id].m_mesh];
+            }
+            if (parts.empty()) {
+                batch = Mesh{.m_attribs = mesh->m_attribs};
+                batch_vertex_count = 0;
+            }
+            batch_vertex_count += vertex_count;
+            append_static_part(
+                &batch, mesh,
+                m_current_scene->m_nodes[m_renderables[id].m_node].m_global_matrix * inverse_root);
+            parts.push_back(id);
+        }
+        flush();
+        group_begin = group_end;
+    }
+
+    logger.info("Static batching: ", merged_count, " renderables merged into ",
+                m_static_batch_count, " batches");
 }
 
 void Renderer::create_material(Material material) {
     m_materials.add(material);
+    m_should_compile_passes = true;
+}
+
+void Renderer::set_material_uniform(str material_id, str uniform_buffer_id, str uniform_name,
+                                    UniformValue value) {
+    edit_resources([this, material_id, uniform_buffer_id, uniform_name, value]() {
+        auto& uniforms = m_materials[material_id].m_uniforms[uniform_buffer_id];
+        if (!uniforms.contains(uniform_name)) {
+            m_should_compile_passes = true;
+        }
+        uniforms[uniform_name] = value;
+        m_resource_version++;
+    });
 }
 
 Error Renderer::create_shader(Shader shader) {
     m_shaders.add(shader);
+    m_should_compile_passes = true;
     return create_shader_api(shader.m_name);
 }
 
+void Renderer::set_current_shader(str shader_id) {
+    set_current_shader(m_shaders.index_of(shader_id));
+}
+
+void Renderer::set_current_mesh(str mesh_id) {
+    set_current_mesh(m_meshes.index_of(mesh_id));
+}
+
+void Renderer::set_current_framebuffer(str framebuffer_id) {
+    set_current_framebuffer(m_framebuffers.index_of(framebuffer_id));
+}
+
+void Renderer::copy_texture(str src, str dst, Vec3I src_pos, Vec2I src_size, Vec3I dst_pos) {
+    copy_texture(m_textures.index_of(src), m_textures.index_of(dst), src_pos, src_size, dst_pos);
+}
+
 Error Renderer::reload_shader(str shader_id) {
     Shader* shader = &m_shaders[shader_id];
 
@@ -328,6 +1944,7 @@ Error Renderer::reload_shader(str shader_id) {
     }
 
     shader->m_should_reload = false;
+    shader->m_version++;
 
     Error err2 = reload_shader_api(shader_id);
     if (err2) {
@@ -341,18 +1958,117 @@ Error Renderer::reload_shader(str shader_id) {
 
 Error Renderer::create_texture(Texture texture) {
     if (texture.m_resize_to_viewport) {
-        texture.m_width = m_window->m_size.width;
-        texture.m_height = m_window->m_size.height;
+        resize_texture_to_viewport(&texture);
     }
     m_textures.add(texture);
-    return create_texture_api(texture.m_name);
+    m_should_compile_passes = true;
+    Error err = create_texture_api(texture.m_name);
+    if (err) {
+        return err;
+    }
+
+    if (texture.m_history_texture != "" && !m_textures.contains(texture.m_history_texture)) {
+        Texture history_texture = texture;
+        history_texture.m_name = texture.m_history_texture;
+        history_texture.m_history_texture = "";
+        return create_texture(history_texture);
+    }
+    return Error();
+}
+
+void Renderer::resolve_history_textures() {
+    for (auto& history_framebuffer : m_history_framebuffers) {
+        if (history_framebuffer.second == NULL) {
+            continue;
+        }
+        Framebuffer* framebuffer = &m_framebuffers[history_framebuffer.first];
+        std::swap(framebuffer->m_api_data, history_framebuffer.second);
+        Error err = destroy_framebuffer_api(history_framebuffer.first);
+        if (err) {
+            logger.error(err);
+        }
+        framebuffer->m_api_data = history_framebuffer.second;
+    }
+    m_history_textures.clear();
+    m_history_framebuffers.clear();
+    for (u32 i = 0; i < m_textures.size(); i++) {
+        const str& history_texture = m_textures[i].m_history_texture;
+        if (history_texture == "") {
+            continue;
+        }
+        if (!m_textures.contains(history_texture)) {
+            logger.error("Renderer::resolve_history_textures: History texture \"" +
+                         history_texture + "\" of \"" + m_textures[i].m_name + "\" not found");
+            continue;
+        }
+        m_history_textures.push_back(std::make_pair(i, m_textures.index_of(history_texture)));
+    }
+
+    for (u32 i = 0; i < m_framebuffers.size(); i++) {
+        Framebuffer* framebuffer = &m_framebuffers[i];
+        for (auto& history_pair : m_history_textures) {
+            for (u32 texture_index : {history_pair.first, history_pair.second}) {
+                const str& texture_name = m_textures[texture_index].m_name;
+                if (framebuffer->m_color_attachment_texture == texture_name ||
+                    framebuffer->m_depth_attachment_texture == texture_name ||
+                    framebuffer->m_stencil_attachment_texture == texture_name) {
+                    if (m_history_framebuffers.empty() ||
+                        m_history_framebuffers.back().first != i) {
+                        m_history_framebuffers.push_back(std::make_pair(i, (void*)NULL));
+                    }
+                }
+            }
+        }
+    }
+}
+
+// The twins are attached while the textures of each history pair are exchanged, as they will
+// be every other frame.
+void Renderer::create_history_framebuffers() {
+    for (auto& history_pair : m_history_textures) {
+        std::swap(m_textures[history_pair.first].m_api_data,
+                  m_textures[history_pair.second].m_api_data);
+    }
+    for (auto& history_framebuffer : m_history_framebuffers) {
+        Framebuffer* framebuffer = &m_framebuffers[history_framebuffer.first];
+        void* api_data = framebuffer->m_api_data;
+        Error err = create_framebuffer_api(framebuffer->m_name);
+        if (!err) {
+            err = attach_texture_to_framebuffer(framebuffer->m_name);
+        }
+        if (err) {
+            logger.error(err);
+        }
+        history_framebuffer.second = framebuffer->m_api_data;
+        framebuffer->m_api_data = api_data;
+    }
+    for (auto& history_pair : m_history_textures) {
+        std::swap(m_textures[history_pair.first].m_api_data,
+                  m_textures[history_pair.second].m_api_data);
+    }
+}
+
+// Exchanges the API textures of each current/history pair so that what was rendered this frame
+// is read as history next frame, without copying it. The framebuffers attached to them are
+// exchanged with their twins, so nothing is attached again.
+void Renderer::swap_history_textures() {
+    for (auto& history_pair : m_history_textures) {
+        std::swap(m_textures[history_pair.first].m_api_data,
+                  m_textures[history_pair.second].m_api_data);
+        m_textures[history_pair.first].m_version++;
+        m_textures[history_pair.second].m_version++;
+    }
+    for (auto& history_framebuffer : m_history_framebuffers) {
+        std::swap(m_framebuffers[history_framebuffer.first].m_api_data,
+                  history_framebuffer.second);
+    }
 }
 
 Error Renderer::reload_texture(str texture_id) {
     Texture* texture = &m_textures[texture_id];
+    texture->m_version++;
     if (texture->m_resize_to_viewport) {
-        texture->m_width = m_window->m_size.width;
-        texture->m_height = m_window->m_size.height;
+        resize_texture_to_viewport(texture);
     }
 
     if (texture->m_path != "") {
@@ -367,29 +2083,74 @@ Error Renderer::reload_texture(str texture_id) {
 }
 
 Error Renderer::create_mesh(Mesh mesh) {
+    if (!mesh.m_has_bounds) {
+        compute_mesh_bounds(&mesh);
+    }
     m_meshes.add(mesh);
+    m_should_compile_passes = true;
     return create_mesh_api(mesh.m_name);
 }
 
 Error Renderer::reload_mesh(str mesh_id) {
+    m_resource_version++;
     if (m_meshes[mesh_id].m_path != "") {
         Error err = load_mesh_from_file(&m_meshes[mesh_id]);
         if (err) {
             return err;
         }
-        return reload_mesh_api(mesh_id);
+    } else {
+        m_meshes[mesh_id].m_should_reload = false;
+    }
+    if (m_mesh_pooling) {
+        allocate_mesh_pool_range(&m_meshes[mesh_id]);
     }
-    m_meshes[mesh_id].m_should_reload = false;
     return reload_mesh_api(mesh_id);
 }
 
+void Renderer::allocate_mesh_pool_range(Mesh* mesh) {
+    u32 stride = 0;
+    for (const auto& attrib : mesh->m_attribs) {
+        stride += attrib.second;
+    }
+    if (stride == 0) {
+        return;
+    }
+
+    u32 vertex_count = u32(mesh_vertices(mesh).size() / stride);
+    u32 index_count = u32(mesh_indices(mesh).size());
+    if (mesh->m_pool != INVALID_INDEX && m_mesh_pools[mesh->m_pool].m_attribs == mesh->m_attribs &&
+        vertex_count <= mesh->m_pool_vertex_capacity &&
+        index_count <= mesh->m_pool_index_capacity) {
+        return;
+    }
+
+    u32 pool = 0;
+    while (pool < m_mesh_pools.size() && m_mesh_pools[pool].m_attribs != mesh->m_attribs) {
+        pool++;
+    }
+    if (pool == m_mesh_pools.size()) {
+        m_mesh_pools.push_back(MeshPool{.m_attribs = mesh->m_attribs});
+    }
+
+    MeshPool* mesh_pool = &m_mesh_pools[pool];
+    mesh->m_pool = pool;
+    mesh->m_pool_base_vertex = mesh_pool->m_vertex_count;
+    mesh->m_pool_first_index = mesh_pool->m_index_count;
+    mesh->m_pool_vertex_capacity = vertex_count;
+    mesh->m_pool_index_capacity = index_count;
+    mesh_pool->m_vertex_count += vertex_count;
+    mesh_pool->m_index_count += index_count;
+}
+
 Error Renderer::create_camera(Camera camera) {
     m_cameras.add(camera);
+    m_should_compile_passes = true;
     return Error();
 }
 
 Error Renderer::create_framebuffer(Framebuffer framebuffer) {
     m_framebuffers.add(framebuffer);
+    m_should_compile_passes = true;
     Error err = create_framebuffer_api(framebuffer.m_name);
     if (err) {
         return err;
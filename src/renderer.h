@@ -1,15 +1,34 @@
 #pragma once
 
+#include <cstddef>
+#include <type_traits>
+
+#include "bvh.h"
 #include "camera.h"
 #include "color.h"
+#include "command_buffer.h"
+#include "culling.h"
+#include "dynamic_resolution.h"
 #include "error.h"
+#include "expression.h"
+#include "filesystem.h"
+#include "frame_graph.h"
 #include "mesh.h"
+#include "meshlet.h"
+#include "occlusion.h"
 #include "platform.h"
+#include "render_queue.h"
 #include "texture.h"
+#include "thread_pool.h"
+#include "triple_buffer.h"
 #include "types.h"
 
 namespace blaz {
 
+const u32 INVALID_INDEX = UINT32_MAX;
+const u32 INSTANCE_MODEL_MAT_ATTRIB_LOCATION = 12;
+const u32 PARALLEL_RECORD_CHUNK_SIZE = 1024;
+
 enum Clear {
     NONE = 0,
     COLOR = 1 << 0,
@@ -80,6 +99,31 @@ static std::unordered_map<str, TextureFormat> TextureFormatStr = {
     {"DEPTH32F", TextureFormat::DEPTH32F},
 };
 
+constexpr u32 texture_format_size(TextureFormat format) {
+    switch (format) {
+        case TextureFormat::R8:
+            return 1;
+        case TextureFormat::RG8:
+            return 2;
+        case TextureFormat::RGB8:
+            return 3;
+        case TextureFormat::RGBA8:
+        case TextureFormat::R32F:
+        case TextureFormat::DEPTH32:
+        case TextureFormat::DEPTH32F:
+            return 4;
+        case TextureFormat::RGB16F:
+            return 6;
+        case TextureFormat::RG32F:
+            return 8;
+        case TextureFormat::RGB32F:
+            return 12;
+        case TextureFormat::RGBA32F:
+            return 16;
+    }
+    return 4;
+}
+
 enum class TextureTarget {
     TEXTURE_2D,
     TEXTURE_CUBE_MAP,
@@ -123,15 +167,76 @@ enum UniformType {
     UNIFORM_INT,
 };
 
-static std::unordered_map<UniformType, u32> UniformTypeAlignment = {
-    {UNIFORM_MAT4, 16}, {UNIFORM_VEC4, 16}, {UNIFORM_VEC3, 16}, {UNIFORM_VEC2, 8},
-    {UNIFORM_FLOAT, 4}, {UNIFORM_BOOL, 4},  {UNIFORM_UINT, 4},  {UNIFORM_INT, 4},
+constexpr u32 uniform_type_alignment(UniformType type) {
+    switch (type) {
+        case UNIFORM_MAT4:
+        case UNIFORM_VEC4:
+        case UNIFORM_VEC3:
+            return 16;
+        case UNIFORM_VEC2:
+            return 8;
+        default:
+            return 4;
+    }
+}
+
+constexpr u32 uniform_type_size(UniformType type) {
+    switch (type) {
+        case UNIFORM_MAT4:
+            return 64;
+        case UNIFORM_VEC4:
+            return 16;
+        case UNIFORM_VEC3:
+            return 12;
+        case UNIFORM_VEC2:
+            return 8;
+        default:
+            return 4;
+    }
+}
+
+// A uniform block struct declares `static constexpr const char* NAME` and a
+// `static constexpr auto uniforms()` returning an array of UNIFORM_FIELD entries.
+struct UniformField {
+    const char* m_name;
+    UniformType m_type;
+    u32 m_offset;
+    u32 m_size;
 };
 
-static std::unordered_map<UniformType, u32> UniformTypeSize = {
-    {UNIFORM_MAT4, 64}, {UNIFORM_VEC4, 16}, {UNIFORM_VEC3, 12}, {UNIFORM_VEC2, 8},
-    {UNIFORM_FLOAT, 4}, {UNIFORM_BOOL, 4},  {UNIFORM_UINT, 4},  {UNIFORM_INT, 4},
-};
+#define UNIFORM_FIELD(block, name, member, type) \
+    UniformField { name, type, u32(offsetof(block, member)), u32(sizeof(block::member)) }
+
+template <typename T>
+constexpr bool has_std140_offsets() {
+    u32 offset = 0;
+    for (const UniformField& field : T::uniforms()) {
+        u32 alignment = uniform_type_alignment(field.m_type);
+        offset = (offset + alignment - 1) & ~(alignment - 1);
+        if (field.m_offset != offset || field.m_size != uniform_type_size(field.m_type)) {
+            return false;
+        }
+        offset += field.m_size;
+    }
+    return true;
+}
+
+template <typename T>
+constexpr u32 std140_block_size() {
+    u32 size = 0;
+    for (const UniformField& field : T::uniforms()) {
+        size = field.m_offset + field.m_size;
+    }
+    return (size + 15) & ~15u;
+}
+
+inline u32 next_uniform_block_id = 0;
+
+template <typename T>
+u32 uniform_block_id() {
+    static u32 id = next_uniform_block_id++;
+    return id;
+}
 
 struct TextureParams {
     TextureFormat m_format = TextureFormat::RGBA8;
@@ -170,8 +275,10 @@ struct Shader {
     str m_compute_shader_path;
     bool m_is_error = false;
     std::unordered_map<str, UniformBinding> m_uniform_bindings;
+    bool m_instanced = false;
     void* m_api_data = NULL;
     bool m_should_reload = true;
+    u64 m_version = 0;
 };
 
 struct Uniform {
@@ -181,26 +288,74 @@ struct Uniform {
     u32 m_size;
 };
 
+struct UniformId {
+    u32 m_uniform_buffer = INVALID_INDEX;
+    u32 m_uniform = INVALID_INDEX;
+};
+
 struct UniformBuffer {
     str m_name;
     u32 m_size;
     vec<Uniform> m_uniforms;
     std::unordered_map<str, u32> m_uniforms_ids;
+    vec<u8> m_data;
+    u32 m_dirty_begin = UINT32_MAX;
+    u32 m_dirty_end = 0;
+    u64 m_version = 0;
     void* m_api_data = NULL;
     bool m_should_reload = true;
 };
 
+// Index range of a detail level within Mesh::m_indices, and of its meshlets within
+// Mesh::m_meshlets. m_error is the largest distance, in mesh units, between the level and the
+// full mesh.
+struct MeshLod {
+    u32 m_first_index = 0;
+    u32 m_index_count = 0;
+    f32 m_error = 0;
+    u32 m_first_meshlet = 0;
+    u32 m_meshlet_count = 0;
+};
+
 struct Mesh {
     str m_name;
     str m_path;
     vec<f32> m_vertices;
     vec<u32> m_indices;
     vec<pair<str, u32>> m_attribs;
+    // Empty when the mesh has a single level made of all its indices.
+    vec<MeshLod> m_lods;
+    // Empty when the mesh was not split into meshlets. Without levels, they cover all indices.
+    vec<Meshlet> m_meshlets;
     MeshPrimitive m_primitive = MeshPrimitive::TRIANGLES;
+    Vec3 m_aabb_min = Vec3(0, 0, 0);
+    Vec3 m_aabb_max = Vec3(0, 0, 0);
+    Vec3 m_bounding_sphere_center = Vec3(0, 0, 0);
+    f32 m_bounding_sphere_radius = 0;
+    bool m_has_bounds = false;
+    // Loaded from a mesh file, m_vertices and m_indices stay empty and these point into m_file.
+    MappedFile m_file;
+    span<const f32> m_mapped_vertices;
+    span<const u32> m_mapped_indices;
+    // With mesh pooling, the vertices and indices reserved for the mesh in m_mesh_pools[m_pool].
+    u32 m_pool = INVALID_INDEX;
+    u32 m_pool_base_vertex = 0;
+    u32 m_pool_first_index = 0;
+    u32 m_pool_vertex_capacity = 0;
+    u32 m_pool_index_capacity = 0;
     void* m_api_data = NULL;
     bool m_should_reload = true;
 };
 
+// Shared vertex and index buffers for all the meshes with the same vertex attributes. Ranges
+// are only appended, a mesh that outgrows its range on reload moves to the end.
+struct MeshPool {
+    vec<pair<str, u32>> m_attribs;
+    u32 m_vertex_count = 0;
+    u32 m_index_count = 0;
+    void* m_api_data = NULL;
+};
+
 struct Texture {
     str m_name;
     str m_path;
@@ -215,6 +370,11 @@ struct Texture {
     void* m_api_data = NULL;
     bool m_should_reload = true;
     bool m_resize_to_viewport = false;
+    Expression m_width_expression;
+    Expression m_height_expression;
+    u32 m_alias = INVALID_INDEX;
+    str m_history_texture;
+    u64 m_version = 0;
 };
 
 struct Renderable {
@@ -223,6 +383,12 @@ struct Renderable {
     str m_material;
     str m_mesh;
     str m_node;
+    // Mesh drawn into the occlusion buffer when tagged OCCLUDER_TAG, m_mesh when empty.
+    str m_occluder_mesh;
+    // A static renderable never moves. Once merged into the renderable m_static_batch, it is
+    // no longer drawn itself.
+    bool m_static = false;
+    u32 m_static_batch = INVALID_INDEX;
 };
 
 enum class PassType { RENDER, COPY, COMPUTE };
@@ -233,7 +399,7 @@ static std::unordered_map<str, PassType> PassTypeStr = {
     {"COMPUTE", PassType::COMPUTE},
 };
 
-using IntOrStr = std::variant<u32, str>;
+using IntOrExpression = std::variant<u32, Expression>;
 
 enum class AccessType { READ_ONLY, WRITE_ONLY, READ_WRITE };
 
@@ -243,6 +409,71 @@ static std::unordered_map<str, AccessType> AccessTypeStr = {
     {"READ_WRITE", AccessType::READ_WRITE},
 };
 
+struct DrawItem {
+    u32 m_mesh;
+    u32 m_material = INVALID_INDEX;
+    u32 m_node;
+    u32 m_renderable;
+    u32 m_lod = 0;
+};
+
+struct DrawBatch {
+    u32 m_mesh;
+    u32 m_material;
+    u32 m_node;
+    u32 m_lod;
+    u32 m_first_instance;
+    u32 m_instance_count;
+};
+
+struct PassBinding {
+    UniformBindingType m_type;
+    u32 m_binding_point;
+    u32 m_resource;
+    AccessType m_access = AccessType::READ_ONLY;
+};
+
+struct PassPlan {
+    bool m_compiled = false;
+    bool m_culled = false;
+    u32 m_pass_shader = INVALID_INDEX;
+    u64 m_pass_shader_version = 0;
+    u32 m_shader = INVALID_INDEX;
+    u32 m_framebuffer = INVALID_INDEX;
+    u32 m_framebuffer_texture = INVALID_INDEX;
+    u32 m_camera = INVALID_INDEX;
+    u32 m_camera_node = INVALID_INDEX;
+    bool m_instanced = false;
+    u32 m_copy_src_texture = INVALID_INDEX;
+    u32 m_copy_dst_texture = INVALID_INDEX;
+    u32 m_compute_work_groups[3] = {1, 1, 1};
+    vec<PassBinding> m_bindings;
+    vec<DrawItem> m_draws;
+    BoundsSoA m_bounds;
+    vec<u8> m_visibility;
+    vec<u8> m_occlusion_visibility;
+    vec<u32> m_visible_draws;
+    RenderQueue m_queue;
+    vec<DrawBatch> m_batches;
+    CommandBuffer m_commands;
+    bool m_recorded = false;
+    u64 m_recorded_scene_version = 0;
+    u64 m_recorded_resource_version = 0;
+    Mat4 m_recorded_view_projection;
+    // Materials of m_draws and their uniform values when the commands were recorded, since
+    // Material::m_uniforms can be written without going through set_material_uniform.
+    vec<u32> m_materials;
+    vec<u8> m_recorded_material_values;
+    vec<FrameGraphAccess> m_texture_accesses;
+    bool m_cacheable = false;
+    u32 m_update_every = 1;
+    bool m_cache_valid = false;
+    u64 m_cached_scene_version = 0;
+    u64 m_cached_input_version = 0;
+    Mat4 m_cached_view_matrix;
+    Mat4 m_cached_projection_matrix;
+};
+
 struct Pass {
     str m_name;
     PassType m_type;
@@ -254,6 +485,14 @@ struct Pass {
     str m_framebuffer;
     str m_camera;
     bool m_enabled = true;
+    u32 m_update_every = 1;
+    u32 m_phase = 0;
+    bool m_cacheable = false;
+    u64 m_cache_hits = 0;
+    u64 m_cache_misses = 0;
+    u32 m_visible_count = 0;
+    u32 m_culled_count = 0;
+    u32 m_occluded_count = 0;
     bool m_use_default_framebuffer = true;
     bool m_enable_depth_test = true;
     bool m_enable_face_culling = true;
@@ -263,9 +502,10 @@ struct Pass {
     u32 m_bufferless_draw_count = 0;
     std::unordered_map<str, str> m_sampler_uniforms_bindings;
     std::unordered_map<str, pair<str, AccessType>> m_image_uniforms_bindings;
-    IntOrStr m_compute_work_groups[3];
+    IntOrExpression m_compute_work_groups[3];
     str m_copy_src_texture;
     str m_copy_dst_texture;
+    PassPlan m_plan;
 };
 
 using UniformValue = std::variant<Mat4, Vec4, Vec3, Vec2, f32, bool, u32, i32>;
@@ -274,25 +514,209 @@ struct Material {
     str m_name;
     str m_shader;
     std::unordered_map<str, std::unordered_map<str, UniformValue>> m_uniforms;
+    // Points into m_uniforms, so values edited after the passes are compiled are still recorded.
+    vec<pair<UniformId, const UniformValue*>> m_resolved_uniforms;
+};
+
+struct FrameStats {
+    u32 m_draw_calls = 0;
+    u32 m_instances = 0;
+    u64 m_indexed_vertices = 0;
+    u32 m_material_binds = 0;
+    u32 m_material_binds_skipped = 0;
+    u32 m_mesh_binds = 0;
+    u32 m_mesh_binds_skipped = 0;
+    u32 m_uniform_writes = 0;
+    u32 m_uniform_writes_skipped = 0;
+    u32 m_uniform_buffer_uploads = 0;
+    u32 m_uniform_bytes_uploaded = 0;
+    u32 m_state_changes = 0;
+    u32 m_state_changes_filtered = 0;
+    u64 m_texture_bytes_uploaded = 0;
+    u64 m_buffer_bytes_uploaded = 0;
+    u32 m_command_buffers_recorded = 0;
+    u32 m_command_buffers_reused = 0;
+    u32 m_commands_executed = 0;
+    u64 m_record_time_us = 0;
+    u64 m_execute_time_us = 0;
+    u32 m_pass_cache_hits = 0;
+    u32 m_pass_cache_misses = 0;
+    u32 m_passes_deferred = 0;
+    u32 m_draws_visible = 0;
+    u32 m_draws_culled = 0;
+    u32 m_draws_occluded = 0;
+    u32 m_meshlets_drawn = 0;
+    u32 m_meshlets_culled = 0;
+};
+
+struct NodeSnapshot {
+    Mat4 m_global_matrix;
+    Vec3 m_position;
+    bool m_was_dirty;
+};
+
+// The camera parameters the main thread may change while the render thread draws.
+struct CameraSnapshot {
+    f32 m_fov;
+    f32 m_z_near;
+    f32 m_z_far;
+    bool m_keep_screen_aspect_ratio;
+    f32 m_left;
+    f32 m_right;
+    f32 m_bottom;
+    f32 m_top;
+    Projection m_projection;
+};
+
+struct FrameSnapshot {
+    Window::Size m_viewport_size;
+    u64 m_scene_version = 0;
+    bool m_scene_structure_changed = false;
+    Scene m_scene;
+    vec<NodeSnapshot> m_nodes;
+    vec<CameraSnapshot> m_cameras;
+    CommandBuffer m_uniform_writes;
+    vec<std::function<void()>> m_edits;
 };
 
 struct Renderer {
     Window* m_window = NULL;
     Scene* m_current_scene = NULL;
+    Window::Size m_viewport_size = {.width = 0, .height = 0};
+    Window::Size m_render_size = {.width = 0, .height = 0};
+    DynamicResolution m_dynamic_resolution;
+
+    ~Renderer();
 
     u32 m_frame_number = 1;
+    // Filled by the thread rendering. m_last_frame_stats holds the stats of the last frame
+    // rendered and is the one to read from the thread calling update() while pipelining.
+    FrameStats m_frame_stats;
+    FrameStats m_last_frame_stats;
+    TripleBuffer<FrameStats> m_published_stats;
 
     Error init(Window* window);
     Error init_api();
     void do_pass(Pass& pass);
+    bool pass_scheduled(Pass& pass);
+    bool m_executing_pass = false;
+    u64 pass_input_version(Pass& pass);
+    bool pass_cache_hit(Pass& pass);
+    void store_pass_cache(Pass& pass);
+    Error compile_pass(Pass& pass);
+    void compile_passes();
+    FrameGraph m_frame_graph;
+    // Opt-in: culling passes and aliasing their render targets relies on every pass declaring
+    // all the textures it touches, which is not checked.
+    bool m_frame_graph_enabled = false;
+    void compile_frame_graph();
+    void collect_pass_accesses(Pass& pass, vec<FrameGraphAccess>* accesses);
+    void apply_texture_aliases();
+    bool m_frustum_culling = true;
+    void cull_draws(Pass& pass);
+    // With m_bvh_culling the frustum test runs against a BVH over all renderables, refitted
+    // from the scene dirty node list, instead of against every draw of each pass.
+    bool m_bvh_culling = false;
+    Bvh m_bvh;
+    bool m_should_build_bvh = true;
+    vec<vec<u32>> m_node_renderables;
+    vec<u32> m_bvh_query_items;
+    vec<u8> m_bvh_visibility;
+    bool renderable_bounds(u32 renderable, Aabb* bounds);
+    void update_bvh();
+    // Draws that pass frustum culling are tested against the depth of the renderables tagged
+    // OCCLUDER_TAG, rasterized on the CPU once per camera and frame.
+    bool m_occlusion_culling = false;
+    OcclusionBuffer m_occlusion_buffer;
+    u32 m_occlusion_camera = INVALID_INDEX;
+    u32 m_occlusion_frame = UINT32_MAX;
+    vec<u8> m_renderable_occluders;
+    void render_occluders(u32 camera);
+    void occlusion_cull_draws(Pass& pass);
+    // A level is used while its error projects to at most m_lod_pixel_error pixels. Switching
+    // to a coarser level also requires the hysteresis margin, so draws near the limit do not
+    // alternate between two levels.
+    bool m_mesh_lod = true;
+    f32 m_lod_pixel_error = 1.0f;
+    f32 m_lod_hysteresis = 0.25f;
+    void select_draw_lods(Pass& pass);
+    // Static renderables with the same material, tags and vertex attributes are baked in world
+    // space into batch meshes. Their parts are split into meshlets of the batch, so meshlet
+    // culling still skips the parts outside the frustum. Called on the main thread once the
+    // scene is loaded, before the render thread starts.
+    bool m_static_batching = true;
+    u32 m_static_batch_count = 0;
+    void build_static_batches();
+    // Non-instanced draws of meshes with meshlets only draw the meshlets that pass the frustum
+    // test and, in passes culling back faces, the normal cone test.
+    bool m_meshlet_culling = true;
+    void record_meshlet_draw(const Pass& pass, const Mesh* mesh, const DrawBatch& draw_batch,
+                             CommandBuffer& command_buffer, FrameStats& stats);
+    void build_render_queue(Pass& pass);
+    void build_draw_batches(Pass& pass);
+    void record_pass(Pass& pass, CommandBuffer& command_buffer);
+    void record_draw_batches(Pass& pass, u32 begin, u32 end, CommandBuffer& command_buffer,
+                             FrameStats& stats);
+    bool joins_indirect_draw(const PassPlan& plan, u32 first, u32 batch);
+    void material_values(const PassPlan& plan, vec<u8>& values);
+    vec<u8> m_material_values;
+    ThreadPool m_thread_pool;
+    vec<CommandBuffer> m_chunk_command_buffers;
+    void set_worker_count(u32 worker_count);
+    void record_uniform(CommandBuffer& command_buffer, UniformId uniform_id,
+                        const UniformValue& uniform_value);
+    void execute(CommandBuffer& command_buffer);
+    bool m_should_compile_passes = true;
+    // Bumped by material and mesh edits. Recorded passes are only replayed while the scene and
+    // resource versions are those they were recorded with.
+    u64 m_resource_version = 0;
+    void edit_resources(std::function<void()> edit);
     void update();
+    void render_frame(Window::Size viewport_size);
+    void resize_viewport(Window::Size viewport_size);
+    Window::Size scaled_viewport_size(f32 scale);
+    Window::Size max_render_size();
+    void update_render_size();
+
+    std::thread m_render_thread;
+    bool m_pipeline_throttle = true;
+    TripleBuffer<FrameSnapshot> m_snapshots;
+    std::atomic<u64> m_published_frames = 0;
+    std::atomic<u64> m_consumed_frames = 0;
+    std::atomic<bool> m_stop_render_thread = false;
+    Scene* m_sim_scene = NULL;
+    Scene m_render_scene;
+    ArrayMap<Camera> m_render_cameras;
+    size_t m_captured_node_count = 0;
+    CommandBuffer m_pending_uniform_writes;
+    vec<std::function<void()>> m_pending_edits;
+    Error start_render_thread();
+    void stop_render_thread();
+    void render_thread_loop();
+    void submit_frame();
+    void capture_snapshot(FrameSnapshot* snapshot, bool merge);
+    void apply_snapshot(FrameSnapshot* snapshot);
+    void make_context_current();
+    void release_context();
     void clear(u32 clear_flag, RGBA clear_color, float clear_depth);
     void present();
     void draw(MeshPrimitive primitive, size_t count);
-    void draw_indexed(MeshPrimitive primitive, size_t count);
+    void draw_indexed(MeshPrimitive primitive, size_t count, u32 first_index);
+    void draw_indexed_instanced(MeshPrimitive primitive, size_t count, u32 instance_count,
+                                u32 first_instance, u32 first_index);
+    void multi_draw_indexed(MeshPrimitive primitive, const u32* counts, const u32* first_indices,
+                            u32 draw_count);
+    void multi_draw_indexed_indirect(MeshPrimitive primitive, const DrawIndirectCommand* draws,
+                                     u32 draw_count);
     void dispatch_compute(u32 num_groups_x, u32 num_groups_y, u32 num_groups_z);
     void set_swap_interval(u32 interval);
+    // GPU time of the passes of a frame, read back a few frames later so that it never waits
+    // for the GPU. 0 when the backend can't measure it.
+    void begin_gpu_frame_timer();
+    void end_gpu_frame_timer();
+    f32 last_gpu_frame_time_ms();
     void copy_texture(str src, str dst, Vec3I src_pos, Vec2I src_size, Vec3I dst_pos);
+    void copy_texture(u32 src, u32 dst, Vec3I src_pos, Vec2I src_size, Vec3I dst_pos);
 
     void debug_marker_start(str name);
     void debug_marker_end();
@@ -310,6 +734,7 @@ struct Renderer {
     Error reload_shader(str shader_id);
     Error reload_shader_api(str shader_id);
     void set_current_shader(str shader_id);
+    void set_current_shader(u32 shader_index);
 
     ArrayMap<Mesh> m_meshes;
     Error create_mesh(Mesh mesh);
@@ -317,12 +742,25 @@ struct Renderer {
     Error reload_mesh(str mesh_id);
     Error reload_mesh_api(str mesh_id);
     void set_current_mesh(str mesh_id);
+    void set_current_mesh(u32 mesh_index);
     void set_bufferless_mesh();
+    // Pooled meshes share a vertex array, so switching between them does not rebind buffers,
+    // and the batches of an instanced pass with the same material and pool are drawn by one
+    // multi_draw_indexed_indirect. Not available in WebGL.
+    bool m_mesh_pooling = false;
+    bool m_multi_draw_indirect = true;
+    vec<MeshPool> m_mesh_pools;
+    void allocate_mesh_pool_range(Mesh* mesh);
+
+    vec<Mat4> m_instance_data;
+    Error set_instance_data(const Mat4* instance_data, u32 count);
 
     ArrayMap<Framebuffer> m_framebuffers;
     Error create_framebuffer(Framebuffer framebuffer);
     Error create_framebuffer_api(str framebuffer_id);
+    Error destroy_framebuffer_api(u32 framebuffer_index);
     void set_current_framebuffer(str framebuffer_id);
+    void set_current_framebuffer(u32 framebuffer_index);
     void set_default_framebuffer();
     Error attach_texture_to_framebuffer(str framebuffer_id);
 
@@ -331,26 +769,95 @@ struct Renderer {
     Error create_texture_api(str texture_id);
     Error reload_texture(str texture_id);
     Error reload_texture_api(str texture_id);
+    Error destroy_texture_api(u32 texture_index);
+    vec<pair<u32, u32>> m_history_textures;
+    // Each framebuffer attached to a history texture has a twin API framebuffer attached to the
+    // other texture of the pair, created once and exchanged with it every frame.
+    vec<pair<u32, void*>> m_history_framebuffers;
+    void resolve_history_textures();
+    void create_history_framebuffers();
+    void swap_history_textures();
 
     ArrayMap<Camera> m_cameras;
+    // m_cameras, or the render thread copy of it while pipelining.
+    ArrayMap<Camera>* m_current_cameras = &m_cameras;
     Error create_camera(Camera camera);
 
     vec<Renderable> m_renderables;
     std::unordered_map<str, vec<u32>> m_tagged_renderables;
     void create_renderable(Renderable renderable);
+    void set_renderable_mesh(u32 renderable_index, str mesh_id);
 
     ArrayMap<UniformBuffer> m_uniform_buffers;
     Error create_uniform_buffer(UniformBuffer uniform_buffer);
+    Error add_uniform_buffer(UniformBuffer uniform_buffer);
+    vec<u32> m_uniform_block_buffers;
+    Error set_uniform_buffer_block(u32 uniform_buffer_index, const void* data, u32 size);
+    void write_uniform_buffer(u32 uniform_buffer_index, u32 offset, const void* data, u32 size);
+
+    template <typename T>
+    Error create_uniform_buffer() {
+        static_assert(std::is_standard_layout_v<T>,
+                      "Uniform block must be a standard layout struct");
+        static_assert(has_std140_offsets<T>(), "Uniform block fields do not match std140 offsets");
+        static_assert(sizeof(T) == std140_block_size<T>(),
+                      "Uniform block size does not match its std140 size, add trailing padding");
+
+        UniformBuffer uniform_buffer = {.m_name = T::NAME, .m_size = sizeof(T)};
+        for (const UniformField& field : T::uniforms()) {
+            uniform_buffer.m_uniforms.push_back(Uniform{.m_name = field.m_name,
+                                                        .m_type = field.m_type,
+                                                        .m_offset = field.m_offset,
+                                                        .m_size = field.m_size});
+        }
+
+        u32 block_id = uniform_block_id<T>();
+        if (m_uniform_block_buffers.size() <= block_id) {
+            m_uniform_block_buffers.resize(block_id + 1, INVALID_INDEX);
+        }
+        m_uniform_block_buffers[block_id] = u32(m_uniform_buffers.array.size());
+        return add_uniform_buffer(uniform_buffer);
+    }
+
+    template <typename T>
+    Error set_uniform_buffer(const T& block) {
+        u32 block_id = uniform_block_id<T>();
+        if (block_id >= m_uniform_block_buffers.size() ||
+            m_uniform_block_buffers[block_id] == INVALID_INDEX) {
+            return Error(str("Renderer::set_uniform_buffer: Uniform buffer ") + T::NAME +
+                         " was not created from a block");
+        }
+        return set_uniform_buffer_block(m_uniform_block_buffers[block_id], &block, sizeof(T));
+    }
+
     Error create_uniform_buffer_api(str uniform_buffer_id);
+    Error flush_uniform_buffer_api(u32 uniform_buffer_index);
+    vec<u32> m_dirty_uniform_buffers;
+    void flush_uniform_buffers();
     Error set_uniform_buffer_data(str uniform_buffer_id,
                                   vec<pair<str, UniformValue>> uniform_values);
+    Error set_uniform_buffer_data(UniformId uniform_id, const UniformValue& uniform_value);
+    opt<UniformId> find_uniform(const str& uniform_buffer_id, const str& uniform_name);
+
+    UniformId m_model_mat_uniform;
+    UniformId m_view_mat_uniform;
+    UniformId m_projection_mat_uniform;
+    UniformId m_camera_position_uniform;
+    UniformId m_frame_number_uniform;
+    UniformId m_render_scale_uniform;
 
     ArrayMap<Material> m_materials;
     void create_material(Material material);
+    void set_material_uniform(str material_id, str uniform_buffer_id, str uniform_name,
+                              UniformValue value);
 
-    void bind_uniforms(Pass* pass, str shader_id);
+    void bind_uniforms(const PassBinding* bindings, u32 count);
 
-    u32 special_value(const str& name);
+    u32 viewport_value(const Expression& expression, Window::Size viewport_size);
+    Window::Size viewport_texture_size(const Texture& texture, Window::Size viewport_size);
+    Window::Size texture_render_size(u32 texture_index);
+    void resize_texture_to_viewport(Texture* texture);
+    void evaluate_compute_work_groups(Pass& pass);
 };
 
 }  // namespace blaz
\ No newline at end of file
@@ -226,7 +226,7 @@ void Renderer::draw_vertex_array(Mesh* mesh) {
     d3d11->device_context->IASetVertexBuffers(0, 1, &api_mesh->m_vertex_buffer, &stride, &offset);
     d3d11->device_context->IASetIndexBuffer(api_mesh->m_index_buffer, DXGI_FORMAT_R32_UINT, 0);
     d3d11->device_context->IASetPrimitiveTopology(D3D10_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-    d3d11->device_context->DrawIndexed(UINT(mesh->m_indices.size()), 0, 0);
+    d3d11->device_context->DrawIndexed(UINT(mesh_indices(mesh).size()), 0, 0);
 }
 
 Error Renderer::upload_mesh(Mesh* mesh) {
@@ -235,13 +235,13 @@ Error Renderer::upload_mesh(Mesh* mesh) {
     ZeroMemory(&vertex_buffer_desc, sizeof(vertex_buffer_desc));
 
     vertex_buffer_desc.Usage = D3D11_USAGE_DEFAULT;
-    vertex_buffer_desc.ByteWidth = sizeof(f32) * UINT(mesh->m_vertices.size());
+    vertex_buffer_desc.ByteWidth = UINT(mesh_vertices(mesh).size_bytes());
     vertex_buffer_desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
     vertex_buffer_desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
 
     D3D11_SUBRESOURCE_DATA vertex_buffer_data;
     ZeroMemory(&vertex_buffer_data, sizeof(vertex_buffer_data));
-    vertex_buffer_data.pSysMem = mesh->m_vertices.data();
+    vertex_buffer_data.pSysMem = mesh_vertices(mesh).data();
 
     d3d11->device->CreateBuffer(&vertex_buffer_desc, &vertex_buffer_data, &vertex_buffer);
 
@@ -249,13 +249,13 @@ Error Renderer::upload_mesh(Mesh* mesh) {
     D3D11_BUFFER_DESC index_buffer_desc;
     ZeroMemory(&index_buffer_desc, sizeof(index_buffer_desc));
     index_buffer_desc.Usage = D3D11_USAGE_DEFAULT;
-    index_buffer_desc.ByteWidth = sizeof(u32) * UINT(mesh->m_indices.size());
+    index_buffer_desc.ByteWidth = UINT(mesh_indices(mesh).size_bytes());
     index_buffer_desc.BindFlags = D3D11_BIND_INDEX_BUFFER;
     index_buffer_desc.CPUAccessFlags = 0;
 
     D3D11_SUBRESOURCE_DATA index_buffer_data;
     ZeroMemory(&index_buffer_data, sizeof(index_buffer_data));
-    index_buffer_data.pSysMem = mesh->m_indices.data();
+    index_buffer_data.pSysMem = mesh_indices(mesh).data();
 
     d3d11->device->CreateBuffer(&index_buffer_desc, &index_buffer_data, &index_buffer);
 
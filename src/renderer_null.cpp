@@ -2,7 +2,55 @@
 
 namespace blaz {
 
+const u32 NULL_UNKNOWN_STATE = INVALID_INDEX;
+const u32 NULL_DEFAULT_FRAMEBUFFER = INVALID_INDEX - 1;
+const u32 NULL_BUFFERLESS_MESH = INVALID_INDEX - 1;
+// Pooled meshes share the vertex array of their pool.
+const u32 NULL_POOLED_MESH = 1u << 31;
+const u32 NULL_MAX_BINDING_POINTS = 64;
+
+struct StateCache_NULL {
+    FrameStats* m_stats = NULL;
+    u32 m_shader = NULL_UNKNOWN_STATE;
+    u32 m_mesh = NULL_UNKNOWN_STATE;
+    u32 m_framebuffer = NULL_UNKNOWN_STATE;
+    u32 m_viewport[4] = {NULL_UNKNOWN_STATE, NULL_UNKNOWN_STATE, NULL_UNKNOWN_STATE,
+                         NULL_UNKNOWN_STATE};
+    i32 m_depth_test = -1;
+    i32 m_cull_face = -1;
+    i32 m_cull_face_mode = -1;
+    i32 m_front_face = -1;
+    u32 m_bindings[NULL_MAX_BINDING_POINTS];
+};
+
+StateCache_NULL state_cache;
+
+static bool state_changed(bool changed) {
+    if (changed) {
+        state_cache.m_stats->m_state_changes++;
+    } else {
+        state_cache.m_stats->m_state_changes_filtered++;
+    }
+    return changed;
+}
+
+static void set_state(u32* state, u32 value) {
+    if (state_changed(*state != value)) {
+        *state = value;
+    }
+}
+
+static void set_state(i32* state, i32 value) {
+    if (state_changed(*state != value)) {
+        *state = value;
+    }
+}
+
 Error Renderer::init_api() {
+    state_cache.m_stats = &m_frame_stats;
+    for (u32 i = 0; i < NULL_MAX_BINDING_POINTS; i++) {
+        state_cache.m_bindings[i] = NULL_UNKNOWN_STATE;
+    }
     return Error();
 }
 
@@ -15,58 +63,168 @@ void Renderer::present() {
 void Renderer::set_swap_interval(u32 interval) {
 }
 
-Error Renderer::compile_shader(Shader* shader) {
+void Renderer::make_context_current() {
+}
+
+void Renderer::release_context() {
+}
+
+Error Renderer::create_shader_api(str shader_id) {
+    return Error();
+}
+
+Error Renderer::reload_shader_api(str shader_id) {
+    Shader* shader = &m_shaders[shader_id];
+    shader->m_instanced =
+        shader->m_vertex_shader_source.find("a_instance_model_mat") != str::npos;
+    shader->m_should_reload = false;
     return Error();
 }
 
-Error Renderer::upload_mesh(Mesh* mesh) {
+void Renderer::set_current_shader(u32 shader_index) {
+    set_state(&state_cache.m_shader, shader_index);
+}
+
+void Renderer::set_bufferless_mesh() {
+    set_state(&state_cache.m_mesh, NULL_BUFFERLESS_MESH);
+}
+
+Error Renderer::create_mesh_api(str mesh_id) {
     return Error();
 }
 
-Error Renderer::init_uniform_buffer(UniformBuffer* uniform_buffer) {
+Error Renderer::reload_mesh_api(str mesh_id) {
+    Mesh* mesh = &m_meshes[mesh_id];
+    m_frame_stats.m_buffer_bytes_uploaded +=
+        mesh_vertices(mesh).size_bytes() + mesh_indices(mesh).size_bytes();
+    mesh->m_should_reload = false;
     return Error();
 }
 
-Error Renderer::set_uniform_buffer_data(UniformBuffer* uniform_buffer, str uniform_name,
-                                        UniformValue value) {
+Error Renderer::set_instance_data(const Mat4* instance_data, u32 count) {
+    m_frame_stats.m_buffer_bytes_uploaded += count * sizeof(Mat4);
     return Error();
 }
 
-void Renderer::set_shader(Shader* shader) {
+void Renderer::set_current_mesh(u32 mesh_index) {
+    u32 pool = m_meshes[mesh_index].m_pool;
+    set_state(&state_cache.m_mesh, pool != INVALID_INDEX ? NULL_POOLED_MESH | pool : mesh_index);
+}
+
+void Renderer::begin_gpu_frame_timer() {
+}
+
+void Renderer::end_gpu_frame_timer() {
 }
 
-Error Renderer::upload_texture(Texture* texture) {
+f32 Renderer::last_gpu_frame_time_ms() {
+    return 0;
+}
+
+Error Renderer::create_framebuffer_api(str framebuffer_id) {
     return Error();
 }
 
-void Renderer::set_textures(Pass* pass, Shader* shader) {
+Error Renderer::destroy_framebuffer_api(u32 framebuffer_index) {
+    return Error();
 }
 
-void Renderer::debug_marker_start(str name) {
+Error Renderer::attach_texture_to_framebuffer(str framebuffer_id) {
+    return Error();
 }
 
-void Renderer::debug_marker_end() {
+void Renderer::set_current_framebuffer(u32 framebuffer_index) {
+    set_state(&state_cache.m_framebuffer, framebuffer_index);
 }
 
 void Renderer::set_default_framebuffer() {
+    set_state(&state_cache.m_framebuffer, NULL_DEFAULT_FRAMEBUFFER);
 }
 
-void Renderer::set_viewport(u32 x, u32 y, u32 width, u32 height) {
+Error Renderer::create_uniform_buffer_api(str uniform_buffer_id) {
+    return Error();
+}
+
+Error Renderer::flush_uniform_buffer_api(u32 uniform_buffer_index) {
+    return Error();
 }
 
-void Renderer::set_framebuffer(Framebuffer* framebuffer) {
+Error Renderer::create_texture_api(str texture_id) {
+    return Error();
+}
+
+Error Renderer::reload_texture_api(str texture_id) {
+    Texture* texture = &m_textures[texture_id];
+    m_frame_stats.m_texture_bytes_uploaded +=
+        texture->m_data.size() + texture->m_float_data.size() * sizeof(f32);
+    texture->m_should_reload = false;
+    return Error();
+}
+
+Error Renderer::destroy_texture_api(u32 texture_index) {
+    m_textures[texture_index].m_api_data = NULL;
+    return Error();
+}
+
+void Renderer::bind_uniforms(const PassBinding* bindings, u32 count) {
+    for (u32 i = 0; i < count; i++) {
+        const PassBinding& binding = bindings[i];
+        if (binding.m_binding_point < NULL_MAX_BINDING_POINTS) {
+            set_state(&state_cache.m_bindings[binding.m_binding_point], binding.m_resource);
+        }
+    }
+}
+
+void Renderer::debug_marker_start(str name) {
+}
+
+void Renderer::debug_marker_end() {
+}
+
+void Renderer::set_viewport(u32 x, u32 y, u32 width, u32 height) {
+    u32* viewport = state_cache.m_viewport;
+    if (state_changed(viewport[0] != x || viewport[1] != y || viewport[2] != width ||
+                      viewport[3] != height)) {
+        viewport[0] = x;
+        viewport[1] = y;
+        viewport[2] = width;
+        viewport[3] = height;
+    }
 }
 
 void Renderer::set_depth_test(bool enabled) {
+    set_state(&state_cache.m_depth_test, i32(enabled));
 }
 
 void Renderer::set_face_culling(bool enabled, CullingMode mode, CullingOrder order) {
+    set_state(&state_cache.m_cull_face, i32(enabled));
+    set_state(&state_cache.m_cull_face_mode, i32(mode));
+    set_state(&state_cache.m_front_face, i32(order));
+}
+
+void Renderer::draw(MeshPrimitive primitive, size_t count) {
+}
+
+void Renderer::draw_indexed(MeshPrimitive primitive, size_t count, u32 first_index) {
+}
+
+void Renderer::draw_indexed_instanced(MeshPrimitive primitive, size_t count, u32 instance_count,
+                                      u32 first_instance, u32 first_index) {
+}
+
+void Renderer::multi_draw_indexed(MeshPrimitive primitive, const u32* counts,
+                                  const u32* first_indices, u32 draw_count) {
+}
+
+void Renderer::multi_draw_indexed_indirect(MeshPrimitive primitive,
+                                           const DrawIndirectCommand* draws, u32 draw_count) {
+    m_frame_stats.m_buffer_bytes_uploaded += draw_count * sizeof(DrawIndirectCommand);
 }
 
-void Renderer::draw_mesh(Mesh* mesh) {
+void Renderer::dispatch_compute(u32 num_groups_x, u32 num_groups_y, u32 num_groups_z) {
 }
 
-void Renderer::draw_bufferless(u32 count) {
+void Renderer::copy_texture(u32 src, u32 dst, Vec3I src_pos, Vec2I src_size, Vec3I dst_pos) {
 }
 
 }  // namespace blaz
\ No newline at end of file
@@ -12,10 +12,77 @@ namespace blaz {
 
 struct Mesh_OPENGL {
     GLuint m_vbo, m_vao, m_ebo;
+    bool m_instance_attribs = false;
+};
+
+struct MeshPool_OPENGL {
+    GLuint m_vao = 0;
+    GLuint m_vbo = 0;
+    GLuint m_ebo = 0;
+    u64 m_vertex_bytes = 0;
+    u64 m_index_bytes = 0;
+    bool m_instance_attribs = false;
 };
 
 struct UniformBuffer_OPENGL {
     GLuint m_ubo;
+    GLuint m_bound_buffer;
+    u32 m_bound_offset = 0;
+    u32 m_ring_frame = UINT32_MAX;
+    // Ring draw count when the ring range was written, the range can be patched in place until
+    // a draw reads it.
+    u64 m_ring_draw_count = 0;
+    // One bit per binding point the buffer is bound to.
+    u64 m_binding_points = 0;
+};
+
+const u32 UNIFORM_RING_FRAMES = 3;
+const u32 UNIFORM_RING_FRAME_SIZE = 4 * 1024 * 1024;
+const u32 MAX_UNIFORM_BINDING_POINTS = 64;
+
+struct UniformRing_OPENGL {
+    GLuint m_buffer = 0;
+    u8* m_mapped = NULL;
+    u32 m_alignment = 256;
+    u32 m_frame = 0;
+    u32 m_offset = 0;
+    u64 m_draw_count = 0;
+    bool m_full_logged = false;
+    GLsync m_fences[UNIFORM_RING_FRAMES] = {};
+    u32 m_bound_uniform_buffers[MAX_UNIFORM_BINDING_POINTS];
+};
+
+const u32 GPU_TIMER_QUERIES = 4;
+
+struct GpuTimer_OPENGL {
+    GLuint m_queries[GPU_TIMER_QUERIES] = {};
+    bool m_pending[GPU_TIMER_QUERIES] = {};
+    u32 m_frame = 0;
+    bool m_active = false;
+    f32 m_last_time_ms = 0;
+};
+
+const u32 MAX_CACHED_TEXTURE_UNITS = 32;
+
+struct BufferRange_OPENGL {
+    GLuint m_buffer = 0;
+    GLintptr m_offset = 0;
+    GLsizeiptr m_size = 0;
+};
+
+struct StateCache_OPENGL {
+    FrameStats* m_stats = NULL;
+    GLuint m_program = 0;
+    GLuint m_vao = 0;
+    GLuint m_fbo = 0;
+    GLint m_viewport[4] = {-1, -1, -1, -1};
+    i32 m_depth_test = -1;
+    i32 m_cull_face = -1;
+    GLenum m_cull_face_mode = GL_NONE;
+    GLenum m_front_face = GL_NONE;
+    u32 m_active_texture_unit = 0;
+    GLuint m_textures[MAX_CACHED_TEXTURE_UNITS] = {};
+    BufferRange_OPENGL m_uniform_buffer_ranges[MAX_UNIFORM_BINDING_POINTS];
 };
 
 struct Shader_OPENGL {
@@ -78,6 +145,82 @@ static std::unordered_map<TextureTarget, GLenum> opengl_texture_targets = {
 
 OpenglLoader* gl;
 GLuint dummy_vao;
+GLuint instance_vbo;
+GLuint indirect_buffer;
+// Offsets of the current mesh in its pool, added to every draw.
+i32 current_base_vertex = 0;
+u32 current_first_index = 0;
+// Whether the vertex array of the current mesh reads the instance model matrices.
+bool* current_instance_attribs = NULL;
+// Per draw offsets and base vertices of multi_draw_indexed, kept between draws.
+vec<const void*> multi_draw_offsets;
+vec<GLint> multi_draw_base_vertices;
+UniformRing_OPENGL uniform_ring;
+GpuTimer_OPENGL gpu_timer;
+StateCache_OPENGL state_cache;
+
+static bool state_changed(bool changed) {
+    if (changed) {
+        state_cache.m_stats->m_state_changes++;
+    } else {
+        state_cache.m_stats->m_state_changes_filtered++;
+    }
+    return changed;
+}
+
+static void use_program(GLuint program) {
+    if (state_changed(state_cache.m_program != program)) {
+        state_cache.m_program = program;
+        gl->glUseProgram(program);
+    }
+}
+
+static void bind_vertex_array(GLuint vao) {
+    if (state_changed(state_cache.m_vao != vao)) {
+        state_cache.m_vao = vao;
+        gl->glBindVertexArray(vao);
+    }
+}
+
+static void bind_framebuffer(GLuint fbo) {
+    if (state_changed(state_cache.m_fbo != fbo)) {
+        state_cache.m_fbo = fbo;
+        gl->glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    }
+}
+
+static void active_texture(u32 unit) {
+    if (state_changed(state_cache.m_active_texture_unit != unit)) {
+        state_cache.m_active_texture_unit = unit;
+        gl->glActiveTexture(GL_TEXTURE0 + unit);
+    }
+}
+
+static void bind_texture_2d(GLuint texture_name) {
+    u32 unit = state_cache.m_active_texture_unit;
+    if (unit >= MAX_CACHED_TEXTURE_UNITS) {
+        gl->glBindTexture(GL_TEXTURE_2D, texture_name);
+        return;
+    }
+    if (state_changed(state_cache.m_textures[unit] != texture_name)) {
+        state_cache.m_textures[unit] = texture_name;
+        gl->glBindTexture(GL_TEXTURE_2D, texture_name);
+    }
+}
+
+static void bind_uniform_buffer_range(u32 binding_point, GLuint buffer, GLintptr offset,
+                                      GLsizeiptr size) {
+    if (binding_point >= MAX_UNIFORM_BINDING_POINTS) {
+        gl->glBindBufferRange(GL_UNIFORM_BUFFER, binding_point, buffer, offset, size);
+        return;
+    }
+    BufferRange_OPENGL* range = &state_cache.m_uniform_buffer_ranges[binding_point];
+    if (state_changed(range->m_buffer != buffer || range->m_offset != offset ||
+                      range->m_size != size)) {
+        *range = {.m_buffer = buffer, .m_offset = offset, .m_size = size};
+        gl->glBindBufferRange(GL_UNIFORM_BUFFER, binding_point, buffer, offset, size);
+    }
+}
 
 void gl_error_callback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length,
                        const GLchar* message, const void* userParam) {
@@ -194,6 +337,7 @@ void gl_error_callback(GLenum source, GLenum type, GLuint id, GLenum severity, G
 
 Error Renderer::init_api() {
     gl = new OpenglLoader();
+    state_cache.m_stats = &m_frame_stats;
     bool debug = false;
 #ifdef DEBUG_RENDERER
     debug = true;
@@ -211,6 +355,43 @@ Error Renderer::init_api() {
 
     gl->glGenVertexArrays(1, &dummy_vao);
 
+    gl->glGenBuffers(1, &instance_vbo);
+    gl->glBindBuffer(GL_ARRAY_BUFFER, instance_vbo);
+    gl->glBufferData(GL_ARRAY_BUFFER, sizeof(Mat4), NULL, GL_STREAM_DRAW);
+#ifdef DEBUG_RENDERER
+    gl->glObjectLabel(GL_BUFFER, instance_vbo, -1, "instance_vbo");
+#endif
+
+    gl->glGenBuffers(1, &indirect_buffer);
+    gl->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect_buffer);
+    gl->glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(DrawIndirectCommand), NULL, GL_STREAM_DRAW);
+#ifdef DEBUG_RENDERER
+    gl->glObjectLabel(GL_BUFFER, indirect_buffer, -1, "indirect_buffer");
+#endif
+
+    GLint uniform_buffer_alignment;
+    gl->glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniform_buffer_alignment);
+    uniform_ring.m_alignment = u32(uniform_buffer_alignment);
+
+    GLbitfield ring_flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    gl->glGenBuffers(1, &uniform_ring.m_buffer);
+    gl->glBindBuffer(GL_UNIFORM_BUFFER, uniform_ring.m_buffer);
+    gl->glBufferStorage(GL_UNIFORM_BUFFER, UNIFORM_RING_FRAMES * UNIFORM_RING_FRAME_SIZE, NULL,
+                        ring_flags);
+    uniform_ring.m_mapped = (u8*)gl->glMapBufferRange(
+        GL_UNIFORM_BUFFER, 0, UNIFORM_RING_FRAMES * UNIFORM_RING_FRAME_SIZE, ring_flags);
+    if (uniform_ring.m_mapped == NULL) {
+        return Error("Renderer::init_api: Failed to map uniform ring buffer");
+    }
+    for (u32 i = 0; i < MAX_UNIFORM_BINDING_POINTS; i++) {
+        uniform_ring.m_bound_uniform_buffers[i] = INVALID_INDEX;
+    }
+#ifdef DEBUG_RENDERER
+    gl->glObjectLabel(GL_BUFFER, uniform_ring.m_buffer, -1, "uniform_ring_buffer");
+#endif
+
+    gl->glGenQueries(GPU_TIMER_QUERIES, gpu_timer.m_queries);
+
     return Error();
 }
 
@@ -231,6 +412,81 @@ void Renderer::clear(u32 clear_flag, RGBA clear_color, float clear_depth) {
 
 void Renderer::present() {
     gl->swap_buffers(m_window);
+
+    uniform_ring.m_fences[uniform_ring.m_frame] =
+        gl->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    uniform_ring.m_frame = (uniform_ring.m_frame + 1) % UNIFORM_RING_FRAMES;
+    uniform_ring.m_offset = 0;
+
+    GLsync fence = uniform_ring.m_fences[uniform_ring.m_frame];
+    if (fence != NULL) {
+        GLbitfield wait_flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+        while (true) {
+            GLenum status = gl->glClientWaitSync(fence, wait_flags, 1000000);
+            if (status != GL_TIMEOUT_EXPIRED) {
+                break;
+            }
+            wait_flags = 0;
+        }
+        gl->glDeleteSync(fence);
+        uniform_ring.m_fences[uniform_ring.m_frame] = NULL;
+    }
+
+    for (u32 i = 0; i < m_uniform_buffers.size(); i++) {
+        UniformBuffer* uniform_buffer = &m_uniform_buffers[i];
+        UniformBuffer_OPENGL* api_uniform_buffer =
+            (UniformBuffer_OPENGL*)uniform_buffer->m_api_data;
+        if (api_uniform_buffer->m_ring_frame == uniform_ring.m_frame) {
+            api_uniform_buffer->m_ring_frame = UINT32_MAX;
+            if (uniform_buffer->m_dirty_begin >= uniform_buffer->m_dirty_end) {
+                m_dirty_uniform_buffers.push_back(i);
+            }
+            uniform_buffer->m_dirty_begin = 0;
+            uniform_buffer->m_dirty_end = uniform_buffer->m_size;
+        }
+    }
+}
+
+// Each frame reuses the query of GPU_TIMER_QUERIES frames ago, and is not timed if its result
+// is still not available.
+void Renderer::begin_gpu_frame_timer() {
+    u32 slot = gpu_timer.m_frame % GPU_TIMER_QUERIES;
+    GLuint query = gpu_timer.m_queries[slot];
+    if (gpu_timer.m_pending[slot]) {
+        GLint available = 0;
+        gl->glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            return;
+        }
+        GLuint64 time_ns = 0;
+        gl->glGetQueryObjectui64v(query, GL_QUERY_RESULT, &time_ns);
+        gpu_timer.m_last_time_ms = f32(f64(time_ns) / 1000000.0);
+        gpu_timer.m_pending[slot] = false;
+    }
+    gl->glBeginQuery(GL_TIME_ELAPSED, query);
+    gpu_timer.m_active = true;
+}
+
+void Renderer::end_gpu_frame_timer() {
+    if (!gpu_timer.m_active) {
+        return;
+    }
+    gl->glEndQuery(GL_TIME_ELAPSED);
+    gpu_timer.m_active = false;
+    gpu_timer.m_pending[gpu_timer.m_frame % GPU_TIMER_QUERIES] = true;
+    gpu_timer.m_frame++;
+}
+
+f32 Renderer::last_gpu_frame_time_ms() {
+    return gpu_timer.m_last_time_ms;
+}
+
+void Renderer::make_context_current() {
+    gl->make_current(m_window);
+}
+
+void Renderer::release_context() {
+    gl->release_current(m_window);
 }
 
 void Renderer::set_swap_interval(u32 interval) {
@@ -245,6 +501,19 @@ Error Renderer::create_shader_api(str shader_id) {
     return Error();
 }
 
+// Vertex shaders read the model matrix from a_instance_model_mat when INSTANCING is defined, and
+// from u_model_mat otherwise. The define goes after the #version line, which has to be first.
+static str define_instancing(const str& source) {
+    size_t version_end = source.starts_with("#version") ? source.find('\n') : 0;
+    if (version_end == str::npos) {
+        return source;
+    }
+    if (version_end > 0) {
+        version_end++;
+    }
+    return source.substr(0, version_end) + "#define INSTANCING\n" + source.substr(version_end);
+}
+
 Error Renderer::reload_shader_api(str shader_id) {
     Shader* shader = &m_shaders[shader_id];
     Shader_OPENGL* api_shader = (Shader_OPENGL*)shader->m_api_data;
@@ -262,6 +531,9 @@ Error Renderer::reload_shader_api(str shader_id) {
     }
     if (api_shader->m_program) {
         gl->glDeleteProgram(api_shader->m_program);
+        if (state_cache.m_program == api_shader->m_program) {
+            state_cache.m_program = 0;
+        }
     }
 
     api_shader->m_program = gl->glCreateProgram();
@@ -291,7 +563,8 @@ Error Renderer::reload_shader_api(str shader_id) {
 #endif
 
     if (shader->m_type == ShaderType::VERTEX_FRAGMENT) {
-        const char* c_str = shader->m_vertex_shader_source.c_str();
+        str vertex_shader_source = define_instancing(shader->m_vertex_shader_source);
+        const char* c_str = vertex_shader_source.c_str();
         gl->glShaderSource(api_shader->m_vertex_shader, 1, &c_str, NULL);
         gl->glCompileShader(api_shader->m_vertex_shader);
 
@@ -299,7 +572,7 @@ Error Renderer::reload_shader_api(str shader_id) {
         if (!success) {
             gl->glGetShaderInfoLog(api_shader->m_vertex_shader, 512, NULL, info);
             gl->glDeleteShader(api_shader->m_vertex_shader);
-            return Error("Renderer::compile_shader: Failed to compile vertex shader \"" +
+            return Error("Renderer::reload_shader_api: Failed to compile vertex shader \"" +
                          shader->m_name + "\" : " + str(info));
         }
 
@@ -310,7 +583,7 @@ Error Renderer::reload_shader_api(str shader_id) {
         if (!success) {
             gl->glGetShaderInfoLog(api_shader->m_fragment_shader, 512, NULL, info);
             gl->glDeleteShader(api_shader->m_fragment_shader);
-            return Error("Renderer::compile_shader: Failed to compile fragment shader \"" +
+            return Error("Renderer::reload_shader_api: Failed to compile fragment shader \"" +
                          shader->m_name + "\" : " + str(info));
         }
     } else if (shader->m_type == ShaderType::COMPUTE) {
@@ -322,7 +595,7 @@ Error Renderer::reload_shader_api(str shader_id) {
         if (!success) {
             gl->glGetShaderInfoLog(api_shader->m_compute_shader, 512, NULL, info);
             gl->glDeleteShader(api_shader->m_compute_shader);
-            return Error("Renderer::compile_shader: Failed to compile compute shader \"" +
+            return Error("Renderer::reload_shader_api: Failed to compile compute shader \"" +
                          shader->m_name + "\" : " + str(info));
         }
     }
@@ -332,11 +605,20 @@ Error Renderer::reload_shader_api(str shader_id) {
     if (!success) {
         gl->glGetProgramInfoLog(api_shader->m_program, 512, NULL, info);
         gl->glDeleteProgram(api_shader->m_program);
-        return Error("Renderer::compile_shader: Failed to link shader program \"" + shader->m_name +
-                     "\" : " + str(info));
+        return Error("Renderer::reload_shader_api: Failed to link shader program \"" +
+                     shader->m_name + "\" : " + str(info));
     }
 
-    gl->glUseProgram(api_shader->m_program);
+    use_program(api_shader->m_program);
+
+    GLint instance_attrib_location =
+        gl->glGetAttribLocation(api_shader->m_program, "a_instance_model_mat");
+    shader->m_instanced = instance_attrib_location == INSTANCE_MODEL_MAT_ATTRIB_LOCATION;
+    if (instance_attrib_location != -1 && !shader->m_instanced) {
+        logger.error("Renderer::reload_shader_api: a_instance_model_mat in shader \"" +
+                     shader->m_name + "\" must use location " +
+                     std::to_string(INSTANCE_MODEL_MAT_ATTRIB_LOCATION));
+    }
 
     GLint n_uniforms, max_len;
     gl->glGetProgramiv(api_shader->m_program, GL_ACTIVE_UNIFORMS, &n_uniforms);
@@ -346,7 +628,7 @@ Error Renderer::reload_shader_api(str shader_id) {
         GLchar* uniform_name = (GLchar*)alloc(max_len);
 
         if (uniform_name == NULL) {
-            return Error("Renderer::compile_shader: Failed to allocate memory for uniform name");
+            return Error("Renderer::reload_shader_api: Failed to allocate memory for uniform name");
         }
 
         for (GLint i = 0; i < n_uniforms; i++) {
@@ -380,7 +662,7 @@ Error Renderer::reload_shader_api(str shader_id) {
 
         if (uniform_block_name == NULL) {
             logger.error(
-                "Renderer::compile_shader: Failed to allocate memory for uniform block name");
+                "Renderer::reload_shader_api: Failed to allocate memory for uniform block name");
         }
 
         for (GLint i = 0; i < n_uniform_blocks; i++) {
@@ -404,21 +686,20 @@ Error Renderer::reload_shader_api(str shader_id) {
     return Error();
 }
 
-void Renderer::set_current_shader(str shader_id) {
-    Shader* shader = &m_shaders[shader_id];
-    gl->glUseProgram(((Shader_OPENGL*)shader->m_api_data)->m_program);
+void Renderer::set_current_shader(u32 shader_index) {
+    Shader* shader = &m_shaders[shader_index];
+    use_program(((Shader_OPENGL*)shader->m_api_data)->m_program);
 }
 
 void Renderer::set_bufferless_mesh() {
-    gl->glBindVertexArray(dummy_vao);
+    bind_vertex_array(dummy_vao);
+    current_instance_attribs = NULL;
 }
 
-Error Renderer::create_mesh_api(str mesh_id) {
-    Mesh* mesh = &m_meshes[mesh_id];
-
+static void create_mesh_buffers(Mesh* mesh) {
     u32 vbo, vao, ebo;
     gl->glGenVertexArrays(1, &vao);
-    gl->glBindVertexArray(vao);
+    bind_vertex_array(vao);
 
     gl->glGenBuffers(1, &vbo);
     gl->glBindBuffer(GL_ARRAY_BUFFER, vbo);
@@ -426,7 +707,7 @@ Error Renderer::create_mesh_api(str mesh_id) {
     gl->glGenBuffers(1, &ebo);
     gl->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
 
-    gl->glBindVertexArray(0);
+    bind_vertex_array(0);
 
     Mesh_OPENGL* api_mesh = new Mesh_OPENGL;
     api_mesh->m_vbo = vbo;
@@ -439,43 +720,162 @@ Error Renderer::create_mesh_api(str mesh_id) {
     gl->glObjectLabel(GL_BUFFER, vbo, -1, (mesh->m_name + "_vbo").c_str());
     gl->glObjectLabel(GL_BUFFER, ebo, -1, (mesh->m_name + "_ebo").c_str());
 #endif
+}
 
+Error Renderer::create_mesh_api(str mesh_id) {
+    // Pooled meshes are drawn from the buffers of their pool, reload_mesh_api creates the mesh
+    // buffers of those that don't end up in a pool.
+    if (!m_mesh_pooling) {
+        create_mesh_buffers(&m_meshes[mesh_id]);
+    }
     return Error();
 }
 
-Error Renderer::reload_mesh_api(str mesh_id) {
-    Mesh* mesh = &m_meshes[mesh_id];
-    Mesh_OPENGL* api_mesh = (Mesh_OPENGL*)mesh->m_api_data;
-
-    gl->glBindVertexArray(api_mesh->m_vao);
-    gl->glBindBuffer(GL_ARRAY_BUFFER, api_mesh->m_vbo);
-    gl->glBufferData(GL_ARRAY_BUFFER, mesh->m_vertices.size() * sizeof(f32),
-                     mesh->m_vertices.data(), GL_STATIC_DRAW);
-    gl->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, api_mesh->m_ebo);
-    gl->glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh->m_indices.size() * sizeof(u32),
-                     mesh->m_indices.data(), GL_STATIC_DRAW);
-
+// Expects the vertex array and the vertex buffer to be bound.
+static void set_vertex_attribs(const vec<pair<str, u32>>& attribs) {
     u32 attribs_stride = 0;
-    for (i32 i = 0; i < mesh->m_attribs.size(); i++) {
-        attribs_stride += mesh->m_attribs[i].second;
+    for (i32 i = 0; i < attribs.size(); i++) {
+        attribs_stride += attribs[i].second;
     }
     u32 attribs_offset = 0;
-    for (i32 i = 0; i < mesh->m_attribs.size(); i++) {
+    for (i32 i = 0; i < attribs.size(); i++) {
         gl->glEnableVertexAttribArray(i);
-        gl->glVertexAttribPointer(i, mesh->m_attribs[i].second, GL_FLOAT, GL_FALSE,
+        gl->glVertexAttribPointer(i, attribs[i].second, GL_FLOAT, GL_FALSE,
                                   attribs_stride * sizeof(f32),
                                   (void*)(attribs_offset * sizeof(f32)));
-        attribs_offset += mesh->m_attribs[i].second;
+        attribs_offset += attribs[i].second;
+    }
+}
+
+// The instance model matrix attributes are only enabled on the vertex arrays of meshes drawn
+// instanced, the first time they are.
+static void enable_instance_attribs() {
+    if (current_instance_attribs == NULL || *current_instance_attribs) {
+        return;
+    }
+    *current_instance_attribs = true;
+
+    gl->glBindBuffer(GL_ARRAY_BUFFER, instance_vbo);
+    for (u32 i = 0; i < 4; i++) {
+        u32 location = INSTANCE_MODEL_MAT_ATTRIB_LOCATION + i;
+        gl->glEnableVertexAttribArray(location);
+        gl->glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(Mat4),
+                                  (void*)(i * 4 * sizeof(f32)));
+        gl->glVertexAttribDivisor(location, 1);
+    }
+}
+
+// Returns a buffer of new_size bytes starting with the content of buffer, which is deleted.
+static GLuint grow_buffer(GLuint buffer, u64 size, u64 new_size) {
+    GLuint new_buffer;
+    gl->glGenBuffers(1, &new_buffer);
+    gl->glBindBuffer(GL_COPY_WRITE_BUFFER, new_buffer);
+    gl->glBufferData(GL_COPY_WRITE_BUFFER, new_size, NULL, GL_STATIC_DRAW);
+    if (buffer != 0) {
+        gl->glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        gl->glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, size);
+        gl->glDeleteBuffers(1, &buffer);
     }
+    return new_buffer;
+}
+
+static void upload_pooled_mesh(MeshPool* pool, Mesh* mesh) {
+    MeshPool_OPENGL* api_pool = (MeshPool_OPENGL*)pool->m_api_data;
+    if (api_pool == NULL) {
+        api_pool = new MeshPool_OPENGL;
+        gl->glGenVertexArrays(1, &api_pool->m_vao);
+        pool->m_api_data = api_pool;
+    }
+    bind_vertex_array(api_pool->m_vao);
+
+    u64 stride = 0;
+    for (const auto& attrib : pool->m_attribs) {
+        stride += attrib.second * sizeof(f32);
+    }
+    u64 vertex_bytes = pool->m_vertex_count * stride;
+    if (vertex_bytes > api_pool->m_vertex_bytes) {
+        u64 new_size = std::max(vertex_bytes, api_pool->m_vertex_bytes * 2);
+        api_pool->m_vbo = grow_buffer(api_pool->m_vbo, api_pool->m_vertex_bytes, new_size);
+        api_pool->m_vertex_bytes = new_size;
+        gl->glBindBuffer(GL_ARRAY_BUFFER, api_pool->m_vbo);
+        set_vertex_attribs(pool->m_attribs);
+    }
+    u64 index_bytes = pool->m_index_count * sizeof(u32);
+    if (index_bytes > api_pool->m_index_bytes) {
+        u64 new_size = std::max(index_bytes, api_pool->m_index_bytes * 2);
+        api_pool->m_ebo = grow_buffer(api_pool->m_ebo, api_pool->m_index_bytes, new_size);
+        api_pool->m_index_bytes = new_size;
+        gl->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, api_pool->m_ebo);
+    }
+
+    span<const f32> vertices = mesh_vertices(mesh);
+    span<const u32> indices = mesh_indices(mesh);
+    if (!vertices.empty()) {
+        gl->glBindBuffer(GL_ARRAY_BUFFER, api_pool->m_vbo);
+        gl->glBufferSubData(GL_ARRAY_BUFFER, mesh->m_pool_base_vertex * stride,
+                            vertices.size_bytes(), vertices.data());
+    }
+    if (!indices.empty()) {
+        gl->glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, mesh->m_pool_first_index * sizeof(u32),
+                            indices.size_bytes(), indices.data());
+    }
+}
+
+Error Renderer::reload_mesh_api(str mesh_id) {
+    Mesh* mesh = &m_meshes[mesh_id];
+    // Meshes loaded from a file are uploaded straight from the mapping.
+    span<const f32> vertices = mesh_vertices(mesh);
+    span<const u32> indices = mesh_indices(mesh);
+
+    if (mesh->m_pool != INVALID_INDEX) {
+        upload_pooled_mesh(&m_mesh_pools[mesh->m_pool], mesh);
+        m_frame_stats.m_buffer_bytes_uploaded += vertices.size_bytes() + indices.size_bytes();
+        mesh->m_should_reload = false;
+        return Error();
+    }
+
+    if (mesh->m_api_data == NULL) {
+        create_mesh_buffers(mesh);
+    }
+    Mesh_OPENGL* api_mesh = (Mesh_OPENGL*)mesh->m_api_data;
+    bind_vertex_array(api_mesh->m_vao);
+    gl->glBindBuffer(GL_ARRAY_BUFFER, api_mesh->m_vbo);
+    gl->glBufferData(GL_ARRAY_BUFFER, vertices.size_bytes(), vertices.data(), GL_STATIC_DRAW);
+    gl->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, api_mesh->m_ebo);
+    gl->glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size_bytes(), indices.data(),
+                     GL_STATIC_DRAW);
+    m_frame_stats.m_buffer_bytes_uploaded += vertices.size_bytes() + indices.size_bytes();
+
+    gl->glBindBuffer(GL_ARRAY_BUFFER, api_mesh->m_vbo);
+    set_vertex_attribs(mesh->m_attribs);
 
     mesh->m_should_reload = false;
 
     return Error();
 }
 
-void Renderer::set_current_mesh(str mesh_id) {
-    Mesh* mesh = &m_meshes[mesh_id];
-    gl->glBindVertexArray(((Mesh_OPENGL*)mesh->m_api_data)->m_vao);
+Error Renderer::set_instance_data(const Mat4* instance_data, u32 count) {
+    gl->glBindBuffer(GL_ARRAY_BUFFER, instance_vbo);
+    gl->glBufferData(GL_ARRAY_BUFFER, count * sizeof(Mat4), instance_data, GL_STREAM_DRAW);
+    m_frame_stats.m_buffer_bytes_uploaded += count * sizeof(Mat4);
+    return Error();
+}
+
+void Renderer::set_current_mesh(u32 mesh_index) {
+    Mesh* mesh = &m_meshes[mesh_index];
+    if (mesh->m_pool != INVALID_INDEX) {
+        MeshPool_OPENGL* api_pool = (MeshPool_OPENGL*)m_mesh_pools[mesh->m_pool].m_api_data;
+        bind_vertex_array(api_pool->m_vao);
+        current_instance_attribs = &api_pool->m_instance_attribs;
+        current_base_vertex = i32(mesh->m_pool_base_vertex);
+        current_first_index = mesh->m_pool_first_index;
+    } else {
+        Mesh_OPENGL* api_mesh = (Mesh_OPENGL*)mesh->m_api_data;
+        bind_vertex_array(api_mesh->m_vao);
+        current_instance_attribs = &api_mesh->m_instance_attribs;
+        current_base_vertex = 0;
+        current_first_index = 0;
+    }
 }
 
 Error Renderer::create_framebuffer_api(str framebuffer_id) {
@@ -483,7 +883,7 @@ Error Renderer::create_framebuffer_api(str framebuffer_id) {
 
     u32 fbo;
     gl->glGenFramebuffers(1, &fbo);
-    gl->glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    bind_framebuffer(fbo);
 
     Framebuffer_OPENGL* api_framebuffer = new Framebuffer_OPENGL;
     api_framebuffer->m_fbo = fbo;
@@ -493,7 +893,24 @@ Error Renderer::create_framebuffer_api(str framebuffer_id) {
     gl->glObjectLabel(GL_FRAMEBUFFER, fbo, -1, (framebuffer->m_name + "_framebuffer").c_str());
 #endif
 
-    gl->glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    bind_framebuffer(0);
+
+    return Error();
+}
+
+Error Renderer::destroy_framebuffer_api(u32 framebuffer_index) {
+    Framebuffer* framebuffer = &m_framebuffers[framebuffer_index];
+    Framebuffer_OPENGL* api_framebuffer = (Framebuffer_OPENGL*)framebuffer->m_api_data;
+    if (api_framebuffer == NULL) {
+        return Error();
+    }
+
+    if (state_cache.m_fbo == api_framebuffer->m_fbo) {
+        bind_framebuffer(0);
+    }
+    gl->glDeleteFramebuffers(1, &api_framebuffer->m_fbo);
+    delete api_framebuffer;
+    framebuffer->m_api_data = NULL;
 
     return Error();
 }
@@ -502,7 +919,7 @@ Error Renderer::attach_texture_to_framebuffer(str framebuffer_id) {
     Framebuffer* framebuffer = &m_framebuffers[framebuffer_id];
     Framebuffer_OPENGL* api_framebuffer = (Framebuffer_OPENGL*)framebuffer->m_api_data;
 
-    gl->glBindFramebuffer(GL_FRAMEBUFFER, api_framebuffer->m_fbo);
+    bind_framebuffer(api_framebuffer->m_fbo);
 
     Texture* texture;
 
@@ -536,18 +953,18 @@ Error Renderer::attach_texture_to_framebuffer(str framebuffer_id) {
         return Error("Framebuffer not complete");
     }
 
-    gl->glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    bind_framebuffer(0);
 
     return Error();
 }
 
-void Renderer::set_current_framebuffer(str framebuffer_id) {
-    Framebuffer* framebuffer = &m_framebuffers[framebuffer_id];
-    gl->glBindFramebuffer(GL_FRAMEBUFFER, ((Framebuffer_OPENGL*)framebuffer->m_api_data)->m_fbo);
+void Renderer::set_current_framebuffer(u32 framebuffer_index) {
+    Framebuffer* framebuffer = &m_framebuffers[framebuffer_index];
+    bind_framebuffer(((Framebuffer_OPENGL*)framebuffer->m_api_data)->m_fbo);
 }
 
 void Renderer::set_default_framebuffer() {
-    gl->glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    bind_framebuffer(0);
 }
 
 Error Renderer::create_uniform_buffer_api(str uniform_buffer_id) {
@@ -559,6 +976,7 @@ UniformBuffer* uniform_buffer = &m_uniform_buffers[uniform_buffer_id];
 
     UniformBuffer_OPENGL* api_uniform_buffer = new UniformBuffer_OPENGL;
     api_uniform_buffer->m_ubo = ubo;
+    api_uniform_buffer->m_bound_buffer = ubo;
     uniform_buffer->m_api_data = api_uniform_buffer;
 
 #ifdef DEBUG_RENDERER
@@ -568,15 +986,57 @@ UniformBuffer* uniform_buffer = &m_uniform_buffers[uniform_buffer_id];
     return Error();
 }
 
-Error Renderer::set_uniform_buffer_data(str uniform_buffer_id,
-                                        vec<pair<str, UniformValue>> uniform_values) {
-    UniformBuffer* uniform_buffer = &m_uniform_buffers[uniform_buffer_id];
-    gl->glBindBuffer(GL_UNIFORM_BUFFER, ((UniformBuffer_OPENGL*)uniform_buffer->m_api_data)->m_ubo);
-    for (auto& uniform_value : uniform_values) {
-        Uniform& uniform =
-            uniform_buffer->m_uniforms[uniform_buffer->m_uniforms_ids[uniform_value.first]];
-        gl->glBufferSubData(GL_UNIFORM_BUFFER, uniform.m_offset, uniform.m_size,
-                            &uniform_value.second);
+Error Renderer::flush_uniform_buffer_api(u32 uniform_buffer_index) {
+    UniformBuffer* uniform_buffer = &m_uniform_buffers[uniform_buffer_index];
+    UniformBuffer_OPENGL* api_uniform_buffer = (UniformBuffer_OPENGL*)uniform_buffer->m_api_data;
+    u32 dirty_begin = uniform_buffer->m_dirty_begin;
+    u32 dirty_size = uniform_buffer->m_dirty_end - dirty_begin;
+
+    if (api_uniform_buffer->m_ring_frame == uniform_ring.m_frame &&
+        api_uniform_buffer->m_ring_draw_count == uniform_ring.m_draw_count) {
+        memcopy(uniform_ring.m_mapped + api_uniform_buffer->m_bound_offset + dirty_begin,
+                uniform_buffer->m_data.data() + dirty_begin, dirty_size);
+        return Error();
+    }
+
+    u32 offset = (uniform_ring.m_offset + uniform_ring.m_alignment - 1) &
+                 ~(uniform_ring.m_alignment - 1);
+    if (offset + uniform_buffer->m_size <= UNIFORM_RING_FRAME_SIZE) {
+        // A new range has to hold the whole buffer, the draws already issued read the old one.
+        u32 ring_offset = uniform_ring.m_frame * UNIFORM_RING_FRAME_SIZE + offset;
+        memcopy(uniform_ring.m_mapped + ring_offset, uniform_buffer->m_data.data(),
+                uniform_buffer->m_size);
+        uniform_ring.m_offset = offset + uniform_buffer->m_size;
+
+        api_uniform_buffer->m_bound_buffer = uniform_ring.m_buffer;
+        api_uniform_buffer->m_bound_offset = ring_offset;
+        api_uniform_buffer->m_ring_frame = uniform_ring.m_frame;
+        api_uniform_buffer->m_ring_draw_count = uniform_ring.m_draw_count;
+    } else {
+        if (!uniform_ring.m_full_logged) {
+            logger.error("Renderer::flush_uniform_buffer_api: Uniform ring buffer is full");
+            uniform_ring.m_full_logged = true;
+        }
+        gl->glBindBuffer(GL_UNIFORM_BUFFER, api_uniform_buffer->m_ubo);
+        if (api_uniform_buffer->m_bound_buffer == api_uniform_buffer->m_ubo) {
+            gl->glBufferSubData(GL_UNIFORM_BUFFER, dirty_begin, dirty_size,
+                                uniform_buffer->m_data.data() + dirty_begin);
+        } else {
+            gl->glBufferSubData(GL_UNIFORM_BUFFER, 0, uniform_buffer->m_size,
+                                uniform_buffer->m_data.data());
+        }
+
+        api_uniform_buffer->m_bound_buffer = api_uniform_buffer->m_ubo;
+        api_uniform_buffer->m_bound_offset = 0;
+        api_uniform_buffer->m_ring_frame = UINT32_MAX;
+    }
+
+    u64 binding_points = api_uniform_buffer->m_binding_points;
+    for (u32 binding_point = 0; binding_points != 0; binding_point++, binding_points >>= 1) {
+        if (binding_points & 1) {
+            bind_uniform_buffer_range(binding_point, api_uniform_buffer->m_bound_buffer,
+                                      api_uniform_buffer->m_bound_offset, uniform_buffer->m_size);
+        }
     }
     return Error();
 }
@@ -589,7 +1049,11 @@ Error Renderer::create_texture_api(str texture_id) {
 
     GLenum texture_target = opengl_texture_targets[texture->m_texture_params.m_target];
 
-    gl->glBindTexture(texture_target, texture_name);
+    if (texture_target == GL_TEXTURE_2D) {
+        bind_texture_2d(texture_name);
+    } else {
+        gl->glBindTexture(texture_target, texture_name);
+    }
 
     auto& texture_format = opengl_texture_formats[texture->m_texture_params.m_format];
 
@@ -637,7 +1101,7 @@ Error Renderer::reload_texture_api(str texture_id) {
     GLenum texture_target = opengl_texture_targets[texture->m_texture_params.m_target];
 
     if (texture_target == GL_TEXTURE_2D) {
-        gl->glBindTexture(GL_TEXTURE_2D, ((Texture_OPENGL*)texture->m_api_data)->m_texture_name);
+        bind_texture_2d(((Texture_OPENGL*)texture->m_api_data)->m_texture_name);
         auto& texture_type = opengl_texture_formats[texture->m_texture_params.m_format];
 
         if (get<2>(texture_type) == GL_FLOAT) {
@@ -651,6 +1115,8 @@ Error Renderer::reload_texture_api(str texture_id) {
         }
 
         gl->glGenerateMipmap(GL_TEXTURE_2D);
+        m_frame_stats.m_texture_bytes_uploaded +=
+            texture->m_data.size() + texture->m_float_data.size() * sizeof(f32);
     }
 
     texture->m_should_reload = false;
@@ -658,29 +1124,55 @@ Error Renderer::reload_texture_api(str texture_id) {
     return Error();
 }
 
-void Renderer::bind_uniforms(Pass* pass, str shader_id) {
-    for (const auto& uniform_binding : m_shaders[shader_id].m_uniform_bindings) {
-        u32 binding_point = uniform_binding.second.m_binding_point;
-        if (uniform_binding.second.m_type == UniformBindingType::BLOCK) {
-            UniformBuffer* uniform_buffer = &m_uniform_buffers[uniform_binding.first];
-            gl->glBindBufferRange(GL_UNIFORM_BUFFER, binding_point,
-                                  ((UniformBuffer_OPENGL*)uniform_buffer->m_api_data)->m_ubo, 0,
-                                  uniform_buffer->m_size);
-        } else if (uniform_binding.second.m_type == UniformBindingType::SAMPLER) {
-            str texture_id = pass->m_sampler_uniforms_bindings.at(uniform_binding.first);
-            gl->glActiveTexture(GL_TEXTURE0 + binding_point);
-            Texture* texture = &m_textures[texture_id];
-            gl->glBindTexture(GL_TEXTURE_2D,
-                              ((Texture_OPENGL*)texture->m_api_data)->m_texture_name);
-
-        } else if (uniform_binding.second.m_type == UniformBindingType::IMAGE) {
-            pair<str, AccessType> image_uniform_binding =
-                pass->m_image_uniforms_bindings.at(uniform_binding.first);
-            str texture_id = image_uniform_binding.first;
-            Texture* texture = &m_textures[texture_id];
+Error Renderer::destroy_texture_api(u32 texture_index) {
+    Texture* texture = &m_textures[texture_index];
+    Texture_OPENGL* api_texture = (Texture_OPENGL*)texture->m_api_data;
+    if (api_texture == NULL) {
+        return Error();
+    }
+
+    for (u32 i = 0; i < MAX_CACHED_TEXTURE_UNITS; i++) {
+        if (state_cache.m_textures[i] == api_texture->m_texture_name) {
+            state_cache.m_textures[i] = 0;
+        }
+    }
+    gl->glDeleteTextures(1, &api_texture->m_texture_name);
+    delete api_texture;
+    texture->m_api_data = NULL;
+
+    return Error();
+}
+
+void Renderer::bind_uniforms(const PassBinding* bindings, u32 count) {
+    for (u32 i = 0; i < count; i++) {
+        const PassBinding& binding = bindings[i];
+        if (binding.m_type == UniformBindingType::BLOCK) {
+            UniformBuffer* uniform_buffer = &m_uniform_buffers[binding.m_resource];
+            UniformBuffer_OPENGL* api_uniform_buffer =
+                (UniformBuffer_OPENGL*)uniform_buffer->m_api_data;
+            bind_uniform_buffer_range(binding.m_binding_point, api_uniform_buffer->m_bound_buffer,
+                                      api_uniform_buffer->m_bound_offset, uniform_buffer->m_size);
+            if (binding.m_binding_point < MAX_UNIFORM_BINDING_POINTS) {
+                u32* bound = &uniform_ring.m_bound_uniform_buffers[binding.m_binding_point];
+                u64 binding_point_bit = u64(1) << binding.m_binding_point;
+                if (*bound != INVALID_INDEX && *bound != binding.m_resource) {
+                    UniformBuffer_OPENGL* previous =
+                        (UniformBuffer_OPENGL*)m_uniform_buffers[*bound].m_api_data;
+                    previous->m_binding_points &= ~binding_point_bit;
+                }
+                *bound = binding.m_resource;
+                api_uniform_buffer->m_binding_points |= binding_point_bit;
+            }
+        } else if (binding.m_type == UniformBindingType::SAMPLER) {
+            active_texture(binding.m_binding_point);
+            Texture* texture = &m_textures[binding.m_resource];
+            bind_texture_2d(((Texture_OPENGL*)texture->m_api_data)->m_texture_name);
+
+        } else if (binding.m_type == UniformBindingType::IMAGE) {
+            Texture* texture = &m_textures[binding.m_resource];
             gl->glBindImageTexture(
-                binding_point, ((Texture_OPENGL*)texture->m_api_data)->m_texture_name, 0, GL_FALSE,
-                0, opengl_access_types[image_uniform_binding.second], GL_RGBA32F);
+                binding.m_binding_point, ((Texture_OPENGL*)texture->m_api_data)->m_texture_name, 0,
+                GL_FALSE, 0, opengl_access_types[binding.m_access], GL_RGBA32F);
         }
     }
 }
@@ -694,10 +1186,22 @@ void Renderer::debug_marker_end() {
 }
 
 void Renderer::set_viewport(u32 x, u32 y, u32 width, u32 height) {
-    gl->glViewport(x, y, width, height);
+    GLint* viewport = state_cache.m_viewport;
+    if (state_changed(viewport[0] != GLint(x) || viewport[1] != GLint(y) ||
+                      viewport[2] != GLint(width) || viewport[3] != GLint(height))) {
+        viewport[0] = x;
+        viewport[1] = y;
+        viewport[2] = width;
+        viewport[3] = height;
+        gl->glViewport(x, y, width, height);
+    }
 }
 
 void Renderer::set_depth_test(bool enabled) {
+    if (!state_changed(state_cache.m_depth_test != i32(enabled))) {
+        return;
+    }
+    state_cache.m_depth_test = enabled;
     if (enabled) {
         gl->glEnable(GL_DEPTH_TEST);
     } else {
@@ -706,39 +1210,86 @@ void Renderer::set_depth_test(bool enabled) {
 }
 
 void Renderer::set_face_culling(bool enabled, CullingMode mode, CullingOrder order) {
-    if (enabled) {
-        gl->glEnable(GL_CULL_FACE);
-    } else {
-        gl->glDisable(GL_CULL_FACE);
+    if (state_changed(state_cache.m_cull_face != i32(enabled))) {
+        state_cache.m_cull_face = enabled;
+        if (enabled) {
+            gl->glEnable(GL_CULL_FACE);
+        } else {
+            gl->glDisable(GL_CULL_FACE);
+        }
     }
 
-    if (mode == CullingMode::BACK) {
-        gl->glCullFace(GL_BACK);
-    } else if (mode == CullingMode::FRONT) {
-        gl->glCullFace(GL_FRONT);
+    GLenum cull_face_mode = mode == CullingMode::FRONT ? GL_FRONT : GL_BACK;
+    if (state_changed(state_cache.m_cull_face_mode != cull_face_mode)) {
+        state_cache.m_cull_face_mode = cull_face_mode;
+        gl->glCullFace(cull_face_mode);
     }
 
-    if (order == CullingOrder::CCW) {
-        gl->glFrontFace(GL_CCW);
-    } else if (order == CullingOrder::CW) {
-        gl->glFrontFace(GL_CW);
+    GLenum front_face = order == CullingOrder::CW ? GL_CW : GL_CCW;
+    if (state_changed(state_cache.m_front_face != front_face)) {
+        state_cache.m_front_face = front_face;
+        gl->glFrontFace(front_face);
     }
 }
 
 void Renderer::draw(MeshPrimitive primitive, size_t count) {
+    uniform_ring.m_draw_count++;
     gl->glDrawArrays(opengl_mesh_primitive_types[primitive], 0, GLsizei(count));
 }
 
-void Renderer::draw_indexed(MeshPrimitive primitive, size_t count) {
-    gl->glDrawElements(opengl_mesh_primitive_types[primitive], GLsizei(count), GL_UNSIGNED_INT, 0);
+static const void* index_offset(u32 first_index) {
+    return (const void*)(uintptr_t(current_first_index + first_index) * sizeof(u32));
+}
+
+void Renderer::draw_indexed(MeshPrimitive primitive, size_t count, u32 first_index) {
+    uniform_ring.m_draw_count++;
+    gl->glDrawElementsBaseVertex(opengl_mesh_primitive_types[primitive], GLsizei(count),
+                                 GL_UNSIGNED_INT, index_offset(first_index),
+                                 current_base_vertex);
+}
+
+void Renderer::draw_indexed_instanced(MeshPrimitive primitive, size_t count, u32 instance_count,
+                                      u32 first_instance, u32 first_index) {
+    uniform_ring.m_draw_count++;
+    enable_instance_attribs();
+    gl->glDrawElementsInstancedBaseVertexBaseInstance(
+        opengl_mesh_primitive_types[primitive], GLsizei(count), GL_UNSIGNED_INT,
+        index_offset(first_index), instance_count, current_base_vertex, first_instance);
+}
+
+void Renderer::multi_draw_indexed(MeshPrimitive primitive, const u32* counts,
+                                  const u32* first_indices, u32 draw_count) {
+    uniform_ring.m_draw_count++;
+    multi_draw_offsets.resize(draw_count);
+    multi_draw_base_vertices.assign(draw_count, current_base_vertex);
+    for (u32 i = 0; i < draw_count; i++) {
+        multi_draw_offsets[i] = index_offset(first_indices[i]);
+    }
+    gl->glMultiDrawElementsBaseVertex(opengl_mesh_primitive_types[primitive],
+                                      (const GLsizei*)counts, GL_UNSIGNED_INT,
+                                      multi_draw_offsets.data(), GLsizei(draw_count),
+                                      multi_draw_base_vertices.data());
+}
+
+void Renderer::multi_draw_indexed_indirect(MeshPrimitive primitive,
+                                           const DrawIndirectCommand* draws, u32 draw_count) {
+    uniform_ring.m_draw_count++;
+    enable_instance_attribs();
+    gl->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect_buffer);
+    gl->glBufferData(GL_DRAW_INDIRECT_BUFFER, draw_count * sizeof(DrawIndirectCommand), draws,
+                     GL_STREAM_DRAW);
+    m_frame_stats.m_buffer_bytes_uploaded += draw_count * sizeof(DrawIndirectCommand);
+    gl->glMultiDrawElementsIndirect(opengl_mesh_primitive_types[primitive], GL_UNSIGNED_INT, NULL,
+                                    GLsizei(draw_count), 0);
 }
 
 void Renderer::dispatch_compute(u32 num_groups_x, u32 num_groups_y, u32 num_groups_z) {
+    uniform_ring.m_draw_count++;
     gl->glDispatchCompute(num_groups_x, num_groups_y, num_groups_z);
     gl->glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
 }
 
-void Renderer::copy_texture(str src, str dst, Vec3I src_pos, Vec2I src_size, Vec3I dst_pos) {
+void Renderer::copy_texture(u32 src, u32 dst, Vec3I src_pos, Vec2I src_size, Vec3I dst_pos) {
     Texture* src_texture = &m_textures[src];
     Texture_OPENGL* src_api_texture = (Texture_OPENGL*)src_texture->m_api_data;
 
@@ -3,6 +3,7 @@
 #include <GLES3/gl2ext.h>
 #include <emscripten/html5.h>
 
+#include <algorithm>
 #include <unordered_map>
 #include <utility>
 
@@ -45,10 +46,13 @@ static std::unordered_map<TextureFormat, std::tuple<GLint, GLenum, GLenum>> open
         {TextureFormat::RG8, {GL_RG8, GL_RG, GL_UNSIGNED_BYTE}},
         {TextureFormat::RGB8, {GL_RGB8, GL_RGB, GL_UNSIGNED_BYTE}},
         {TextureFormat::RGBA8, {GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE}},
+        {TextureFormat::RGB16F, {GL_RGB16F, GL_RGB, GL_FLOAT}},
         {TextureFormat::RGB32F, {GL_RGB32F, GL_RGB, GL_FLOAT}},
         {TextureFormat::RGBA32F, {GL_RGBA32F, GL_RGBA, GL_FLOAT}},
-        {TextureFormat::DEPTH32, {GL_DEPTH_COMPONENT, GL_DEPTH_COMPONENT, GL_UNSIGNED_BYTE}},
-        {TextureFormat::DEPTH32F, {GL_DEPTH_COMPONENT32F, GL_DEPTH_COMPONENT, GL_UNSIGNED_BYTE}},
+        {TextureFormat::DEPTH32, {GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT}},
+        {TextureFormat::DEPTH32F, {GL_DEPTH_COMPONENT32F, GL_DEPTH_COMPONENT, GL_FLOAT}},
+        {TextureFormat::R32F, {GL_R32F, GL_RED, GL_FLOAT}},
+        {TextureFormat::RG32F, {GL_RG32F, GL_RG, GL_FLOAT}},
 };
 
 static std::unordered_map<TextureWrapMode, GLenum> opengl_texture_wrap_modes = {
@@ -57,12 +61,6 @@ static std::unordered_map<TextureWrapMode, GLenum> opengl_texture_wrap_modes = {
     {TextureWrapMode::CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE},
 };
 
-static std::unordered_map<AttachementPoint, GLenum> opengl_attachment_point = {
-    {AttachementPoint::COLOR_ATTACHMENT, GL_COLOR_ATTACHMENT0},
-    {AttachementPoint::DEPTH_ATTACHMENT, GL_DEPTH_ATTACHMENT},
-    {AttachementPoint::STENCIL_ATTACHMENT, GL_STENCIL_ATTACHMENT},
-};
-
 static std::unordered_map<TextureFilteringMode, GLenum> opengl_texture_filtering_modes = {
     {TextureFilteringMode::NEAREST, GL_NEAREST},
     {TextureFilteringMode::LINEAR, GL_LINEAR},
@@ -73,7 +71,15 @@ static std::unordered_map<MeshPrimitive, GLenum> opengl_mesh_primitive_types = {
     {MeshPrimitive::LINES, GL_LINES},
 };
 
+static std::unordered_map<TextureTarget, GLenum> opengl_texture_targets = {
+    {TextureTarget::TEXTURE_2D, GL_TEXTURE_2D},
+    {TextureTarget::TEXTURE_CUBE_MAP, GL_TEXTURE_CUBE_MAP},
+};
+
 GLuint dummy_vao;
+GLuint instance_vbo;
+// Read framebuffer of copy_texture, attached to the source texture of each copy.
+GLuint copy_fbo;
 
 Error Renderer::init_api() {
     EmscriptenWebGLContextAttributes attributes;
@@ -99,6 +105,12 @@ Error Renderer::init_api() {
 
     glGenVertexArrays(1, &dummy_vao);
 
+    glGenBuffers(1, &instance_vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, instance_vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(Mat4), NULL, GL_STREAM_DRAW);
+
+    glGenFramebuffers(1, &copy_fbo);
+
     return Error();
 }
 
@@ -123,6 +135,23 @@ void Renderer::present() {
 void Renderer::set_swap_interval(u32 interval) {
 }
 
+// The browser owns the WebGL context and there is no render thread, the context stays current.
+void Renderer::make_context_current() {
+}
+
+void Renderer::release_context() {
+}
+
+void Renderer::begin_gpu_frame_timer() {
+}
+
+void Renderer::end_gpu_frame_timer() {
+}
+
+f32 Renderer::last_gpu_frame_time_ms() {
+    return 0;
+}
+
 Error Renderer::create_shader_api(str shader_id) {
     Shader* shader = &m_shaders[shader_id];
 
@@ -130,27 +159,25 @@ Error Renderer::create_shader_api(str shader_id) {
         return Error("Compute shaders not available in WebGL");
     }
 
-    GLuint shader_program;
-    shader_program = glCreateProgram();
     Shader_OPENGL* api_shader = new Shader_OPENGL;
-    api_shader->m_program = shader_program;
-
-    GLuint vertex_shader;
-    GLuint fragment_shader;
-
-    vertex_shader = glCreateShader(GL_VERTEX_SHADER);
-    fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
-    glAttachShader(shader_program, vertex_shader);
-    glAttachShader(shader_program, fragment_shader);
-
-    api_shader->m_vertex_shader = vertex_shader;
-    api_shader->m_fragment_shader = fragment_shader;
-
     shader->m_api_data = api_shader;
 
     return Error();
 }
 
+// Vertex shaders read the model matrix from a_instance_model_mat when INSTANCING is defined, and
+// from u_model_mat otherwise. The define goes after the #version line, which has to be first.
+static str define_instancing(const str& source) {
+    size_t version_end = source.starts_with("#version") ? source.find('\n') : 0;
+    if (version_end == str::npos) {
+        return source;
+    }
+    if (version_end > 0) {
+        version_end++;
+    }
+    return source.substr(0, version_end) + "#define INSTANCING\n" + source.substr(version_end);
+}
+
 Error Renderer::reload_shader_api(str shader_id) {
     Shader* shader = &m_shaders[shader_id];
     if (shader->m_type == ShaderType::COMPUTE) {
@@ -161,7 +188,24 @@ Error Renderer::reload_shader_api(str shader_id) {
     int success;
     char info[512];
 
-    const char* c_str = shader->m_vertex_shader_source.c_str();
+    if (api_shader->m_vertex_shader) {
+        glDeleteShader(api_shader->m_vertex_shader);
+    }
+    if (api_shader->m_fragment_shader) {
+        glDeleteShader(api_shader->m_fragment_shader);
+    }
+    if (api_shader->m_program) {
+        glDeleteProgram(api_shader->m_program);
+    }
+
+    api_shader->m_program = glCreateProgram();
+    api_shader->m_vertex_shader = glCreateShader(GL_VERTEX_SHADER);
+    api_shader->m_fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
+    glAttachShader(api_shader->m_program, api_shader->m_vertex_shader);
+    glAttachShader(api_shader->m_program, api_shader->m_fragment_shader);
+
+    str vertex_shader_source = define_instancing(shader->m_vertex_shader_source);
+    const char* c_str = vertex_shader_source.c_str();
     glShaderSource(api_shader->m_vertex_shader, 1, &c_str, NULL);
     glCompileShader(api_shader->m_vertex_shader);
 
@@ -169,7 +213,8 @@ Error Renderer::reload_shader_api(str shader_id) {
     if (!success) {
         glGetShaderInfoLog(api_shader->m_vertex_shader, 512, NULL, info);
         glDeleteShader(api_shader->m_vertex_shader);
-        return Error("Renderer::compile_shader: Failed to compile vertex shader \"" +
+        api_shader->m_vertex_shader = 0;
+        return Error("Renderer::reload_shader_api: Failed to compile vertex shader \"" +
                      shader->m_name + "\" : " + str(info));
     }
 
@@ -180,7 +225,8 @@ Error Renderer::reload_shader_api(str shader_id) {
     if (!success) {
         glGetShaderInfoLog(api_shader->m_fragment_shader, 512, NULL, info);
         glDeleteShader(api_shader->m_fragment_shader);
-        return Error("Renderer::compile_shader: Failed to compile fragment shader \"" +
+        api_shader->m_fragment_shader = 0;
+        return Error("Renderer::reload_shader_api: Failed to compile fragment shader \"" +
                      shader->m_name + "\" : " + str(info));
     }
 
@@ -189,37 +235,69 @@ Error Renderer::reload_shader_api(str shader_id) {
     if (!success) {
         glGetProgramInfoLog(api_shader->m_program, 512, NULL, info);
         glDeleteProgram(api_shader->m_program);
-        return Error("Renderer::compile_shader: Failed to link shader program \"" + shader->m_name +
-                     "\" : " + str(info));
+        api_shader->m_program = 0;
+        return Error("Renderer::reload_shader_api: Failed to link shader program \"" +
+                     shader->m_name + "\" : " + str(info));
     }
 
+    glUseProgram(api_shader->m_program);
+
+    GLint instance_attrib_location =
+        glGetAttribLocation(api_shader->m_program, "a_instance_model_mat");
+    shader->m_instanced = instance_attrib_location == INSTANCE_MODEL_MAT_ATTRIB_LOCATION;
+    if (instance_attrib_location != -1 && !shader->m_instanced) {
+        logger.error("Renderer::reload_shader_api: a_instance_model_mat in shader \"" +
+                     shader->m_name + "\" must use location " +
+                     std::to_string(INSTANCE_MODEL_MAT_ATTRIB_LOCATION));
+    }
+
+    // GLSL ES has no binding layout qualifier, samplers and uniform blocks get the next free
+    // texture unit and binding point of the program.
+    shader->m_uniform_bindings.clear();
+
     GLint n_uniforms, max_len;
     glGetProgramiv(api_shader->m_program, GL_ACTIVE_UNIFORMS, &n_uniforms);
     glGetProgramiv(api_shader->m_program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_len);
-    GLchar* uniform_name = (GLchar*)malloc(max_len);
+    vec<GLchar> uniform_name(std::max(max_len, 1));
+
+    u32 texture_unit = 0;
+    for (GLint i = 0; i < n_uniforms; i++) {
+        GLint size = -1;
+        GLenum type = -1;
+        glGetActiveUniform(api_shader->m_program, i, max_len, NULL, &size, &type,
+                           uniform_name.data());
+        if (type == GL_SAMPLER_2D || type == GL_SAMPLER_CUBE || type == GL_SAMPLER_2D_ARRAY ||
+            type == GL_SAMPLER_3D) {
+            GLint location = glGetUniformLocation(api_shader->m_program, uniform_name.data());
+            glUniform1i(location, texture_unit);
+            shader->m_uniform_bindings[uniform_name.data()] =
+                UniformBinding(texture_unit, UniformBindingType::SAMPLER);
+            texture_unit++;
+        }
+    }
 
-    glUseProgram(api_shader->m_program);
+    GLint n_uniform_blocks;
+    glGetProgramiv(api_shader->m_program, GL_ACTIVE_UNIFORM_BLOCKS, &n_uniform_blocks);
+    glGetProgramiv(api_shader->m_program, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &max_len);
+    vec<GLchar> uniform_block_name(std::max(max_len, 1));
 
-    if (uniform_name != NULL) {
-        for (i32 i = 0; i < n_uniforms; i++) {
-            GLint size = -1;
-            GLenum type = -1;
-            glGetActiveUniform(api_shader->m_program, i, max_len, NULL, &size, &type, uniform_name);
-            if (type == GL_SAMPLER_2D) {
-                GLint location = glGetUniformLocation(api_shader->m_program, uniform_name);
-                GLint binding_point;
-                glGetUniformiv(api_shader->m_program, location, &binding_point);
-                shader->m_sampler_binding_points[uniform_name] = binding_point;
-            }
-        }
+    for (GLint i = 0; i < n_uniform_blocks; i++) {
+        GLint name_len;
+        glGetActiveUniformBlockName(api_shader->m_program, i, max_len, &name_len,
+                                    uniform_block_name.data());
+        uniform_block_name[name_len] = '\0';
+
+        glUniformBlockBinding(api_shader->m_program, i, i);
+        shader->m_uniform_bindings[str(uniform_block_name.data())] =
+            UniformBinding(i, UniformBindingType::BLOCK);
     }
 
     shader->m_should_reload = false;
     return Error();
 }
 
-void Renderer::set_current_shader(str shader_id) {
-    Shader* shader = &m_shaders[shader_id];
+void Renderer::set_current_shader(u32 shader_index) {
+    Shader* shader = &m_shaders[shader_index];
     glUseProgram(((Shader_OPENGL*)shader->m_api_data)->m_program);
 }
 
@@ -250,11 +328,12 @@ Error Renderer::reload_mesh_api(str mesh_id) {
 
     glBindVertexArray(api_mesh->m_vao);
     glBindBuffer(GL_ARRAY_BUFFER, api_mesh->m_vbo);
-    glBufferData(GL_ARRAY_BUFFER, mesh->m_vertices.size() * sizeof(f32), mesh->m_vertices.data(),
-                 GL_STATIC_DRAW);
+    span<const f32> vertices = mesh_vertices(mesh);
+    span<const u32> indices = mesh_indices(mesh);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size_bytes(), vertices.data(), GL_STATIC_DRAW);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, api_mesh->m_ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh->m_indices.size() * sizeof(u32),
-                 mesh->m_indices.data(), GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size_bytes(), indices.data(), GL_STATIC_DRAW);
+    m_frame_stats.m_buffer_bytes_uploaded += vertices.size_bytes() + indices.size_bytes();
 
     u32 attribs_stride = 0;
     for (i32 i = 0; i < mesh->m_attribs.size(); i++) {
@@ -273,8 +352,29 @@ Error Renderer::reload_mesh_api(str mesh_id) {
     return Error();
 }
 
-void Renderer::set_current_mesh(str mesh_id) {
-    Mesh* mesh = &m_meshes[mesh_id];
+Error Renderer::set_instance_data(const Mat4* instance_data, u32 count) {
+    glBindBuffer(GL_ARRAY_BUFFER, instance_vbo);
+    glBufferData(GL_ARRAY_BUFFER, count * sizeof(Mat4), instance_data, GL_STREAM_DRAW);
+    m_frame_stats.m_buffer_bytes_uploaded += count * sizeof(Mat4);
+    return Error();
+}
+
+// WebGL has no base instance, the instance model matrix attributes of the current vertex array
+// start at first_instance instead.
+static void set_instance_attribs(u32 first_instance) {
+    glBindBuffer(GL_ARRAY_BUFFER, instance_vbo);
+    for (u32 i = 0; i < 4; i++) {
+        u32 location = INSTANCE_MODEL_MAT_ATTRIB_LOCATION + i;
+        glEnableVertexAttribArray(location);
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(Mat4),
+                              (void*)(uintptr_t(first_instance) * sizeof(Mat4) +
+                                      i * 4 * sizeof(f32)));
+        glVertexAttribDivisor(location, 1);
+    }
+}
+
+void Renderer::set_current_mesh(u32 mesh_index) {
+    Mesh* mesh = &m_meshes[mesh_index];
     glBindVertexArray(((Mesh_OPENGL*)mesh->m_api_data)->m_vao);
 }
 
@@ -294,24 +394,53 @@ Error Renderer::create_framebuffer_api(str framebuffer_id) {
     return Error();
 }
 
-Error Renderer::attach_texture_to_framebuffer(str framebuffer_id, str texture_id,
-                                              AttachementPoint attachment_point) {
-    Texture* texture = &m_textures[texture_id];
-    Texture_OPENGL* api_texture = (Texture_OPENGL*)texture->m_api_data;
+Error Renderer::destroy_framebuffer_api(u32 framebuffer_index) {
+    Framebuffer* framebuffer = &m_framebuffers[framebuffer_index];
+    Framebuffer_OPENGL* api_framebuffer = (Framebuffer_OPENGL*)framebuffer->m_api_data;
+    if (api_framebuffer == NULL) {
+        return Error();
+    }
 
+    glDeleteFramebuffers(1, &api_framebuffer->m_fbo);
+    delete api_framebuffer;
+    framebuffer->m_api_data = NULL;
+
+    return Error();
+}
+
+Error Renderer::attach_texture_to_framebuffer(str framebuffer_id) {
     Framebuffer* framebuffer = &m_framebuffers[framebuffer_id];
     Framebuffer_OPENGL* api_framebuffer = (Framebuffer_OPENGL*)framebuffer->m_api_data;
 
     glBindFramebuffer(GL_FRAMEBUFFER, api_framebuffer->m_fbo);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, opengl_attachment_point[attachment_point], GL_TEXTURE_2D,
-                           ((Texture_OPENGL*)texture->m_api_data)->m_texture_name, 0);
 
-    if (attachment_point == AttachementPoint::COLOR_ATTACHMENT) {
-        framebuffer->m_color_attachment_texture = texture_id;
-    } else if (attachment_point == AttachementPoint::DEPTH_ATTACHMENT) {
-        framebuffer->m_depth_attachment_texture = texture_id;
-    } else if (attachment_point == AttachementPoint::STENCIL_ATTACHMENT) {
-        framebuffer->m_stencil_attachment_texture = texture_id;
+    Texture* texture;
+
+    bool no_color_attachment = true;
+
+    if (framebuffer->m_color_attachment_texture != "") {
+        texture = &m_textures[framebuffer->m_color_attachment_texture];
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                               ((Texture_OPENGL*)texture->m_api_data)->m_texture_name, 0);
+        no_color_attachment = false;
+    }
+
+    if (framebuffer->m_depth_attachment_texture != "") {
+        texture = &m_textures[framebuffer->m_depth_attachment_texture];
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D,
+                               ((Texture_OPENGL*)texture->m_api_data)->m_texture_name, 0);
+    }
+
+    if (framebuffer->m_stencil_attachment_texture != "") {
+        texture = &m_textures[framebuffer->m_stencil_attachment_texture];
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_STENCIL_ATTACHMENT, GL_TEXTURE_2D,
+                               ((Texture_OPENGL*)texture->m_api_data)->m_texture_name, 0);
+    }
+
+    if (no_color_attachment) {
+        GLenum draw_buffer = GL_NONE;
+        glDrawBuffers(1, &draw_buffer);
+        glReadBuffer(GL_NONE);
     }
 
     if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
@@ -323,8 +452,8 @@ Error Renderer::attach_texture_to_framebuffer(str framebuffer_id, str texture_id
     return Error();
 }
 
-void Renderer::set_current_framebuffer(str framebuffer_id) {
-    Framebuffer* framebuffer = &m_framebuffers[framebuffer_id];
+void Renderer::set_current_framebuffer(u32 framebuffer_index) {
+    Framebuffer* framebuffer = &m_framebuffers[framebuffer_index];
     glBindFramebuffer(GL_FRAMEBUFFER, ((Framebuffer_OPENGL*)framebuffer->m_api_data)->m_fbo);
 }
 
@@ -337,9 +466,7 @@ Error Renderer::create_uniform_buffer_api(str uniform_buffer_id) {
     GLuint ubo;
     glGenBuffers(1, &ubo);
     glBindBuffer(GL_UNIFORM_BUFFER, ubo);
-    glBufferData(GL_UNIFORM_BUFFER, uniform_buffer->m_size, NULL, GL_STATIC_DRAW);
-    glBindBufferRange(GL_UNIFORM_BUFFER, uniform_buffer->m_binding_point, ubo, 0,
-                      uniform_buffer->m_size);
+    glBufferData(GL_UNIFORM_BUFFER, uniform_buffer->m_size, NULL, GL_DYNAMIC_DRAW);
 
     UniformBuffer_OPENGL* api_uniform_buffer = new UniformBuffer_OPENGL;
     api_uniform_buffer->m_ubo = ubo;
@@ -348,13 +475,15 @@ Error Renderer::create_uniform_buffer_api(str uniform_buffer_id) {
     return Error();
 }
 
-Error Renderer::set_uniform_buffer_data(str uniform_buffer_id, str uniform_name,
-                                        UniformValue value) {
-    UniformBuffer* uniform_buffer = &m_uniform_buffers[uniform_buffer_id];
-    glBindBuffer(GL_UNIFORM_BUFFER, ((UniformBuffer_OPENGL*)uniform_buffer->m_api_data)->m_ubo);
-    Uniform& uniform = uniform_buffer->m_uniforms[uniform_buffer->m_uniforms_ids[uniform_name]];
-    glBufferSubData(GL_UNIFORM_BUFFER, uniform.m_offset, uniform.m_size, &value);
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+Error Renderer::flush_uniform_buffer_api(u32 uniform_buffer_index) {
+    UniformBuffer* uniform_buffer = &m_uniform_buffers[uniform_buffer_index];
+    UniformBuffer_OPENGL* api_uniform_buffer = (UniformBuffer_OPENGL*)uniform_buffer->m_api_data;
+    u32 dirty_begin = uniform_buffer->m_dirty_begin;
+    u32 dirty_size = uniform_buffer->m_dirty_end - dirty_begin;
+
+    glBindBuffer(GL_UNIFORM_BUFFER, api_uniform_buffer->m_ubo);
+    glBufferSubData(GL_UNIFORM_BUFFER, dirty_begin, dirty_size,
+                    uniform_buffer->m_data.data() + dirty_begin);
     return Error();
 }
 
@@ -363,20 +492,33 @@ Error Renderer::create_texture_api(str texture_id) {
 
     u32 texture_name;
     glGenTextures(1, &texture_name);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S,
+
+    GLenum texture_target = opengl_texture_targets[texture->m_texture_params.m_target];
+    glBindTexture(texture_target, texture_name);
+
+    auto& texture_format = opengl_texture_formats[texture->m_texture_params.m_format];
+
+    if (texture_target == GL_TEXTURE_2D) {
+        glTexImage2D(texture_target, 0, get<0>(texture_format), texture->m_width,
+                     texture->m_height, 0, get<1>(texture_format), get<2>(texture_format), NULL);
+    } else if (texture_target == GL_TEXTURE_CUBE_MAP) {
+        for (u32 i = 0; i < 6; i++) {
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, get<0>(texture_format),
+                         texture->m_width, texture->m_height, 0, get<1>(texture_format),
+                         get<2>(texture_format), NULL);
+        }
+    }
+
+    glTexParameteri(texture_target, GL_TEXTURE_WRAP_S,
                     opengl_texture_wrap_modes[texture->m_texture_params.m_wrap_mode_s]);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T,
+    glTexParameteri(texture_target, GL_TEXTURE_WRAP_T,
                     opengl_texture_wrap_modes[texture->m_texture_params.m_wrap_mode_t]);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+    glTexParameteri(texture_target, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glTexParameteri(texture_target, GL_TEXTURE_MIN_FILTER,
                     opengl_texture_filtering_modes[texture->m_texture_params.m_filter_mode_min]);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER,
+    glTexParameteri(texture_target, GL_TEXTURE_MAG_FILTER,
                     opengl_texture_filtering_modes[texture->m_texture_params.m_filter_mode_mag]);
 
-    glBindTexture(GL_TEXTURE_2D, texture_name);
-    auto& texture_type = opengl_texture_formats[texture->m_texture_params.m_format];
-    glTexImage2D(GL_TEXTURE_2D, 0, get<0>(texture_type), texture->m_width, texture->m_height, 0,
-                 get<1>(texture_type), get<2>(texture_type), NULL);
-
     Texture_OPENGL* api_texture = new Texture_OPENGL;
     api_texture->m_texture_name = texture_name;
     texture->m_api_data = api_texture;
@@ -386,33 +528,63 @@ Error Renderer::create_texture_api(str texture_id) {
 
 Error Renderer::reload_texture_api(str texture_id) {
     Texture* texture = &m_textures[texture_id];
-    Texture_OPENGL* api_texture = (Texture_OPENGL*)texture->m_api_data;
 
-    glBindTexture(GL_TEXTURE_2D, ((Texture_OPENGL*)texture->m_api_data)->m_texture_name);
-    auto& texture_type = opengl_texture_formats[texture->m_texture_params.m_format];
-    glTexImage2D(GL_TEXTURE_2D, 0, get<0>(texture_type), texture->m_width, texture->m_height, 0,
-                 get<1>(texture_type), GL_UNSIGNED_BYTE, texture->m_data.data());
-    glGenerateMipmap(GL_TEXTURE_2D);
+    GLenum texture_target = opengl_texture_targets[texture->m_texture_params.m_target];
+
+    if (texture_target == GL_TEXTURE_2D) {
+        glBindTexture(GL_TEXTURE_2D, ((Texture_OPENGL*)texture->m_api_data)->m_texture_name);
+        auto& texture_type = opengl_texture_formats[texture->m_texture_params.m_format];
+
+        if (get<2>(texture_type) == GL_FLOAT) {
+            glTexImage2D(GL_TEXTURE_2D, 0, get<0>(texture_type), texture->m_width,
+                         texture->m_height, 0, get<1>(texture_type), get<2>(texture_type),
+                         texture->m_float_data.data());
+        } else {
+            glTexImage2D(GL_TEXTURE_2D, 0, get<0>(texture_type), texture->m_width,
+                         texture->m_height, 0, get<1>(texture_type), get<2>(texture_type),
+                         texture->m_data.data());
+        }
+
+        glGenerateMipmap(GL_TEXTURE_2D);
+        m_frame_stats.m_texture_bytes_uploaded +=
+            texture->m_data.size() + texture->m_float_data.size() * sizeof(f32);
+    }
 
     texture->m_should_reload = false;
 
     return Error();
 }
 
-void Renderer::set_samplers_bindings(Pass* pass, Shader* shader) {
-    for (const auto& sampler_uniform : pass->m_sampler_uniforms_bindings) {
-        GLint sampler_binding_point = shader->m_sampler_binding_points[sampler_uniform.first];
-        if (sampler_binding_point == 0) {
-            continue;
-        }
-        glActiveTexture(GL_TEXTURE0 + sampler_binding_point);
-        Texture* texture = &m_textures[sampler_uniform.second];
-        glBindTexture(GL_TEXTURE_2D, ((Texture_OPENGL*)texture->m_api_data)->m_texture_name);
+Error Renderer::destroy_texture_api(u32 texture_index) {
+    Texture* texture = &m_textures[texture_index];
+    Texture_OPENGL* api_texture = (Texture_OPENGL*)texture->m_api_data;
+    if (api_texture == NULL) {
+        return Error();
     }
+
+    glDeleteTextures(1, &api_texture->m_texture_name);
+    delete api_texture;
+    texture->m_api_data = NULL;
+
+    return Error();
 }
 
-void Renderer::set_images_bindings(Pass* pass, Shader* shader) {
-    logger.error("Compute shaders not available in WebGL");
+void Renderer::bind_uniforms(const PassBinding* bindings, u32 count) {
+    for (u32 i = 0; i < count; i++) {
+        const PassBinding& binding = bindings[i];
+        if (binding.m_type == UniformBindingType::BLOCK) {
+            UniformBuffer* uniform_buffer = &m_uniform_buffers[binding.m_resource];
+            glBindBufferBase(GL_UNIFORM_BUFFER, binding.m_binding_point,
+                             ((UniformBuffer_OPENGL*)uniform_buffer->m_api_data)->m_ubo);
+        } else if (binding.m_type == UniformBindingType::SAMPLER) {
+            Texture* texture = &m_textures[binding.m_resource];
+            glActiveTexture(GL_TEXTURE0 + binding.m_binding_point);
+            glBindTexture(opengl_texture_targets[texture->m_texture_params.m_target],
+                          ((Texture_OPENGL*)texture->m_api_data)->m_texture_name);
+        } else if (binding.m_type == UniformBindingType::IMAGE) {
+            logger.error("Image bindings not available in WebGL");
+        }
+    }
 }
 
 void Renderer::debug_marker_start(str name) {
@@ -457,12 +629,61 @@ void Renderer::draw(MeshPrimitive primitive, size_t count) {
     glDrawArrays(opengl_mesh_primitive_types[primitive], 0, GLsizei(count));
 }
 
-void Renderer::draw_indexed(MeshPrimitive primitive, size_t count) {
-    glDrawElements(opengl_mesh_primitive_types[primitive], GLsizei(count), GL_UNSIGNED_INT, 0);
+void Renderer::draw_indexed(MeshPrimitive primitive, size_t count, u32 first_index) {
+    glDrawElements(opengl_mesh_primitive_types[primitive], GLsizei(count), GL_UNSIGNED_INT,
+                   (void*)(uintptr_t(first_index) * sizeof(u32)));
+}
+
+void Renderer::draw_indexed_instanced(MeshPrimitive primitive, size_t count, u32 instance_count,
+                                      u32 first_instance, u32 first_index) {
+    set_instance_attribs(first_instance);
+    glDrawElementsInstanced(opengl_mesh_primitive_types[primitive], GLsizei(count),
+                            GL_UNSIGNED_INT, (void*)(uintptr_t(first_index) * sizeof(u32)),
+                            instance_count);
+}
+
+void Renderer::multi_draw_indexed(MeshPrimitive primitive, const u32* counts,
+                                  const u32* first_indices, u32 draw_count) {
+    for (u32 i = 0; i < draw_count; i++) {
+        draw_indexed(primitive, counts[i], first_indices[i]);
+    }
+}
+
+// Only reached with mesh pooling off, which game.cpp forces in WebGL, so every base vertex is 0.
+void Renderer::multi_draw_indexed_indirect(MeshPrimitive primitive,
+                                           const DrawIndirectCommand* draws, u32 draw_count) {
+    for (u32 i = 0; i < draw_count; i++) {
+        draw_indexed_instanced(primitive, draws[i].m_count, draws[i].m_instance_count,
+                               draws[i].m_first_instance, draws[i].m_first_index);
+    }
 }
 
 void Renderer::dispatch_compute(u32 num_groups_x, u32 num_groups_y, u32 num_groups_z) {
     logger.error("Compute shaders not available in WebGL");
 }
 
-}  // namespace blaz
\ No newline at end of file
+// WebGL has no glCopyImageSubData, the source is read through copy_fbo instead. Depth textures
+// can't be copied this way.
+void Renderer::copy_texture(u32 src, u32 dst, Vec3I src_pos, Vec2I src_size, Vec3I dst_pos) {
+    Texture* src_texture = &m_textures[src];
+    TextureFormat src_format = src_texture->m_texture_params.m_format;
+    if (src_format == TextureFormat::DEPTH32 || src_format == TextureFormat::DEPTH32F) {
+        logger.error("Renderer::copy_texture: Depth texture copies not available in WebGL");
+        return;
+    }
+
+    GLint read_framebuffer;
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &read_framebuffer);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, copy_fbo);
+    glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                           ((Texture_OPENGL*)src_texture->m_api_data)->m_texture_name, 0);
+
+    Texture* dst_texture = &m_textures[dst];
+    glBindTexture(GL_TEXTURE_2D, ((Texture_OPENGL*)dst_texture->m_api_data)->m_texture_name);
+    glCopyTexSubImage2D(GL_TEXTURE_2D, 0, dst_pos.x(), dst_pos.y(), src_pos.x(), src_pos.y(),
+                        src_size.x(), src_size.y());
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, read_framebuffer);
+}
+
+}  // namespace blaz
@@ -0,0 +1,86 @@
+#include "static_batch.h"
+
+#include "mesh.h"
+#include "meshlet.h"
+#include "renderer.h"
+
+namespace blaz {
+
+static void transform_vector(const Mat4& matrix, f32* v, bool point) {
+    f32 result[3];
+    for (u32 row = 0; row < 3; row++) {
+        result[row] = point ? matrix.m[12 + row] : 0;
+        for (u32 col = 0; col < 3; col++) {
+            result[row] += matrix.m[col * 4 + row] * v[col];
+        }
+    }
+    for (u32 i = 0; i < 3; i++) {
+        v[i] = result[i];
+    }
+}
+
+static void normalize_vector(f32* v) {
+    f32 length = Vec3(v[0], v[1], v[2]).length();
+    if (length > 0) {
+        for (u32 i = 0; i < 3; i++) {
+            v[i] /= length;
+        }
+    }
+}
+
+void append_static_part(Mesh* batch, const Mesh* part, const Mat4& matrix) {
+    u32 stride;
+    u32 position_offset;
+    if (!mesh_position_layout(part, &stride, &position_offset)) {
+        return;
+    }
+
+    Mat4 model = matrix;
+    Mat4 normal_matrix = model.invert().transpose();
+    span<const f32> part_vertices = mesh_vertices(part);
+    span<const u32> part_indices = mesh_indices(part);
+    u32 base_vertex = u32(batch->m_vertices.size() / stride);
+    u32 vertex_count = u32(part_vertices.size() / stride);
+    batch->m_vertices.insert(batch->m_vertices.end(), part_vertices.begin(),
+                             part_vertices.begin() + vertex_count * stride);
+
+    u32 attrib_offset = 0;
+    for (const auto& attrib : part->m_attribs) {
+        bool position = attrib.first == "position";
+        bool normal = attrib.first == "normal";
+        bool tangent = attrib.first == "tangent";
+        if (attrib.second >= 3 && (position || normal || tangent)) {
+            for (u32 i = 0; i < vertex_count; i++) {
+                f32* v = &batch->m_vertices[(base_vertex + i) * stride + attrib_offset];
+                if (position) {
+                    transform_vector(model, v, true);
+                } else {
+                    transform_vector(normal ? normal_matrix : model, v, false);
+                    normalize_vector(v);
+                }
+            }
+        }
+        attrib_offset += attrib.second;
+    }
+
+    u32 first_index = 0;
+    u32 index_count = u32(part_indices.size());
+    if (!part->m_lods.empty()) {
+        first_index = part->m_lods[0].m_first_index;
+        index_count = part->m_lods[0].m_index_count;
+    }
+    // A mirroring transform turns front faces into back faces unless the winding is swapped.
+    bool mirrored = model.determinant() < 0;
+    u32 batch_first_index = u32(batch->m_indices.size());
+    for (u32 i = 0; i + 2 < index_count; i += 3) {
+        const u32* triangle = &part_indices[first_index + i];
+        batch->m_indices.push_back(base_vertex + triangle[0]);
+        batch->m_indices.push_back(base_vertex + triangle[mirrored ? 2 : 1]);
+        batch->m_indices.push_back(base_vertex + triangle[mirrored ? 1 : 2]);
+    }
+
+    build_range_meshlets(batch, batch_first_index,
+                         u32(batch->m_indices.size()) - batch_first_index);
+}
+
+}  // namespace blaz
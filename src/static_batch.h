@@ -0,0 +1,17 @@
+#pragma once
+
+#include "my_math.h"
+#include "types.h"
+
+namespace blaz {
+
+struct Mesh;
+
+const u32 STATIC_BATCH_MAX_VERTICES = 1 << 20;
+
+// Appends the first detail level of part to batch with matrix baked into its "position",
+// "normal" and "tangent" attributes, and splits its triangles into meshlets of batch so the
+// part can still be culled piece by piece. Both meshes need the same attributes.
+void append_static_part(Mesh* batch, const Mesh* part, const Mat4& matrix);
+
+}  // namespace blaz
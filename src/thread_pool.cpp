@@ -0,0 +1,91 @@
+#include "thread_pool.h"
+
+namespace blaz {
+
+u32 default_worker_count() {
+#ifdef EMSCRIPTEN
+    return 0;
+#else
+    u32 hardware_threads = std::thread::hardware_concurrency();
+    return hardware_threads > 1 ? hardware_threads - 1 : 0;
+#endif
+}
+
+static void run_jobs(ThreadPool* thread_pool) {
+    for (u32 i = thread_pool->m_next_job++; i < thread_pool->m_job_count;
+         i = thread_pool->m_next_job++) {
+        (*thread_pool->m_job)(i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    shutdown();
+}
+
+void ThreadPool::init(u32 worker_count) {
+    shutdown();
+    m_stop = false;
+    for (u32 i = 0; i < worker_count; i++) {
+        m_workers.push_back(std::thread([this]() {
+            u64 generation = 0;
+            while (true) {
+                {
+                    std::unique_lock<std::mutex> lock(m_mutex);
+                    m_work_condition.wait(lock, [this, generation]() {
+                        return m_stop || m_generation != generation;
+                    });
+                    if (m_stop) {
+                        return;
+                    }
+                    generation = m_generation;
+                }
+
+                run_jobs(this);
+
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_busy_workers--;
+                if (m_busy_workers == 0) {
+                    m_done_condition.notify_one();
+                }
+            }
+        }));
+    }
+}
+
+void ThreadPool::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_work_condition.notify_all();
+    for (std::thread& worker : m_workers) {
+        worker.join();
+    }
+    m_workers.clear();
+}
+
+void ThreadPool::parallel_for(u32 job_count, const std::function<void(u32)>& job) {
+    if (m_workers.empty() || job_count <= 1) {
+        for (u32 i = 0; i < job_count; i++) {
+            job(i);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_job = &job;
+        m_job_count = job_count;
+        m_next_job = 0;
+        m_busy_workers = u32(m_workers.size());
+        m_generation++;
+    }
+    m_work_condition.notify_all();
+
+    run_jobs(this);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done_condition.wait(lock, [this]() { return m_busy_workers == 0; });
+}
+
+}  // namespace blaz
\ No newline at end of file
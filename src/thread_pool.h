@@ -0,0 +1,38 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "types.h"
+
+namespace blaz {
+
+u32 default_worker_count();
+
+struct ThreadPool {
+    ~ThreadPool();
+
+    void init(u32 worker_count);
+    void shutdown();
+    void parallel_for(u32 job_count, const std::function<void(u32)>& job);
+
+    u32 thread_count() const {
+        return u32(m_workers.size()) + 1;
+    }
+
+    vec<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_work_condition;
+    std::condition_variable m_done_condition;
+    const std::function<void(u32)>* m_job = NULL;
+    u32 m_job_count = 0;
+    std::atomic<u32> m_next_job = 0;
+    u32 m_busy_workers = 0;
+    u64 m_generation = 0;
+    bool m_stop = false;
+};
+
+}  // namespace blaz
\ No newline at end of file
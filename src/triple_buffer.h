@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+
+#include "types.h"
+
+namespace blaz {
+
+// Single producer / single consumer triple buffer. The producer fills back() and publishes it,
+// the consumer acquires the most recently published slot. Neither side ever blocks; a slot that
+// was published but not acquired before the next publish comes back to the producer as back(),
+// with back_unread() set so it can merge what the consumer never saw.
+template <typename T>
+struct TripleBuffer {
+    static constexpr u32 INDEX_MASK = 0x3;
+    static constexpr u32 UNREAD_BIT = 0x4;
+
+    T m_slots[3];
+    u32 m_back = 0;
+    std::atomic<u32> m_middle = 1;
+    u32 m_front = 2;
+    bool m_back_unread = false;
+
+    void reset() {
+        m_back = 0;
+        m_middle.store(1);
+        m_front = 2;
+        m_back_unread = false;
+    }
+
+    T& back() {
+        return m_slots[m_back];
+    }
+
+    bool back_unread() const {
+        return m_back_unread;
+    }
+
+    void publish() {
+        u32 previous = m_middle.exchange(m_back | UNREAD_BIT, std::memory_order_acq_rel);
+        m_back = previous & INDEX_MASK;
+        m_back_unread = (previous & UNREAD_BIT) != 0;
+    }
+
+    bool acquire() {
+        if ((m_middle.load(std::memory_order_acquire) & UNREAD_BIT) == 0) {
+            return false;
+        }
+        m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & INDEX_MASK;
+        return true;
+    }
+
+    T& front() {
+        return m_slots[m_front];
+    }
+};
+
+}  // namespace blaz
@@ -1,7 +1,9 @@
 #pragma once
 
+#include <algorithm>
 #include <cstdint>
 #include <optional>
+#include <span>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -33,7 +35,10 @@ template <class T1, class T2>
 using pair = std::pair<T1, T2>;
 
 template <typename T>
-bool contains(vec<T> v, T e) {
+using span = std::span<T>;
+
+template <typename T>
+bool contains(const vec<T>& v, const T& e) {
     return std::find(v.begin(), v.end(), e) != v.end();
 }
 
@@ -84,6 +89,10 @@ struct ArrayMap {
         return map.find(name) != map.end();
     }
 
+    u32 index_of(const str& name) const {
+        return map.at(name);
+    }
+
     auto size() {
         return array.size();
     }
@@ -0,0 +1,73 @@
+#include "error.h"
+#include "logger.h"
+#include "renderer.h"
+#include "mesh.h"
+#include "types.h"
+
+using namespace blaz;
+
+// Rewrites a mesh file from the legacy size_t prefixed format, or from an older version of the
+// current one, as a mesh file of MESH_FILE_VERSION.
+int main(int argc, char* argv[]) {
+    if (argc != 3 && argc != 4) {
+        logger.info("Usage: " + str(argv[0]) + " <input_path> <output_path> [--checksum]");
+        return 1;
+    }
+
+    str input_path = argv[1];
+    str output_path = argv[2];
+    bool checksum = argc == 4 && str(argv[3]) == "--checksum";
+
+    Mesh mesh;
+    mesh.m_path = input_path;
+    Error err = load_mesh_from_file(&mesh);
+    if (err) {
+        err = load_legacy_mesh_file(&mesh);
+    }
+    if (err) {
+        logger.error(err);
+        return 1;
+    }
+    copy_mesh_data(&mesh);
+
+    // Shipped mesh files are not checked for out of range indices when loaded, so they are
+    // dropped here.
+    u32 stride = 0;
+    for (auto& attrib : mesh.m_attribs) {
+        stride += attrib.second;
+    }
+    u32 vertex_count = stride > 0 ? u32(mesh.m_vertices.size() / stride) : 0;
+    u32 primitive_size = mesh.m_primitive == MeshPrimitive::TRIANGLES ? 3 : 2;
+    vec<u32> indices;
+    for (u32 i = 0; i + primitive_size <= mesh.m_indices.size(); i += primitive_size) {
+        bool valid = true;
+        for (u32 k = 0; k < primitive_size; k++) {
+            valid = valid && mesh.m_indices[i + k] < vertex_count;
+        }
+        if (valid) {
+            indices.insert(indices.end(), mesh.m_indices.begin() + i,
+                           mesh.m_indices.begin() + i + primitive_size);
+        }
+    }
+    if (indices.size() != mesh.m_indices.size()) {
+        if (!mesh.m_lods.empty() || !mesh.m_meshlets.empty()) {
+            logger.error(Error("'" + input_path + "' has out of range indices"));
+            return 1;
+        }
+        logger.info("Dropped ", (mesh.m_indices.size() - indices.size()) / primitive_size,
+                    " primitives with out of range indices");
+        mesh.m_indices = indices;
+    }
+    compute_mesh_bounds(&mesh);
+
+    err = export_mesh_file(output_path, &mesh, checksum);
+    if (err) {
+        logger.error(err);
+        return 1;
+    }
+    logger.info("Converted '" + input_path + "' to mesh file version ", MESH_FILE_VERSION, ": ",
+                mesh_vertices(&mesh).size(), " floats, ", mesh_indices(&mesh).size(),
+                " indices, ", mesh.m_lods.size(), " levels, ", mesh.m_meshlets.size(),
+                " meshlets");
+    return 0;
+}
@@ -0,0 +1,50 @@
+#include "error.h"
+#include "logger.h"
+#include "renderer.h"
+#include "mesh.h"
+#include "mesh_simplify.h"
+#include "meshlet.h"
+#include "types.h"
+
+using namespace blaz;
+
+int main(int argc, char* argv[]) {
+    if (argc != 3 && argc != 4) {
+        logger.info("Usage: " + str(argv[0]) + " <input_path> <output_path> [lod_count]");
+        return 1;
+    }
+
+    str input_path = argv[1];
+    str output_path = argv[2];
+    u32 lod_count = argc == 4 ? u32(std::stoul(argv[3])) : MESH_DEFAULT_LOD_COUNT;
+
+    Mesh mesh;
+    mesh.m_path = input_path;
+    Error err;
+    if (input_path.ends_with(".obj")) {
+        err = load_mesh_from_obj_file(&mesh);
+    } else {
+        err = load_mesh_from_file(&mesh);
+    }
+    if (err) {
+        logger.error(err);
+        return 1;
+    }
+    copy_mesh_data(&mesh);
+
+    generate_mesh_lods(&mesh, lod_count);
+    for (u32 i = 0; i < mesh.m_lods.size(); i++) {
+        logger.info("LOD ", i, ": ", mesh.m_lods[i].m_index_count / 3, " triangles, error ",
+                    mesh.m_lods[i].m_error);
+    }
+    build_mesh_meshlets(&mesh);
+    logger.info("Meshlets: ", mesh.m_meshlets.size());
+
+    err = export_mesh_file(output_path, &mesh);
+    if (err) {
+        logger.error(err);
+        return 1;
+    }
+
+    return 0;
+}